@@ -0,0 +1,117 @@
+/*
+ * @file mimiio_convert_bench.cpp
+ * @ingroup examples_src
+ * \~english
+ * @brief Measure samples per second of converting 16 bit PCM for the flac encoder, SIMD implementation selected for the CPU
+ * against the scalar one. The conversion is compiled from the sources of libmimiio, so that no network is needed.
+ *
+ * \~japanese
+ * @brief flac 符号化器に渡す 16 ビット PCM の変換速度（サンプル毎秒）を、CPU に応じて選択される SIMD 実装とスカラー実装で比較する.
+ * 変換処理は libmimiio のソースから直接ビルドされ、ネットワークは使用しない。
+ * \~
+ * @copyright Copyright 2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/cmdline/cmdline.h"
+#include "encoder/convert.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+typedef void (*WIDEN_FUNC_T)(int32_t *, const char *, size_t);
+
+/**
+ * \~english
+ * @brief Convert \e audio in blocks of \e block samples until \e seconds have passed, and return samples per second
+ * \~japanese
+ * @brief \e audio を \e block サンプルずつ \e seconds 秒間変換し続け、1 秒あたりの変換サンプル数を返す
+ */
+double measure(WIDEN_FUNC_T widen, const std::vector<char> &audio, size_t block, double seconds, std::vector<int32_t> &pcm) {
+    typedef std::chrono::steady_clock clock;
+    const size_t samples = audio.size() / 2;
+    unsigned long long converted = 0;
+    const clock::time_point start = clock::now();
+    clock::time_point now = start;
+    while (std::chrono::duration<double>(now - start).count() < seconds) {
+        for (size_t i = 0; i < samples; i += block) {
+            const size_t n = std::min(block, samples - i);
+            widen(pcm.data() + i, audio.data() + 2 * i, n);
+            converted += n;
+        }
+        now = clock::now();
+    }
+    return converted / std::chrono::duration<double>(now - start).count();
+}
+
+/**
+ * @brief main function
+ * Measure samples per second of the SIMD and scalar conversion.
+ * @return exit code
+ */
+int main(int argc, char **argv) {
+
+    cmdline::parser p;
+    {
+        p.add<std::string>("input", 'i', "Input file, 16 bit little endian PCM", false, "../audio.raw");
+        p.add<int>("block", 'b', "Samples given to the conversion at a time, e.g. 1600 for 100 msec at 16kHz", false, 1600);
+        p.add<double>("seconds", 's', "Time of measurement of each implementation", false, 2.0);
+        p.add("help", '\0', "Show help");
+        if (!p.parse(argc, argv)) {
+            std::cout << p.error_full() << std::endl;
+            std::cout << p.usage() << std::endl;
+            return 0;
+        }
+    }
+
+    std::ifstream input(p.get<std::string>("input"), std::ios::binary);
+    if (!input) {
+        std::cerr << "Could not open file: " << p.get<std::string>("input") << std::endl;
+        return 1;
+    }
+    std::vector<char> audio((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    audio.resize(audio.size() - audio.size() % 2);
+    if (audio.empty() || p.get<int>("block") <= 0) {
+        std::cerr << "Empty input or invalid block size" << std::endl;
+        return 1;
+    }
+    const size_t block = static_cast<size_t>(p.get<int>("block"));
+    const double seconds = p.get<double>("seconds");
+
+    // Both implementations must give the same samples
+    std::vector<int32_t> simd(audio.size() / 2);
+    std::vector<int32_t> scalar(audio.size() / 2);
+    mimiio::encoder::widen_s16le(simd.data(), audio.data(), simd.size());
+    mimiio::encoder::widen_s16le_scalar(scalar.data(), audio.data(), scalar.size());
+    if (simd != scalar) {
+        std::cerr << "Conversion of " << mimiio::encoder::widen_implementation() << " differs from scalar" << std::endl;
+        return 1;
+    }
+
+    const double scalar_rate = measure(&mimiio::encoder::widen_s16le_scalar, audio, block, seconds, scalar);
+    const double simd_rate = measure(&mimiio::encoder::widen_s16le, audio, block, seconds, simd);
+    std::cout << "samples           : " << audio.size() / 2 << " in blocks of " << block << std::endl;
+    std::cout << "scalar            : " << scalar_rate / 1e6 << " Msamples/sec" << std::endl;
+    std::cout << mimiio::encoder::widen_implementation() << std::string(18 - std::strlen(mimiio::encoder::widen_implementation()), ' ')
+              << ": " << simd_rate / 1e6 << " Msamples/sec (x" << simd_rate / scalar_rate << ")" << std::endl;
+    return 0;
+}
@@ -0,0 +1,272 @@
+/*
+ * @file mimiio_coro.cpp
+ * @ingroup examples_src
+ * \~english
+ * @brief Example of sending audio from a file on C++20 coroutines, driven by a single-threaded poll(2) event loop.
+ * Several sessions of the same file can be run on one thread to try the coroutine interface.
+ *
+ * \~japanese
+ * @brief C++20 のコルーチン上で音声ファイルから音声データをサーバーに送信する例. poll(2) による単一スレッドのイベントループで駆動する。
+ * 同じファイルを複数のセッションで同時に送信し、1 スレッド上で多数の接続を扱う例を示す。
+ * \~
+ * @copyright Copyright 2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/cmdline/cmdline.h"
+#include <mimiio.h>
+#include <mimiio_coro.hpp>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <unistd.h>
+
+/**
+ * \~english
+ * @brief Event loop on poll(2). post() may be called from any thread, other functions only on the thread of run().
+ *
+ * \~japanese
+ * @brief poll(2) によるイベントループ. post() は任意のスレッドから、その他の関数は run() のスレッドからのみ呼び出す。
+ */
+class poll_reactor : public mimiio::coro::reactor
+{
+public:
+
+    poll_reactor() {
+        if (pipe(wakeup_) != 0) {
+            wakeup_[0] = wakeup_[1] = -1;
+        }
+    }
+
+    ~poll_reactor() {
+        close(wakeup_[0]);
+        close(wakeup_[1]);
+    }
+
+    void post(std::function<void()> callback) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            posted_.push_back(std::move(callback));
+        }
+        char c = 0;
+        ssize_t n = write(wakeup_[1], &c, 1); // wakes up poll() of run()
+        (void)n;
+    }
+
+    void wait(int fd, bool writable, int timeout_ms, std::function<void()> callback) override {
+        waits_.push_back(entry{fd, writable, timeout_ms < 0 ? clock::time_point::max()
+                : clock::now() + std::chrono::milliseconds(timeout_ms), std::move(callback)});
+    }
+
+    /**
+     * \~english
+     * @brief Run callbacks until \e done returns true
+     * \~japanese
+     * @brief \e done が true を返すまでコールバック関数を実行する
+     */
+    void run(const std::function<bool()> &done) {
+        while (!done()) {
+            std::vector<pollfd> fds(1, pollfd{wakeup_[0], POLLIN, 0});
+            clock::time_point deadline = clock::time_point::max();
+            for (const entry &e : waits_) {
+                fds.push_back(pollfd{e.fd, static_cast<short>(e.writable ? POLLIN | POLLOUT : POLLIN), 0});
+                deadline = std::min(deadline, e.deadline);
+            }
+            int timeout_ms = -1;
+            if (deadline != clock::time_point::max()) {
+                timeout_ms = static_cast<int>(std::max<long long>(0,
+                        std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock::now()).count() + 1));
+            }
+            poll(fds.data(), fds.size(), timeout_ms);
+
+            // Callbacks may register new waits, so the ones completed are taken out first
+            std::vector<std::function<void()>> ready;
+            const clock::time_point now = clock::now();
+            std::vector<entry> pending;
+            for (size_t i = 0; i < waits_.size(); ++i) {
+                if (fds[i + 1].revents != 0 || waits_[i].deadline <= now) {
+                    ready.push_back(std::move(waits_[i].callback));
+                } else {
+                    pending.push_back(std::move(waits_[i]));
+                }
+            }
+            waits_.swap(pending);
+            if (fds[0].revents != 0) {
+                char buf[64];
+                ssize_t n = read(wakeup_[0], buf, sizeof(buf));
+                (void)n;
+                std::lock_guard<std::mutex> lock(mutex_);
+                std::move(posted_.begin(), posted_.end(), std::back_inserter(ready));
+                posted_.clear();
+            }
+            for (std::function<void()> &callback : ready) {
+                callback();
+            }
+        }
+    }
+
+private:
+
+    typedef std::chrono::steady_clock clock;
+
+    struct entry {
+        int fd;
+        bool writable;
+        clock::time_point deadline;
+        std::function<void()> callback;
+    };
+
+    int wakeup_[2];
+    std::mutex mutex_;
+    std::vector<std::function<void()>> posted_;
+    std::vector<entry> waits_;
+};
+
+/**
+ * \~english
+ * @brief Awaitable resuming after \e msec on the loop
+ * \~japanese
+ * @brief イベントループ上で \e msec ミリ秒後に再開する
+ */
+struct sleep_for {
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> awaiting) { loop.wait(-1, false, msec, [awaiting] { awaiting.resume(); }); }
+    void await_resume() const noexcept {}
+    poll_reactor &loop;
+    int msec;
+};
+
+/**
+ * \~english
+ * @brief Print results of a session until it ends
+ * \~japanese
+ * @brief セッションが終了するまで認識結果を表示する
+ */
+mimiio::coro::task<> print_results(mimiio::coro::session &session, int id, int &running) {
+    while (std::optional<std::string> result = co_await session.next_result()) {
+        std::cout << id << ": " << *result << std::endl;
+    }
+    --running;
+}
+
+/**
+ * \~english
+ * @brief Send audio in chunks of 100 msec at real time, and print results on another coroutine
+ * \~japanese
+ * @brief 音声を 100 ミリ秒ずつ実時間で送信し、別のコルーチンで認識結果を表示する
+ */
+mimiio::coro::task<> recognize(poll_reactor &loop, const MIMIIO_OPEN_OPTIONS &options, const std::vector<char> &audio,
+                               int id, int &running) {
+    mimiio::coro::session session(loop);
+    int errorno = co_await session.open(options);
+    if (errorno != 0) {
+        std::cerr << id << ": open failed: " << mimi_strerror(errorno) << " (" << errorno << ")" << std::endl;
+        --running;
+        co_return;
+    }
+    int receiving = 1;
+    mimiio::coro::spawn(print_results(session, id, receiving));
+
+    const size_t chunk = static_cast<size_t>(options.samplingrate * options.channels * 2 / 10);
+    for (size_t offset = 0; offset < audio.size(); offset += chunk) {
+        const size_t len = std::min(chunk, audio.size() - offset);
+        errorno = co_await session.write(std::span<const char>(audio.data() + offset, len), offset + len == audio.size());
+        if (errorno != 0) {
+            break;
+        }
+        co_await sleep_for{loop, 100};
+    }
+    while (receiving != 0) { // the session must outlive print_results()
+        co_await sleep_for{loop, 100};
+    }
+    if (session.error() != 0) {
+        std::cerr << id << ": " << mimi_strerror(session.error()) << " (" << session.error() << ")" << std::endl;
+    }
+    --running;
+}
+
+/**
+ * @brief main function
+ * Example of sending audio from file on C++20 coroutines.
+ * @return exit code
+ */
+int main(int argc, char **argv) {
+
+    cmdline::parser p;
+    {
+        // mandatory
+        p.add<std::string>("host", 'h', "Host name", true);
+        p.add<int>("port", 'p', "Port", true);
+        p.add<std::string>("input", 'i', "Input file, 16 bit little endian PCM", true);
+        // optional
+        p.add<std::string>("token", 't', "Access token", false);
+        p.add<int>("rate", '\0', "Sampling rate", false, 16000);
+        p.add<int>("channel", '\0', "Number of channels", false, 1);
+        p.add<int>("sessions", 'n', "Number of sessions run at the same time", false, 1);
+        p.add<std::string>("process", 'x', "x-mimi-process", false, "asr");
+        p.add("help", '\0', "Show help");
+        if (!p.parse(argc, argv)) {
+            std::cout << p.error_full() << std::endl;
+            std::cout << p.usage() << std::endl;
+            return 0;
+        }
+    }
+
+    std::ifstream input(p.get<std::string>("input"), std::ios::binary);
+    if (!input) {
+        std::cerr << "Could not open file: " << p.get<std::string>("input") << std::endl;
+        return 1;
+    }
+    const std::vector<char> audio((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    const std::string host = p.get<std::string>("host");
+    const std::string token = p.exist("token") ? p.get<std::string>("token") : std::string();
+    MIMIIO_HTTP_REQUEST_HEADER h[1];
+    strcpy(h[0].key, "x-mimi-process");
+    strcpy(h[0].value, p.get<std::string>("process").c_str());
+
+    MIMIIO_OPEN_OPTIONS options;
+    mimi_open_options_default(&options);
+    options.host = host.c_str();
+    options.port = p.get<int>("port");
+    options.format = MIMIIO_FLAC_0;
+    options.samplingrate = p.get<int>("rate");
+    options.channels = p.get<int>("channel");
+    options.request_headers = h;
+    options.request_headers_len = 1;
+    options.access_token = p.exist("token") ? token.c_str() : nullptr;
+
+    poll_reactor loop;
+    int running = p.get<int>("sessions");
+    const int sessions = running;
+    std::vector<mimiio::coro::task<>> tasks;
+    for (int id = 0; id < sessions; ++id) {
+        tasks.push_back(recognize(loop, options, audio, id, running));
+    }
+    for (mimiio::coro::task<> &t : tasks) {
+        mimiio::coro::spawn(std::move(t)); // runs until the first co_await
+    }
+    loop.run([&running] { return running == 0; });
+    return 0;
+}
@@ -133,7 +133,8 @@ constexpr AFENTRY afmap[] =
                 {"MIMIIO_FLAC_6",            MIMIIO_FLAC_6},
                 {"MIMIIO_FLAC_7",            MIMIIO_FLAC_7},
                 {"MIMIIO_FLAC_8",            MIMIIO_FLAC_8},
-                {"MIMIIO_FLAC_PASS_THROUGH", MIMIIO_FLAC_PASS_THROUGH}
+                {"MIMIIO_FLAC_PASS_THROUGH", MIMIIO_FLAC_PASS_THROUGH},
+                {"MIMIIO_FLAC_ADAPTIVE",     MIMIIO_FLAC_ADAPTIVE}
         };
 
 bool parse_afstring(const std::string &afstring, MIMIIO_AUDIO_FORMAT *af) {
@@ -250,10 +251,7 @@ int main(int argc, char **argv) {
     if (p.exist("verbose")) {
         fprintf(stderr, "Full duplex stream is started.\n");
     }
-    while (mimi_is_active(mio)) {
-        // Wait 0.1 sec to avoid busy loop
-        usleep(100000);
-    }
+    mimi_wait(mio, -1); // Wait until the stream ends
     if (p.exist("verbose")) {
         fprintf(stderr, "mimi_is_active returns false now.\n");
     }
@@ -0,0 +1,174 @@
+/*
+ * @file mimiio_flac_bench.cpp
+ * @ingroup examples_src
+ * \~english
+ * @brief Measure compression ratio against the latency added by the flac encoder, for each compression level and
+ * latency budget given by flac_latency_ms. The encoder is compiled from the sources of libmimiio, so that no network is needed.
+ *
+ * \~japanese
+ * @brief flac 符号化器の圧縮率と、符号化器が音声を保持することによる遅延を、圧縮レベルと flac_latency_ms による遅延の上限ごとに計測する.
+ * 符号化器は libmimiio のソースから直接ビルドされ、ネットワークは使用しない。
+ * \~
+ * @copyright Copyright 2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/cmdline/cmdline.h"
+#include "encoder/flac.hpp"
+#include "encoder/convert.hpp"
+#include <Poco/Logger.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * \~english
+ * @brief Encoder recording when each frame is written, in audio time of the input given so far
+ * \~japanese
+ * @brief 各フレームが書き出された時刻を、それまでに入力した音声の時間で記録する符号化器
+ */
+class TimedFlacEncoder : public mimiio::encoder::FlacEncoderImpl
+{
+public:
+
+    TimedFlacEncoder(int samplingrate, int level, unsigned int blocksize, size_t chunk, std::vector<char> &output, Poco::Logger &logger) :
+            FlacEncoderImpl(samplingrate, 1, level, blocksize, output, logger),
+            samplingrate_(samplingrate), input_(0), output_(0), chunk_(chunk), frames_(0), sumDelay_(0), maxDelay_(0) {}
+
+    /**
+     * \~english
+     * @brief Give a chunk of audio, whose samples have arrived together. Only the last chunk may be shorter.
+     * \~japanese
+     * @brief 同時に到着した 1 チャンクの音声を入力する. 最後のチャンクのみ短くてもよい。
+     */
+    void give(const FLAC__int32 *pcm, size_t samples) {
+        input_ += samples;
+        process_interleaved(pcm, static_cast<unsigned int>(samples));
+    }
+
+    void flush() { finish(); }
+
+    unsigned long frames() const { return frames_; }
+    double meanDelayMs() const { return output_ == 0 ? 0 : sumDelay_ / output_ * 1000 / samplingrate_; }
+    double maxDelayMs() const { return maxDelay_ * 1000 / samplingrate_; }
+
+protected:
+
+    virtual FLAC__StreamEncoderWriteStatus write_callback(const FLAC__byte *buffer, size_t bytes, unsigned int samples, unsigned int current_frame) {
+        // A sample has arrived at the end of its chunk, and leaves when the input given so far has arrived.
+        // Samples of the frame are summed per chunk, so that the accounting does not dominate the measured time.
+        for (size_t i = output_; i < output_ + samples;) {
+            const size_t arrival = std::min((i / chunk_ + 1) * chunk_, input_);
+            const size_t n = std::min(output_ + samples, arrival) - i;
+            const double delay = static_cast<double>(input_ - arrival);
+            sumDelay_ += delay * n;
+            maxDelay_ = std::max(maxDelay_, delay);
+            i += n;
+        }
+        output_ += samples;
+        if (samples != 0) {
+            ++frames_;
+        }
+        return FlacEncoderImpl::write_callback(buffer, bytes, samples, current_frame);
+    }
+
+private:
+
+    int samplingrate_;
+    size_t input_;      // samples given
+    size_t output_;     // samples written in frames
+    size_t chunk_;      // samples of a chunk
+    unsigned long frames_;
+    double sumDelay_;   // in samples
+    double maxDelay_;   // in samples
+};
+
+/**
+ * @brief main function
+ * Measure compression ratio against latency of the flac encoder.
+ * @return exit code
+ */
+int main(int argc, char **argv) {
+
+    cmdline::parser p;
+    {
+        p.add<std::string>("input", 'i', "Input file, 16 bit little endian PCM, monaural", false, "../audio.raw");
+        p.add<int>("rate", '\0', "Sampling rate", false, 16000);
+        p.add<int>("chunk", 'c', "Milliseconds of audio given to the encoder at a time", false, 20);
+        p.add<std::string>("levels", '\0', "Comma separated compression levels", false, "0,5,8");
+        p.add<std::string>("latency", '\0', "Comma separated flac_latency_ms, 0 for the block size of the level", false, "0,20,50,100,200");
+        p.add("help", '\0', "Show help");
+        if (!p.parse(argc, argv)) {
+            std::cout << p.error_full() << std::endl;
+            std::cout << p.usage() << std::endl;
+            return 0;
+        }
+    }
+
+    std::ifstream input(p.get<std::string>("input"), std::ios::binary);
+    if (!input) {
+        std::cerr << "Could not open file: " << p.get<std::string>("input") << std::endl;
+        return 1;
+    }
+    std::vector<char> audio((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    audio.resize(audio.size() - audio.size() % 2);
+    std::vector<FLAC__int32> pcm(audio.size() / 2);
+    mimiio::encoder::widen_s16le(pcm.data(), audio.data(), pcm.size());
+
+    const int rate = p.get<int>("rate");
+    const size_t chunk = std::max<size_t>(1, static_cast<size_t>(rate) * p.get<int>("chunk") / 1000);
+    const auto parse = [](const std::string &s) {
+        std::vector<int> values;
+        std::istringstream in(s);
+        std::string item;
+        while (std::getline(in, item, ',')) {
+            values.push_back(std::stoi(item));
+        }
+        return values;
+    };
+    Poco::Logger &logger = Poco::Logger::get("mimiio_flac_bench");
+    logger.setLevel(Poco::Message::PRIO_WARNING);
+
+    const double audio_sec = static_cast<double>(pcm.size()) / rate;
+    std::printf("%.2f sec of audio in chunks of %zu samples\n", audio_sec, chunk);
+    std::printf("level latency blocksize   bytes  ratio frames  delay(mean)  delay(max)  encode/audio\n");
+    for (int level : parse(p.get<std::string>("levels"))) {
+        for (int latency : parse(p.get<std::string>("latency"))) {
+            const unsigned int blocksize = mimiio::encoder::FlacEncoder::blocksize(rate, level, latency);
+            std::vector<char> output;
+            TimedFlacEncoder encoder(rate, level, blocksize, chunk, output, logger);
+            const unsigned int actual = encoder.get_blocksize(); // settings are reset by finish()
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < pcm.size(); i += chunk) {
+                encoder.give(pcm.data() + i, std::min(chunk, pcm.size() - i));
+            }
+            encoder.flush();
+            const double cpu = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::printf("%5d %7d %9u %7zu %6.3f %6lu %9.1fms %9.1fms %11.3f%%\n",
+                        level, latency, actual, output.size(),
+                        static_cast<double>(audio.size()) / output.size(), encoder.frames(),
+                        encoder.meanDelayMs(), encoder.maxDelayMs(), cpu / audio_sec * 100);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * @file mimiio_ktls_bench.cpp
+ * @ingroup examples_src
+ * \~english
+ * @brief Measure CPU time per stream of authenticated connections, with or without kernel TLS offload.
+ * Run once with and once without --offload and compare the results, since mimi_init() can be called only once in a process.
+ *
+ * \~japanese
+ * @brief 認証付き接続のストリームあたりの CPU 時間を、カーネル TLS によるオフロードの有無で計測する例.
+ * mimi_init() は 1 プロセスで 1 回しか呼び出せないため、--offload の有無で 2 回実行して結果を比較する。
+ * \~
+ * @copyright Copyright 2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ * @copyright Apache License, Version 2.0
+ *
+ * Copyright 2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/cmdline/cmdline.h"
+#include <mimiio.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+
+/**
+ * \~english
+ * @brief Callback function for receiving results, which only counts them
+ * \~japanese
+ * @brief 認識結果を受信する都度呼ばれるコールバック関数. 受信数を数えるだけで表示はしない。
+ */
+void rxfunc(const char *result, size_t len, int *rxfunc_error, void *userdata) {
+    ++*static_cast<int *>(userdata);
+}
+
+/**
+ * \~english
+ * @brief User and system CPU time of the process in microseconds
+ * \~japanese
+ * @brief プロセスのユーザー時間とシステム時間の合計（マイクロ秒）
+ */
+long long process_cpu_usec() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000LL + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+/**
+ * @brief main function
+ * Measure CPU time per stream with or without kernel TLS offload.
+ * @return exit code
+ */
+int main(int argc, char **argv) {
+
+    cmdline::parser p;
+    {
+        // mandatory
+        p.add<std::string>("host", 'h', "Host name", true);
+        p.add<int>("port", 'p', "Port", true);
+        p.add<std::string>("token", 't', "Access token, kernel TLS applies only to authenticated connections", true);
+        // optional
+        p.add<std::string>("input", 'i', "Input file, 16 bit little endian PCM", false, "../audio.raw");
+        p.add<int>("rate", '\0', "Sampling rate", false, 16000);
+        p.add<int>("streams", 'n', "Number of connections streaming at the same time", false, 16);
+        p.add<double>("speed", '\0', "Speed of sending relative to real time", false, 1.0);
+        p.add<std::string>("process", 'x', "x-mimi-process", false, "asr");
+        p.add("offload", '\0', "Enable kernel TLS offload by tls_offload of mimi_init()");
+        p.add("help", '\0', "Show help");
+        if (!p.parse(argc, argv)) {
+            std::cout << p.error_full() << std::endl;
+            std::cout << p.usage() << std::endl;
+            return 0;
+        }
+    }
+
+    std::ifstream input(p.get<std::string>("input"), std::ios::binary);
+    if (!input) {
+        std::cerr << "Could not open file: " << p.get<std::string>("input") << std::endl;
+        return 1;
+    }
+    const std::vector<char> audio((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    MIMIIO_INIT_OPTIONS init;
+    mimi_init_options_default(&init);
+    init.tls_offload = p.exist("offload");
+    int errorno = mimi_init(&init);
+    if (errorno != 0) {
+        std::cerr << "mimi_init() failed: " << mimi_strerror(errorno) << " (" << errorno << ")" << std::endl;
+        return 1;
+    }
+
+    const std::string host = p.get<std::string>("host");
+    const std::string token = p.get<std::string>("token");
+    MIMIIO_HTTP_REQUEST_HEADER h[1];
+    strcpy(h[0].key, "x-mimi-process");
+    strcpy(h[0].value, p.get<std::string>("process").c_str());
+
+    // Raw PCM keeps encoding out of the measurement, so that most of the CPU time is spent in TLS and framing
+    MIMIIO_OPEN_OPTIONS options;
+    mimi_open_options_default(&options);
+    options.host = host.c_str();
+    options.port = p.get<int>("port");
+    options.on_rx_callback = rxfunc;
+    options.format = MIMIIO_RAW_PCM;
+    options.samplingrate = p.get<int>("rate");
+    options.channels = 1;
+    options.request_headers = h;
+    options.request_headers_len = 1;
+    options.access_token = token.c_str();
+
+    const int streams = p.get<int>("streams");
+    std::vector<MIMI_IO *> mios;
+    std::vector<int> results(streams, 0);
+    int offloaded = 0;
+    for (int i = 0; i < streams; ++i) {
+        options.userdata_for_rx = &results[i];
+        MIMI_IO *mio = mimi_open_ex(&options, &errorno);
+        if (mio == nullptr) {
+            std::cerr << "mimi_open_ex() failed: " << mimi_strerror(errorno) << " (" << errorno << ")" << std::endl;
+            break;
+        }
+        mimi_set_native_framing(mio, true); // frames are written to the socket directly if TX is offloaded
+        if (mimi_tls_offload(mio) & MIMIIO_TLS_OFFLOAD_TX) {
+            ++offloaded;
+        }
+        mios.push_back(mio);
+    }
+    for (MIMI_IO *mio : mios) {
+        mimi_start(mio);
+    }
+
+    // Audio is written in chunks of 100 msec to all connections, only the streaming phase is measured
+    const size_t chunk = static_cast<size_t>(options.samplingrate * 2 / 10);
+    const double speed = p.get<double>("speed");
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const long long cpu_start = process_cpu_usec();
+    size_t dropped = 0;
+    for (size_t offset = 0, n = 0; offset < audio.size(); offset += chunk, ++n) {
+        const size_t len = std::min(chunk, audio.size() - offset);
+        for (MIMI_IO *mio : mios) {
+            if (mimi_write_audio(mio, audio.data() + offset, len - len % 2) != 0) {
+                ++dropped;
+            }
+        }
+        if (0 < speed) {
+            std::this_thread::sleep_until(start + std::chrono::microseconds(static_cast<long long>((n + 1) * 100000 / speed)));
+        }
+    }
+    for (MIMI_IO *mio : mios) {
+        mimi_end_audio(mio);
+    }
+    for (MIMI_IO *mio : mios) {
+        mimi_wait(mio, -1);
+    }
+    const long long cpu_usec = process_cpu_usec() - cpu_start;
+    const double wall_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int failed = 0;
+    for (MIMI_IO *mio : mios) {
+        if (mimi_error(mio) != 0) {
+            ++failed;
+        }
+        mimi_close(mio);
+    }
+
+    const double audio_sec = static_cast<double>(audio.size()) / (options.samplingrate * 2);
+    const int opened = static_cast<int>(mios.size());
+    std::cout << "offload requested : " << (init.tls_offload ? "yes" : "no") << std::endl;
+    std::cout << "streams           : " << opened << " (" << offloaded << " with kernel TLS TX, " << failed << " failed)" << std::endl;
+    std::cout << "audio per stream  : " << audio_sec << " sec, sent in " << wall_sec << " sec" << std::endl;
+    std::cout << "chunks dropped    : " << dropped << std::endl;
+    if (0 < opened) {
+        std::cout << "CPU per stream    : " << cpu_usec / 1000.0 / opened << " msec, "
+                  << cpu_usec / 1000.0 / opened / audio_sec << " msec per audio sec" << std::endl;
+    }
+    return failed == 0 && opened == streams ? 0 : 1;
+}
@@ -33,7 +33,6 @@
 #include <string>
 #include <cstring>
 #include <vector>
-#include <unistd.h>
 #include <signal.h>
 #include <syslog.h>
 
@@ -154,7 +153,8 @@ constexpr AFENTRY afmap[] =
                 {"MIMIIO_FLAC_6",            MIMIIO_FLAC_6},
                 {"MIMIIO_FLAC_7",            MIMIIO_FLAC_7},
                 {"MIMIIO_FLAC_8",            MIMIIO_FLAC_8},
-                {"MIMIIO_FLAC_PASS_THROUGH", MIMIIO_FLAC_PASS_THROUGH}
+                {"MIMIIO_FLAC_PASS_THROUGH", MIMIIO_FLAC_PASS_THROUGH},
+                {"MIMIIO_FLAC_ADAPTIVE",     MIMIIO_FLAC_ADAPTIVE}
         };
 
 bool parse_afstring(const std::string &afstring, MIMIIO_AUDIO_FORMAT *af) {
@@ -275,18 +275,15 @@ int main(int argc, char **argv) {
             std::cerr << "mimi connection is successfully started, decoding starts..." << std::endl;
         }
 
-        int usec = 100000; // 0.1sec, you should choose appropriate value
-        while (rec.isActive() && mimi_is_active(mio)) {
+        int wait_ms = 100; // 0.1sec, interval of checking the recorder and Ctrl+C, you should choose appropriate value
+        while (rec.isActive() && !mimi_wait(mio, wait_ms)) {
             if (interrupt_flag_ != 0) {
                 if (p.exist("verbose")) {
                     std::cerr << "Waiting for fixed result..." << std::endl;
                 }
                 rec.stop();
-                while (mimi_is_active(mio)) {
-                    usleep(usec);
-                }
+                mimi_wait(mio, -1); // wakes up as soon as the stream ends
             }
-            usleep(usec);
         }
         if (p.exist("verbose")) {
             std::cerr << "Stream is to be finished." << std::endl;
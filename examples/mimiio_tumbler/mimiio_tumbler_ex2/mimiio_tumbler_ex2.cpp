@@ -200,9 +200,7 @@ public:
     }
 
     void close() {
-        while (mimi_is_active(mio_)) {
-            usleep(1000000);
-        }
+        mimi_wait(mio_, -1);
         int errorno = mimi_error(mio_);
         if (errorno == -100) { // user defined.
             std::cerr << "An error occurred in mimii_tumbler_ex2, timed out for pop from queue." << std::endl;
@@ -283,7 +281,8 @@ constexpr AFENTRY afmap[] =
                 {"MIMIIO_FLAC_6",            MIMIIO_FLAC_6},
                 {"MIMIIO_FLAC_7",            MIMIIO_FLAC_7},
                 {"MIMIIO_FLAC_8",            MIMIIO_FLAC_8},
-                {"MIMIIO_FLAC_PASS_THROUGH", MIMIIO_FLAC_PASS_THROUGH}
+                {"MIMIIO_FLAC_PASS_THROUGH", MIMIIO_FLAC_PASS_THROUGH},
+                {"MIMIIO_FLAC_ADAPTIVE",     MIMIIO_FLAC_ADAPTIVE}
         };
 
 bool parse_afstring(const std::string &afstring, MIMIIO_AUDIO_FORMAT *af) {
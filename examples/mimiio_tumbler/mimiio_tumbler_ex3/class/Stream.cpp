@@ -192,7 +192,7 @@ void Stream::start() {
 
         // For monitoring connection
         while (stream_monitor_continue_.load()) {
-            if (!mimi_is_active(mio_)) {
+            if (mimi_wait(mio_, 100)) { // wakes up as soon as the stream ends
                 errorno_ = mimi_error(mio_);
                 if (errorno_ != 0) {
                     if (param_.verbose_) {
@@ -208,7 +208,6 @@ void Stream::start() {
                 stream_monitor_continue_ = false;
                 break;
             }
-            usleep(100000);
         }
     });
 }
@@ -238,7 +238,8 @@ constexpr AFENTRY afmap[] =
                 {"MIMIIO_FLAC_6",            MIMIIO_FLAC_6},
                 {"MIMIIO_FLAC_7",            MIMIIO_FLAC_7},
                 {"MIMIIO_FLAC_8",            MIMIIO_FLAC_8},
-                {"MIMIIO_FLAC_PASS_THROUGH", MIMIIO_FLAC_PASS_THROUGH}
+                {"MIMIIO_FLAC_PASS_THROUGH", MIMIIO_FLAC_PASS_THROUGH},
+                {"MIMIIO_FLAC_ADAPTIVE",     MIMIIO_FLAC_ADAPTIVE}
         };
 
 bool parse_afstring(const std::string &afstring, MIMIIO_AUDIO_FORMAT *af) {
@@ -0,0 +1,117 @@
+/**
+ * @file convert.cpp
+ * @brief Conversion of 16bit PCM samples for encoders
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "encoder/convert.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define MIMIIO_CONVERT_X86 1
+#include <immintrin.h>
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define MIMIIO_CONVERT_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace mimiio{ namespace encoder{
+
+namespace {
+
+typedef void (*WIDEN_FUNC_T)(int32_t*, const char*, size_t);
+
+/**
+ * @brief Convert the samples which are fewer than a vector, independent of the byte order of the CPU.
+ */
+inline void widen_tail(int32_t* dst, const char* src, size_t samples)
+{
+	for(size_t i=0;i<samples;++i){
+		dst[i] = static_cast<int16_t>(static_cast<uint16_t>(static_cast<unsigned char>(src[2*i+1]) << 8 | static_cast<unsigned char>(src[2*i])));
+	}
+}
+
+#ifdef MIMIIO_CONVERT_X86
+void widen_sse2(int32_t* dst, const char* src, size_t samples)
+{
+	size_t i = 0;
+	for(;i+8<=samples;i+=8){
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2*i));
+		// place each sample in the upper half of 32bit lanes, then shift arithmetically for sign extension
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+	}
+	widen_tail(dst + i, src + 2*i, samples - i);
+}
+
+__attribute__((target("avx2")))
+void widen_avx2(int32_t* dst, const char* src, size_t samples)
+{
+	size_t i = 0;
+	for(;i+16<=samples;i+=16){
+		__m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2*i));
+		__m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2*i + 16));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_cvtepi16_epi32(lo));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 8), _mm256_cvtepi16_epi32(hi));
+	}
+	widen_tail(dst + i, src + 2*i, samples - i);
+}
+#endif
+
+#ifdef MIMIIO_CONVERT_NEON
+void widen_neon(int32_t* dst, const char* src, size_t samples)
+{
+	size_t i = 0;
+	for(;i+8<=samples;i+=8){
+		int16x8_t v = vreinterpretq_s16_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(src + 2*i)));
+		vst1q_s32(dst + i, vmovl_s16(vget_low_s16(v)));
+		vst1q_s32(dst + i + 4, vmovl_s16(vget_high_s16(v)));
+	}
+	widen_tail(dst + i, src + 2*i, samples - i);
+}
+#endif
+
+struct WidenImplementation
+{
+	WIDEN_FUNC_T func;
+	const char* name;
+};
+
+WidenImplementation select_implementation()
+{
+#ifdef MIMIIO_CONVERT_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2")){
+		return WidenImplementation{ &widen_avx2, "avx2" };
+	}
+	return WidenImplementation{ &widen_sse2, "sse2" };
+#elif defined(MIMIIO_CONVERT_NEON)
+	return WidenImplementation{ &widen_neon, "neon" };
+#else
+	return WidenImplementation{ &widen_s16le_scalar, "scalar" };
+#endif
+}
+
+const WidenImplementation& implementation()
+{
+	static const WidenImplementation impl = select_implementation();
+	return impl;
+}
+
+}
+
+void widen_s16le(int32_t* dst, const char* src, size_t samples)
+{
+	implementation().func(dst, src, samples);
+}
+
+void widen_s16le_scalar(int32_t* dst, const char* src, size_t samples)
+{
+	widen_tail(dst, src, samples);
+}
+
+const char* widen_implementation()
+{
+	return implementation().name;
+}
+
+}}
@@ -0,0 +1,41 @@
+/**
+ * @file convert.hpp
+ * @brief Conversion of 16bit PCM samples for encoders
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_ENCODER_CONVERT_HPP__
+#define LIBMIMIIO_ENCODER_CONVERT_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mimiio{ namespace encoder{
+
+/**
+ * @brief Sign-extend little-endian 16bit samples to 32bit integers
+ *
+ * The implementation is selected at the first call according to the CPU: AVX2 or SSE2 on x86, NEON on little-endian ARM,
+ * otherwise scalar code.
+ *
+ * @param [out] dst converted samples, at least \e samples elements
+ * @param [in] src little-endian 16bit samples, need not be aligned
+ * @param [in] samples the number of samples
+ */
+void widen_s16le(int32_t* dst, const char* src, size_t samples);
+
+/**
+ * @brief Scalar implementation of widen_s16le(), used where no SIMD implementation is available and as the reference of benchmarks
+ */
+void widen_s16le_scalar(int32_t* dst, const char* src, size_t samples);
+
+/**
+ * @brief Get the name of the conversion implementation selected for this CPU
+ *
+ * @return "avx2", "sse2", "neon" or "scalar"
+ */
+const char* widen_implementation();
+
+}}
+
+#endif
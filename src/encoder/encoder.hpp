@@ -45,7 +45,7 @@ class Encoder
 {
 public:
 
-	typedef std::unique_ptr<Encoder> Ptr;
+	typedef std::shared_ptr<Encoder> Ptr;
 
 	/**
 	 * @brief C'tor
@@ -75,8 +75,20 @@ public:
 	 * @attention This function assumes \e input has little-endian.
 	 *
 	 * @param [in] input Raw PCM audio specified params in C'tor.
+	 * @param [in] len Length of input in bytes
 	 */
-	virtual void Encode(const std::vector<char>& input) = 0;
+	virtual void Encode(const char* input, size_t len) = 0;
+
+	/**
+	 * @brief Encode to the format
+	 * @attention This function assumes \e input has little-endian.
+	 *
+	 * @param [in] input Raw PCM audio specified params in C'tor.
+	 */
+	void Encode(const std::vector<char>& input)
+	{
+		Encode(input.data(), input.size());
+	}
 
 	/**
 	 * @brief Declare input finish and flush all internal buffer
@@ -86,16 +98,47 @@ public:
 	/**
 	 * @brief Get Encoded data and clear, default implementation.
 	 *
-	 * @param [out] output Encoded data.
+	 * @param [out] output Encoded data, appended to its end.
 	 */
 	virtual void GetEncodedData(std::vector<char>& output)
 	{
-		for(size_t i=0;i<encodedData_.size();++i){
-			output.push_back(encodedData_[i]);
-		}
+		output.insert(output.end(), encodedData_.begin(), encodedData_.end());
 		encodedData_.clear();
 	}
 
+	/**
+	 * @brief Move encoded data to \e output and clear, without copying.
+	 *
+	 * The previous content of \e output is discarded, and its storage is reused for the next encoded data,
+	 * so that passing the same vector each time keeps two buffers alternating without allocation.
+	 *
+	 * @param [in,out] output Encoded data.
+	 */
+	void SwapEncodedData(std::vector<char>& output)
+	{
+		output.clear();
+		output.swap(encodedData_);
+	}
+
+	/**
+	 * @brief Determine whether the encoded data is the same as the input
+	 *
+	 * The caller may send the input as is instead of calling Encode(), avoiding the copy.
+	 *
+	 * @return true for pass-through encoders
+	 */
+	virtual bool PassThrough() const { return false; }
+
+	/**
+	 * @brief Report encoded data sent to the remote host, for encoders adapting to the network
+	 *
+	 * May be called on another thread than Encode(), default implementation does nothing.
+	 *
+	 * @param [in] bytes length of data sent
+	 * @param [in] usec time blocked in sending in microseconds
+	 */
+	virtual void Sent(size_t bytes, long usec) {}
+
 protected:
 
 	int samplingrate_;
@@ -6,26 +6,135 @@
  */
 
 #include "encoder/flac.hpp"
+#include "encoder/convert.hpp"
 #include <Poco/Format.h>
-#include <Poco/Mutex.h>
-#include <Poco/ScopedLock.h>
+#include <algorithm>
+#include <cstdint>
 
 namespace mimiio{ namespace encoder{
 
+namespace {
+
+/**
+ * @brief CRC-8 (polynomial 0x07) of FLAC frame headers and CRC-16 (polynomial 0x8005) of FLAC frames
+ */
+struct FrameCRC
+{
+	FrameCRC()
+	{
+		for(unsigned int i=0;i<256;++i){
+			uint8_t c8 = static_cast<uint8_t>(i);
+			uint16_t c16 = static_cast<uint16_t>(i << 8);
+			for(int bit=0;bit<8;++bit){
+				c8 = static_cast<uint8_t>((c8 & 0x80) ? (c8 << 1) ^ 0x07 : (c8 << 1));
+				c16 = static_cast<uint16_t>((c16 & 0x8000) ? (c16 << 1) ^ 0x8005 : (c16 << 1));
+			}
+			crc8[i] = c8;
+			crc16[i] = c16;
+		}
+	}
+	uint8_t crc8[256];
+	uint16_t crc16[256];
+};
+
+const FrameCRC& frame_crc()
+{
+	static const FrameCRC table;
+	return table;
+}
+
+/**
+ * @brief Append a frame of a fixed-blocksize stream with \e offset added to its frame number
+ *
+ * The frame number is coded in UTF-8 like form of 1 to 6 bytes, so the header may change its length, and both CRCs are computed again.
+ */
+void append_renumbered(const unsigned char* frame, size_t bytes, unsigned long offset, std::vector<char>& output)
+{
+	if(bytes < 7 || (frame[1] & 0x01) != 0){
+		throw EncoderProcessException("Only frames of fixed-blocksize stream can be renumbered.");
+	}
+	// frame number
+	size_t pos = 4;
+	int n = 0; // leading 1 bits of the first byte, the number of bytes
+	while(n < 8 && (frame[pos] & (0x80 >> n)) != 0){
+		++n;
+	}
+	if(n == 1 || 6 < n || bytes < pos + n){
+		throw EncoderProcessException("Invalid frame number of flac frame.");
+	}
+	n = std::max(n, 1);
+	uint64_t number = frame[pos] & (n == 1 ? 0x7F : (0x7F >> n));
+	for(int i=1;i<n;++i){
+		number = (number << 6) | (frame[pos + i] & 0x3F);
+	}
+	pos += n;
+	// optional block size and sample rate, followed by CRC-8
+	const int bs = frame[2] >> 4;
+	const int sr = frame[2] & 0x0F;
+	const size_t extra = (bs == 6 ? 1 : bs == 7 ? 2 : 0) + (sr == 12 ? 1 : (sr == 13 || sr == 14) ? 2 : 0);
+	if(bytes < pos + extra + 3){
+		throw EncoderProcessException("Truncated flac frame.");
+	}
+
+	unsigned char coded[7];
+	number += offset;
+	int m = 1;
+	if(number < 0x80){
+		coded[0] = static_cast<unsigned char>(number);
+	}else{
+		m = number < 0x800 ? 2 : number < 0x10000 ? 3 : number < 0x200000 ? 4 : number < 0x4000000 ? 5 : 6;
+		coded[0] = static_cast<unsigned char>((0xFF00 >> m) & 0xFF) | static_cast<unsigned char>(number >> (6 * (m - 1)));
+		for(int i=1;i<m;++i){
+			coded[i] = static_cast<unsigned char>(0x80 | ((number >> (6 * (m - 1 - i))) & 0x3F));
+		}
+	}
+
+	const size_t begin = output.size();
+	output.insert(output.end(), frame, frame + 4);
+	output.insert(output.end(), coded, coded + m);
+	output.insert(output.end(), frame + pos, frame + pos + extra);
+	const FrameCRC& crc = frame_crc();
+	uint8_t c8 = 0;
+	for(size_t i=begin;i<output.size();++i){
+		c8 = crc.crc8[c8 ^ static_cast<uint8_t>(output[i])];
+	}
+	output.push_back(static_cast<char>(c8));
+	output.insert(output.end(), frame + pos + extra + 1, frame + bytes - 2);
+	uint16_t c16 = 0;
+	for(size_t i=begin;i<output.size();++i){
+		c16 = static_cast<uint16_t>((c16 << 8) ^ crc.crc16[(c16 >> 8) ^ static_cast<uint8_t>(output[i])]);
+	}
+	output.push_back(static_cast<char>(c16 >> 8));
+	output.push_back(static_cast<char>(c16 & 0xFF));
+}
+
+}
+
 FlacEncoderImpl::FlacEncoderImpl(
 		int samplingrate,
 		int channels,
 		int compressionLevel,
-		Poco::Logger& logger) :
+		unsigned int blocksize,
+		std::vector<char>& output,
+		Poco::Logger& logger,
+		const FlacEncoderImpl* previous) :
 		FLAC::Encoder::Stream(),
-		logger_(logger)
+		output_(output),
+		logger_(logger),
+		continued_(previous != nullptr),
+		frameOffset_(previous != nullptr ? previous->frameOffset_ + previous->frames_ : 0),
+		frames_(0)
 {
 	set_verify(false); // Do not verify encoded data. The verification process cause performance to be double slow.
 	set_compression_level(compressionLevel); // Compression Level see mimiio.h enum ::MIMIIO_AUDIO_FORMAT
+	if(blocksize != 0){
+		set_blocksize(blocksize); // after the compression level, which sets its own block size
+	}
 	set_channels(channels);
 	set_bits_per_sample(16); // Fixed to 16bit depth
 	set_sample_rate(samplingrate);
-	logger_.debug("lmio: FlacEncoderImpl: compressionLevel=%d, channels=%d, samplerate=%d", compressionLevel, channels, samplingrate);
+	logger_.debug("lmio: FlacEncoderImpl: compressionLevel=%d, channels=%d, samplerate=%d, blocksize=%u, first frame=%lu",
+			compressionLevel, channels, samplingrate, get_blocksize(), frameOffset_);
 	FLAC__StreamEncoderInitStatus init_status = init();
 	if(init_status != FLAC__STREAM_ENCODER_INIT_STATUS_OK){
 		std::string errstr = FLAC__StreamEncoderInitStatusString[init_status];
@@ -44,35 +153,49 @@ FLAC__StreamEncoderWriteStatus FlacEncoderImpl::write_callback(
 		unsigned int samples,
 		unsigned int current_frame)
 {
-	Poco::Mutex::ScopedLock lock(mutex_);
-	for(size_t i=0;i<bytes;++i){
-		encodedData_.push_back(buffer[i]);
+	if(samples == 0 && continued_){
+		return FLAC__STREAM_ENCODER_WRITE_STATUS_OK; // metadata of the continued stream has been written
+	}
+	if(samples != 0){
+		++frames_;
+		if(frameOffset_ != 0){
+			try{
+				append_renumbered(buffer, bytes, frameOffset_, output_);
+			}catch(const std::exception &e){
+				logger_.error("lmio: FlacEncoderImpl: %s", std::string(e.what()));
+				return FLAC__STREAM_ENCODER_WRITE_STATUS_FATAL_ERROR;
+			}
+			return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+		}
 	}
+	const char* data = reinterpret_cast<const char*>(buffer);
+	output_.insert(output_.end(), data, data + bytes);
 	return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
 }
 
-void FlacEncoderImpl::GetEncodedData(std::vector<char>& encodedData)
+unsigned int FlacEncoder::blocksize(int samplingrate, int compressionLevel, int latencyMs)
 {
-	Poco::Mutex::ScopedLock lock(mutex_);
-	for(size_t i=0;i<encodedData_.size();++i){
-		encodedData.push_back(static_cast<char>(encodedData_[i]));
+	if(latencyMs <= 0){
+		return 0;
 	}
-	encodedData_.clear();
+	const long long levelBlocksize = compressionLevel < 3 ? 1152 : 4096; // see FLAC__stream_encoder_set_compression_level()
+	const long long limit = std::max(static_cast<long long>(samplingrate) * latencyMs / 1000, 16LL); // minimum block size of FLAC
+	return limit < levelBlocksize ? static_cast<unsigned int>(limit) : 0;
 }
 
-void FlacEncoder::Encode(const std::vector<char>& input)
+void FlacEncoder::Encode(const char* input, size_t len)
 {
-	if(input.size() % (impl_->get_bits_per_sample() / 8) != 0){ //1byte == 8bit
+	if(len % (impl_->get_bits_per_sample() / 8) != 0){ //1byte == 8bit
 		throw EncoderProcessException("The length of encoder input is not multiple of bits per sample.");
 	}
-	logger_.debug("lmio: FlacEncoder: Encode input size = %d bytes", static_cast<int>(input.size()));
-	size_t pcm_samples = input.size() / (impl_->get_bits_per_sample() / 8); //1byte == 8bit
-	std::unique_ptr<FLAC__int32[]> pcm(new FLAC__int32[pcm_samples]);
-	for(size_t i=0;i<pcm_samples;++i){
-		pcm[i] = (FLAC__int32)(((FLAC__int16)(FLAC__int8)static_cast<unsigned char>(input[2*i+1]) << 8) | (FLAC__int16)static_cast<unsigned char>(input[2*i]));
+	logger_.debug("lmio: FlacEncoder: Encode input size = %d bytes", static_cast<int>(len));
+	size_t pcm_samples = len / (impl_->get_bits_per_sample() / 8); //1byte == 8bit
+	if(pcm_.size() < pcm_samples){
+		pcm_.resize(pcm_samples); // grows to the largest input, never shrinks
 	}
+	widen_s16le(pcm_.data(), input, pcm_samples);
 
-	impl_->process_interleaved(pcm.get(), pcm_samples /  impl_->get_channels());
+	impl_->process_interleaved(pcm_.data(), pcm_samples /  impl_->get_channels());
 }
 
 void FlacEncoder::Flush()
@@ -80,11 +203,6 @@ void FlacEncoder::Flush()
 	impl_->finish();
 }
 
-void FlacEncoder::GetEncodedData(std::vector<char>& output)
-{
-	impl_->GetEncodedData(output);
-}
-
 }}
 
 
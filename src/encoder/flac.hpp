@@ -13,7 +13,6 @@
 #include <FLAC++/encoder.h>
 #include <memory>
 #include <vector>
-#include <Poco/Mutex.h>
 #include <Poco/Format.h>
 
 namespace mimiio{ namespace encoder{
@@ -34,8 +33,12 @@ public:
 	 * @param [in] samplingrate Samplingrate of audio
 	 * @param [in] channels Channels of audio
 	 * @param [in] compressioLevel Compression level of the audio format
+	 * @param [in] blocksize Block size in samples, 0 for the default of \e compressionLevel.
+	 * @param [out] output Encoded data is appended, which must outlive this encoder.
+	 * @param [in] previous Encoder whose stream is continued, or NULL to start a new stream. It must have been flushed after
+	 *             a multiple of \e blocksize samples, and have the same parameters except \e compressionLevel.
 	 */
-	FlacEncoderImpl(int samplingrate, int channels, int compressionLevel, Poco::Logger& logger);
+	FlacEncoderImpl(int samplingrate, int channels, int compressionLevel, unsigned int blocksize, std::vector<char>& output, Poco::Logger& logger, const FlacEncoderImpl* previous = nullptr);
 
 	/**
 	 * @brief D'tor
@@ -52,24 +55,22 @@ public:
 	 */
 	void Flush() { finish(); }
 
-	/**
-	 * @brief Get Encoded data and clear.
-	 *
-	 * @param [out] output Encoded data.
-	 */
-	void GetEncodedData(std::vector<char>& encodedData);
-
 protected:
 	/**
 	 * @brief flac stream encoder write callback
+	 *
+	 * Called only inside process_interleaved() and finish() on the thread encoding, so \e output is not locked.
+	 * When the stream of another encoder is continued, metadata is dropped and frames are renumbered after its frames.
 	 */
 	virtual FLAC__StreamEncoderWriteStatus write_callback(const FLAC__byte* buffer, size_t bytes, unsigned int samples, unsigned int current_frame);
 
 private:
 
-	Poco::Mutex mutex_;
-	std::vector<FLAC__byte> encodedData_; // FLAC__byte is usually "unsigned char"
+	std::vector<char>& output_;
 	Poco::Logger& logger_;
+	bool continued_;              // the stream header has been written by the previous encoder
+	unsigned long frameOffset_;   // added to frame numbers
+	unsigned long frames_;        // frames written by this encoder
 };
 
 /**
@@ -86,12 +87,26 @@ public:
 	 * @param [in] samplingrate Samplingrate of audio
 	 * @param [in] channels Channels of audio
 	 * @param [in] compressioLevel Compression level of the audio format
+	 * @param [in] blocksize Block size in samples, 0 for the default of \e compressionLevel.
 	 */
-	FlacEncoder(int samplingrate, int channels, int compressionLevel, Poco::Logger& logger) :
+	FlacEncoder(int samplingrate, int channels, int compressionLevel, unsigned int blocksize, Poco::Logger& logger) :
 		Encoder(samplingrate, channels, compressionLevel, logger),
-		impl_(new FlacEncoderImpl(samplingrate, channels, compressionLevel, logger))
+		impl_(new FlacEncoderImpl(samplingrate, channels, compressionLevel, blocksize, encodedData_, logger))
 	{}
 
+	/**
+	 * @brief Block size holding at most \e latencyMs of audio
+	 *
+	 * A frame is written when the first sample of the next block is given, so audio is held by the encoder for the time
+	 * of one block at most, plus the time until the next input.
+	 *
+	 * @param [in] samplingrate Samplingrate of audio
+	 * @param [in] compressionLevel Compression level, whose default block size is the upper limit.
+	 * @param [in] latencyMs milliseconds, 0 for no limit.
+	 * @return block size in samples, 0 if the default of \e compressionLevel is within the limit.
+	 */
+	static unsigned int blocksize(int samplingrate, int compressionLevel, int latencyMs);
+
 	/**
 	 * @brief Get Content-Type string
 	 *
@@ -103,26 +118,21 @@ public:
 	 * @brief Encode to the format
 	 *
 	 * @param [in] input Raw PCM audio specified params in C'tor.
-	 * @param [out] output Encoded audio.
-	 * @param [in] finish Flag for final input.
+	 * @param [in] len Length of input in bytes
 	 */
-	virtual void Encode(const std::vector<char>& input);
+	virtual void Encode(const char* input, size_t len);
+
+	using Encoder::Encode;
 
 	/**
 	 * @brief Declare input finish and flush all internal buffer
 	 */
 	virtual void Flush();
 
-	/**
-	 * @brief Get Encoded data and clear
-	 *
-	 * @param [out] output Encoded data
-	 */
-	virtual void GetEncodedData(std::vector<char>& output);
-
 private:
 
 	FlacEncoderImpl::Ptr impl_;
+	std::vector<FLAC__int32> pcm_; // reused for conversion to FLAC__int32 samples, see widen_s16le()
 
 };
 
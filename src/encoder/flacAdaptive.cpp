@@ -0,0 +1,138 @@
+/**
+ * @file flacAdaptive.cpp
+ * @brief Flac encoder adapting its compression level to CPU and network
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "encoder/flacAdaptive.hpp"
+#include "encoder/convert.hpp"
+#include <Poco/Clock.h>
+#include <algorithm>
+#include <time.h>
+
+namespace mimiio{ namespace encoder{
+
+namespace {
+
+const double cpu_high_ = 0.20;  // encoding takes 20% of audio time on one core
+const double cpu_low_ = 0.05;   // encoding has room for more effort
+const double send_high_ = 0.25; // sending is blocked for 25% of audio time
+const double send_low_ = 0.05;  // the network has room
+
+/**
+ * @brief CPU time of the calling thread in microseconds, or monotonic time if not available
+ */
+long long thread_cpu_usec()
+{
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+	struct timespec ts;
+	if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0){
+		return static_cast<long long>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+	}
+#endif
+	return Poco::Clock().microseconds();
+}
+
+/**
+ * @brief Block size of all levels, limited by latency
+ */
+unsigned int adaptive_blocksize(int samplingrate, int latencyMs)
+{
+	unsigned int blocksize = FlacEncoder::blocksize(samplingrate, FlacAdaptiveEncoder::maximum_level_, latencyMs);
+	if(blocksize == 0){
+		blocksize = FlacAdaptiveEncoder::default_blocksize_;
+	}
+	return blocksize;
+}
+
+}
+
+FlacAdaptiveEncoder::FlacAdaptiveEncoder(int samplingrate, int channels, int latencyMs, Poco::Logger& logger) :
+		Encoder(samplingrate, channels, initial_level_, logger),
+		blocksize_(adaptive_blocksize(samplingrate, latencyMs)),
+		impl_(new FlacEncoderImpl(samplingrate, channels, initial_level_, blocksize_, encodedData_, logger)),
+		blockFill_(0),
+		windowSamples_(0),
+		cpuUsec_(0),
+		sendUsec_(0),
+		sentBytes_(0)
+{
+}
+
+void FlacAdaptiveEncoder::Encode(const char* input, size_t len)
+{
+	if(len % 2 != 0){
+		throw EncoderProcessException("The length of encoder input is not multiple of bits per sample.");
+	}
+	size_t pcm_samples = len / 2;
+	if(pcm_.size() < pcm_samples){
+		pcm_.resize(pcm_samples); // grows to the largest input, never shrinks
+	}
+	widen_s16le(pcm_.data(), input, pcm_samples);
+
+	const FLAC__int32* pcm = pcm_.data();
+	size_t frames = pcm_samples / channels_;
+	long long start = thread_cpu_usec();
+	while(frames != 0){
+		size_t n = std::min<size_t>(frames, blocksize_ - blockFill_); // stop at the block boundary, where the level may change
+		impl_->process_interleaved(pcm, static_cast<unsigned int>(n));
+		pcm += n * channels_;
+		frames -= n;
+		blockFill_ += static_cast<unsigned int>(n);
+		if(blockFill_ == blocksize_){
+			blockFill_ = 0;
+			windowSamples_ += blocksize_;
+			if(static_cast<long long>(window_usec_) * samplingrate_ <= static_cast<long long>(windowSamples_) * 1000000){
+				long long now = thread_cpu_usec();
+				cpuUsec_ += now - start;
+				start = now;
+				adapt();
+			}
+		}
+	}
+	cpuUsec_ += thread_cpu_usec() - start;
+}
+
+void FlacAdaptiveEncoder::Flush()
+{
+	impl_->finish();
+}
+
+void FlacAdaptiveEncoder::Sent(size_t bytes, long usec)
+{
+	sendUsec_ += usec;
+	sentBytes_ += bytes;
+}
+
+void FlacAdaptiveEncoder::adapt()
+{
+	const double audioUsec = static_cast<double>(windowSamples_) * 1000000 / samplingrate_;
+	const double cpuLoad = cpuUsec_ / audioUsec;
+	const double sendLoad = sendUsec_.exchange(0) / audioUsec;
+	const unsigned long long sent = sentBytes_.exchange(0);
+	windowSamples_ = 0;
+	cpuUsec_ = 0;
+
+	int level = compressionLevel_;
+	if(cpu_high_ < cpuLoad && 0 < level){
+		--level; // encoding can not keep up, compression does not help
+	}else if(send_high_ < sendLoad && cpuLoad < cpu_low_ && level < maximum_level_){
+		++level; // the network is the bottleneck and the CPU has room
+	}else if(sendLoad < send_low_ && cpu_low_ < cpuLoad && 0 < level){
+		--level; // the network has room, save CPU
+	}
+	poco_debug_f4(logger_, "lmio: FlacAdaptiveEncoder: cpu=%.3f, send=%.3f, sent=%lu bytes, level=%d",
+			cpuLoad, sendLoad, static_cast<unsigned long>(sent), level);
+	if(level == compressionLevel_){
+		return;
+	}
+
+	// The current block has been given but not encoded yet, it is written as a full frame by finish().
+	impl_->finish();
+	FlacEncoderImpl::Ptr next(new FlacEncoderImpl(samplingrate_, channels_, level, blocksize_, encodedData_, logger_, impl_.get()));
+	impl_.swap(next);
+	logger_.information("lmio: FlacAdaptiveEncoder: compression level %d -> %d", compressionLevel_, level);
+	compressionLevel_ = level;
+}
+
+}}
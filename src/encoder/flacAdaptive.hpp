@@ -0,0 +1,96 @@
+/**
+ * @file flacAdaptive.hpp
+ * @brief Flac encoder adapting its compression level to CPU and network
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef MIMIIO_FLACADAPTIVE_HPP_
+#define MIMIIO_FLACADAPTIVE_HPP_
+
+#include "encoder/flac.hpp"
+#include <atomic>
+
+namespace mimiio{ namespace encoder{
+
+/**
+ * @class FlacAdaptiveEncoder
+ * @brief Flac encoder which moves its compression level between blocks of one stream
+ *
+ * The compression level only changes the effort of the encoder, not the stream format, so a new libFLAC encoder at
+ * the next level continues the stream from a block boundary: its metadata is dropped and its frames are renumbered.
+ * All levels use the same block size, 4096 samples or less if limited by latency.
+ *
+ * For every window of audio, CPU time of encoding per audio time and time blocked in sending per audio time are
+ * compared with thresholds. The level goes down if encoding is heavy, or if the network has room while encoding is
+ * not light. It goes up if sending is the bottleneck while encoding is light.
+ */
+class FlacAdaptiveEncoder : public Encoder
+{
+public:
+
+	static const int initial_level_ = 5;
+	static const int maximum_level_ = 8;
+	static const unsigned int default_blocksize_ = 4096; //!< default of levels 3 to 8, 256 msec at 16kHz
+	static const long window_usec_ = 2000000;     //!< audio time between decisions
+
+	/**
+	 * @brief C'tor
+	 *
+	 * @param [in] samplingrate Samplingrate of audio
+	 * @param [in] channels Channels of audio
+	 * @param [in] latencyMs Limit of audio held by the encoder in milliseconds, see FlacEncoder::blocksize(). 0 for no limit.
+	 */
+	FlacAdaptiveEncoder(int samplingrate, int channels, int latencyMs, Poco::Logger& logger);
+
+	/**
+	 * @brief Get Content-Type string
+	 *
+	 * @return Returns Content-Type string
+	 */
+	virtual std::string ContentType() { return Poco::format("audio/x-flac;bit=16;rate=%d;channels=%d", samplingrate_, channels_); }
+
+	/**
+	 * @brief Encode to the format, the level may be changed at block boundaries.
+	 *
+	 * @param [in] input Raw PCM audio specified params in C'tor.
+	 * @param [in] len Length of input in bytes
+	 */
+	virtual void Encode(const char* input, size_t len);
+
+	using Encoder::Encode;
+
+	/**
+	 * @brief Declare input finish and flush all internal buffer
+	 */
+	virtual void Flush();
+
+	/**
+	 * @brief Accumulate time blocked in sending for the next decision
+	 */
+	virtual void Sent(size_t bytes, long usec);
+
+	/**
+	 * @brief Get the current compression level
+	 */
+	int Level() const { return compressionLevel_; }
+
+private:
+
+	/**
+	 * @brief Decide the level at the end of a window, called at a block boundary.
+	 */
+	void adapt();
+
+	unsigned int blocksize_;        // same for all levels to keep STREAMINFO valid
+	FlacEncoderImpl::Ptr impl_;
+	std::vector<FLAC__int32> pcm_;
+	unsigned int blockFill_;        // samples per channel in the current block
+	unsigned long windowSamples_;   // samples per channel encoded in the window
+	long long cpuUsec_;             // CPU time of encoding in the window
+	std::atomic<long long> sendUsec_;
+	std::atomic<unsigned long long> sentBytes_;
+};
+
+}}
+
+#endif /* MIMIIO_FLACADAPTIVE_HPP_ */
@@ -42,14 +42,20 @@ public:
 	 * @brief Encode to the format
 	 *
 	 * @param [in] input Raw PCM audio specified params in C'tor.
+	 * @param [in] len Length of input in bytes
 	 */
-	virtual void Encode(const std::vector<char>& input)
+	virtual void Encode(const char* input, size_t len)
 	{
-		for(size_t i=0;i<input.size();++i){
-			encodedData_.push_back(input[i]);
-		}
+		encodedData_.insert(encodedData_.end(), input, input + len);
 	}
 
+	using Encoder::Encode;
+
+	/**
+	 * @brief Input is sent as is without Encode()
+	 */
+	virtual bool PassThrough() const { return true; }
+
 	/**
 	 * @brief Declare input finish and flush all internal buffer
 	 */
@@ -12,7 +12,14 @@
 #include "mimiioController.hpp"
 #include "mimiioSynchronousAPIController.hpp"
 #include "mimiioAsynchronousCallbackAPIController.hpp"
+#include "mimiioEventLoopController.hpp"
+#include "mimiioCooperativeController.hpp"
+#include "mimiioRuntime.hpp"
 #include "mimiioImpl.hpp"
+#include "mimiioSSLContext.hpp"
+#include "mimiioConnectionPool.hpp"
+#include "mimiioOpenRequest.hpp"
+#include "mimiioConnectStats.hpp"
 #include "mimiioEncoderFactory.hpp"
 #include <Poco/Logger.h>
 #include <Poco/AutoPtr.h>
@@ -26,6 +33,10 @@
 #include <Poco/PatternFormatter.h>
 #include <Poco/FormattingChannel.h>
 #include <Poco/AsyncChannel.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
 #include <memory>
 #include <mutex>
 
@@ -49,6 +60,104 @@ static void set_logger_properties(Poco::Logger& logger, int level) {
 	logger.setLevel(level);
 }
 
+static Poco::Logger& get_logger(int loglevel)
+{
+	static std::once_flag flag;
+	Poco::Logger& logger = Poco::Logger::get(PACKAGE_NAME);
+	std::call_once(flag, set_logger_properties, logger, loglevel);
+	return logger;
+}
+
+static std::vector<MIMIIO_HTTP_REQUEST_HEADER> make_request_headers(
+		mimiio::mimiioEncoderFactory& encoderFactory,
+		MIMIIO_AUDIO_FORMAT format,
+		int samplingrate,
+		int channels,
+		const MIMIIO_HTTP_REQUEST_HEADER* request_headers,
+		int request_headers_len)
+{
+	// Create encoder
+	mimiio::encoder::Encoder* encoder = encoderFactory.createEncoder(format, samplingrate, channels);
+	// Create request header
+	std::vector<MIMIIO_HTTP_REQUEST_HEADER> requestHeaders;
+	for(int i=0;i<request_headers_len;++i){
+		requestHeaders.push_back(request_headers[i]);
+	}
+	MIMIIO_HTTP_REQUEST_HEADER contentType;
+	std::strcpy(contentType.key, "X-Mimi-Content-Type");
+	std::strcpy(contentType.value, encoder->ContentType().c_str());
+	requestHeaders.push_back(contentType);
+	// delete encoder (re-create in mimiioController)
+	delete encoder;
+	return requestHeaders;
+}
+
+void mimi_init_options_default(MIMIIO_INIT_OPTIONS* options)
+{
+	options->version = MIMIIO_INIT_OPTIONS_VERSION;
+	options->io_backend = MIMIIO_IO_BACKEND_THREAD;
+	options->io_threads = 0;
+	options->tls_offload = false;
+	options->worker_threads = 0;
+	options->encoder_threads = 0;
+}
+
+int mimi_init(const MIMIIO_INIT_OPTIONS* options)
+{
+	return mimiio::mimiioRuntime::instance().init(*options);
+}
+
+static bool check_open_options(const MIMIIO_OPEN_OPTIONS& options)
+{
+	return options.host != nullptr
+			&& 0 < options.send_buffer_size && 0 < options.push_buffer_size
+			&& 0 < options.connect_timeout_ms && 0 < options.send_timeout_ms && 0 < options.recv_timeout_ms
+			&& 0 < options.tx_idle_sleep_ms
+			&& 0 <= options.thread_stack_size
+			&& -2 <= options.thread_priority && options.thread_priority <= 2
+			&& 0 <= options.flac_latency_ms;
+}
+
+void mimi_open_options_default(MIMIIO_OPEN_OPTIONS* options)
+{
+	*options = MIMIIO_OPEN_OPTIONS();
+	options->version = MIMIIO_OPEN_OPTIONS_VERSION;
+	options->format = MIMIIO_RAW_PCM;
+	options->samplingrate = 16000;
+	options->channels = 1;
+	options->loglevel = MIMIIO_LOG_INFO;
+	options->send_buffer_size = mimiio::worker::mimiioTxWorker::default_buffer_size_;
+	options->push_buffer_size = mimiio::worker::mimiioPushSource::default_capacity_;
+	options->connect_timeout_ms = mimiio::mimiioImpl::default_timeout_msec_;
+	options->send_timeout_ms = mimiio::mimiioImpl::default_timeout_msec_;
+	options->recv_timeout_ms = mimiio::mimiioImpl::default_timeout_msec_;
+	options->tx_idle_sleep_ms = mimiio::worker::mimiioTxWorker::default_idle_sleep_msec_;
+	options->thread_stack_size = 0;
+	options->thread_priority = 0;
+	options->tx_cpu = -1;
+	options->rx_cpu = -1;
+	options->cooperative = false;
+	options->flac_latency_ms = 0;
+}
+
+/**
+ * @brief Copy the fields defined in the version of the caller, the others keep default values.
+ *
+ * @return false if the version is not supported or the options are invalid.
+ */
+static bool copy_open_options(const MIMIIO_OPEN_OPTIONS& options, MIMIIO_OPEN_OPTIONS& o)
+{
+	mimi_open_options_default(&o);
+	if(options.version == 1){
+		std::memcpy(&o, &options, offsetof(MIMIIO_OPEN_OPTIONS, cooperative));
+	}else if(options.version == 2){
+		std::memcpy(&o, &options, offsetof(MIMIIO_OPEN_OPTIONS, flac_latency_ms));
+	}else if(options.version == MIMIIO_OPEN_OPTIONS_VERSION){
+		o = options;
+	}
+	return o.version == options.version && check_open_options(o);
+}
+
 MIMI_IO* mimi_open(
 		const char* mimi_host,
 		int mimi_port,
@@ -65,138 +174,286 @@ MIMI_IO* mimi_open(
 		int loglevel,
 		int* errorno)
 {
-	static std::once_flag flag;
+	MIMIIO_OPEN_OPTIONS options;
+	mimi_open_options_default(&options);
+	options.host = mimi_host;
+	options.port = mimi_port;
+	options.on_tx_callback = on_tx_func;
+	options.on_rx_callback = on_rx_func;
+	options.userdata_for_tx = userdata_for_tx;
+	options.userdata_for_rx = userdata_for_rx;
+	options.format = format;
+	options.samplingrate = samplingrate;
+	options.channels = channels;
+	options.request_headers = request_headers;
+	options.request_headers_len = request_headers_len;
+	options.access_token = access_token;
+	options.loglevel = loglevel;
+	return mimi_open_ex(&options, errorno);
+}
+
+MIMI_IO* mimi_open_ex(const MIMIIO_OPEN_OPTIONS* options, int* errorno)
+{
 	Poco::Logger& logger = Poco::Logger::get(PACKAGE_NAME);
 	try{
-		std::call_once(flag, set_logger_properties, logger, loglevel);
-
-		// Create encoder
-		mimiio::mimiioEncoderFactory encoderFactory(logger);
-		mimiio::encoder::Encoder* encoder = encoderFactory.createEncoder(format, samplingrate, channels);
-		// Create request header
-		std::vector<MIMIIO_HTTP_REQUEST_HEADER> requestHeaders;
-		for(int i=0;i<request_headers_len;++i){
-			requestHeaders.push_back(request_headers[i]);
+		get_logger(options->loglevel);
+		MIMIIO_OPEN_OPTIONS o;
+		if(!copy_open_options(*options, o)){
+			*errorno = 915;
+			logger.fatal("lmio: mimi_open failed: %s (%d)", std::string(mimiio::strerror(*errorno)), *errorno);
+			return nullptr;
 		}
-		MIMIIO_HTTP_REQUEST_HEADER contentType;
-		std::strcpy(contentType.key, "X-Mimi-Content-Type");
-		std::strcpy(contentType.value, encoder->ContentType().c_str());
-		requestHeaders.push_back(contentType);
-		// delete encoder (re-create in mimiioController)
-		delete encoder;
-
-		//with/without authentication
-		mimiio::mimiioImpl* impl = nullptr;
-		if(access_token == nullptr){
+		mimiio::mimiioEncoderFactory encoderFactory(logger);
+		encoderFactory.setLatency(o.flac_latency_ms);
+		std::vector<MIMIIO_HTTP_REQUEST_HEADER> requestHeaders = make_request_headers(encoderFactory, o.format, o.samplingrate, o.channels, o.request_headers, o.request_headers_len);
+
+		//with/without authentication, take a pre-established connection from the pool if available
+		mimiio::mimiioImpl* impl = mimiio::mimiioConnectionPool::acquire(o.host, o.port, requestHeaders, o.access_token);
+		if(impl != nullptr){
+			poco_debug((logger), "lmio: mimi_open with pooled connection.");
+		}else if(o.access_token == nullptr){
 			poco_debug((logger), "lmio: mimi_open without authentication.");
-			impl = new mimiio::mimiioImpl(mimi_host, mimi_port, requestHeaders, (logger));
+			impl = new mimiio::mimiioImpl(o.host, o.port, requestHeaders, (logger), o.connect_timeout_ms);
 		}else{
 			poco_debug((logger), "lmio: mimi_open with authentication.");
-			impl = new mimiio::mimiioImpl(mimi_host, mimi_port, requestHeaders, access_token, (logger));
+			impl = new mimiio::mimiioImpl(o.host, o.port, requestHeaders, o.access_token, (logger), o.connect_timeout_ms);
+		}
+
+		//push API, audio is written by mimi_write_audio() or mimi_tx_acquire() and read by the tx worker in place.
+		std::unique_ptr<mimiio::worker::mimiioPushSource> push;
+		if(o.on_tx_callback == nullptr && o.on_rx_callback != nullptr){
+			poco_debug((logger), "lmio: using push API.");
+			const size_t frameBytes = o.format == MIMIIO_FLAC_PASS_THROUGH ? 1 : 2 * std::max(o.channels, 1); // 16bit PCM is written in whole frames
+			push.reset(new mimiio::worker::mimiioPushSource(o.push_buffer_size, frameBytes, logger));
 		}
 
 		//synchronous or asynchronous callback API
 		mimiio::mimiioController* ctrler = nullptr;
-		if(on_tx_func == nullptr || on_rx_func == nullptr){
+		if((o.on_tx_callback == nullptr && !push) || o.on_rx_callback == nullptr){
 			// hidden API, comment out in mimiio.h and mimiio.cpp
 			poco_debug((logger), "using synchronous API.");
-			ctrler = new mimiio::mimiioSynchronousAPIController(impl, encoderFactory.createEncoder(format, samplingrate, channels), (logger));
+			ctrler = new mimiio::mimiioSynchronousAPIController(impl, encoderFactory.createEncoder(o.format, o.samplingrate, o.channels), (logger));
+		}else if(o.cooperative){
+			poco_debug((logger), "using asynchronous callback API on the caller's loop.");
+			ctrler = new mimiio::mimiioCooperativeController(impl, encoderFactory.createEncoder(o.format, o.samplingrate, o.channels), o.on_tx_callback, o.on_rx_callback, o.userdata_for_tx, o.userdata_for_rx, (logger));
+		}else if(mimiio::mimiioRuntime::instance().options().io_backend != MIMIIO_IO_BACKEND_THREAD){
+			poco_debug((logger), "using asynchronous callback API on event loop.");
+			mimiio::reactor::mimiioEventLoop& loop = mimiio::mimiioRuntime::instance().reactor(logger).next();
+			ctrler = new mimiio::mimiioEventLoopController(impl, encoderFactory.createEncoder(o.format, o.samplingrate, o.channels), loop, o.on_tx_callback, o.on_rx_callback, o.userdata_for_tx, o.userdata_for_rx, (logger));
 		}else{
 			//poco_debug(logger, "using asynchronous callback API.");
-			ctrler = new mimiio::mimiioAsynchronousCallbackAPIController(impl, encoderFactory.createEncoder(format, samplingrate, channels), on_tx_func, on_rx_func, userdata_for_tx, userdata_for_rx, (logger));
+			ctrler = new mimiio::mimiioAsynchronousCallbackAPIController(impl, encoderFactory.createEncoder(o.format, o.samplingrate, o.channels), o.on_tx_callback, o.on_rx_callback, o.userdata_for_tx, o.userdata_for_rx, (logger));
 		}
 
 		MIMI_IO* mio = new MIMI_IO();
 		mio->mt_.reset(ctrler);
+		ctrler->configure(o);
+		if(push){
+			ctrler->setPushSource(push.release());
+		}
 		*errorno = 0;
 		return mio;
-	}catch(const Poco::Net::SSLContextException &e){
-		*errorno = 601; // SSL client context error
-		(logger).fatal("lmio: mimi_open failed: SSL connection failed, client context error.");
-		//(logger).getChannel()->close();
-		return nullptr;
-	}catch(const Poco::Net::InvalidCertificateException &e){
-		*errorno = 602; // SSL invalid certificate error
-		(logger).fatal("lmio: mimi_open failed: SSL connection failed, invalid certificate: %s",e.displayText());
-		//(logger).getChannel()->close();
-		return nullptr;
-	}catch(const Poco::Net::CertificateValidationException &e){
-		*errorno = 603; // SSL certificate validation error
-		(logger).fatal("lmio: mimi_open failed: SSL connection failed, server certificate validation error: %s", e.displayText());
-		//(logger).getChannel()->close();
-		return nullptr;
-	}catch(const Poco::Net::SSLConnectionUnexpectedlyClosedException &e){
-		*errorno = 604; // SSL unexpectedly connection closed.
-		(logger).fatal("lmio: mimi_open failed: SSL connection failed, ssl connection unexpectedly closed: %s", e.displayText());
-		//(logger).getChannel()->close();
-		return nullptr;
-	}catch(const Poco::Net::SSLException &e){
-		*errorno = 605; // SSL error, server certificate validation error
-		(logger).fatal("lmio: mimi_open failed: SSL connection failed: %s", e.displayText());
-		//(logger).getChannel()->close();
-		return nullptr;
-	}catch(const Poco::Net::WebSocketException &e){
-		*errorno = 800 + static_cast<int>(e.code()); // 800s' error
-		(logger).fatal("lmio: mimi_open failed: WebSocket exception: %s (%d)", std::string(mimiio::strerror(*errorno)), *errorno);
-		//(logger).getChannel()->close();
-		return nullptr;
-	}catch(const Poco::Net::HostNotFoundException &e){
-		*errorno = 701; // host not found
-		(logger).fatal("lmio: mimi_open failed: Host not found.");
-		//(logger).getChannel()->close();
-		return nullptr;
-	}catch(const Poco::Net::ConnectionRefusedException &e){
-		*errorno = 704; // connection refused by remote host
-		(logger).fatal("lmio: mimi_open failed: Connection refused by remote host.");
-		//(logger).getChannel()->close();
-		return nullptr;
-	}catch(const Poco::Net::ConnectionResetException &e){
-		*errorno = 705; // connection reset by peer, which means exceeded simultaneous processing limit.
-		(logger).fatal("lmio: mimi_open failed: Connection reset by peer, which means exceeded simultaneous processing limit.");
-		//(logger).getChannel()->close();
-		return nullptr;
-	}catch(const Poco::Net::NoMessageException &e){
-		//NoMessageException is often occurred when connection reset by peer.
-		*errorno = 705; // connection reset by peer, which means exceeded simultaneous processing limit.
-		(logger).fatal("lmio: mimi_open failed: Connection reset by peer(no msg), which means exceeded simultaneous processing limit.");
-		//(logger).getChannel()->close();
-		return nullptr;
-	}catch(const Poco::Net::NetException &e){
-		*errorno = 799; // undefined network error
-		(logger).fatal("lmio: mimi_open failed: %s",e.displayText());
-		//(logger).getChannel()->close();
-		return nullptr;
-	}catch(const Poco::TimeoutException &e){
-		*errorno = 703; // timed out for establishing connection
-		(logger).fatal("lmio: mimi_open failed: timed out. %s",e.displayText());
-		//(logger).getChannel()->close();
-		return nullptr;
-	}catch(const Poco::FileNotFoundException &e){
-		*errorno = 601; // SSL client context error
-		(logger).fatal("lmio: mimi_open failed: Client context error, client cert file not found.");
-		//(logger).getChannel()->close();
+	}catch(...){
+		*errorno = mimiio::open_errorno(logger, "mimi_open");
 		return nullptr;
-	}catch(const mimiio::encoder::EncoderInitException &e){
-		*errorno = 501;
-		(logger).fatal("lmio: mimi_open failed: Encoder initialization error: %s", e.what());
-		//(logger).getChannel()->close();
+	}
+}
+
+MIMI_OPEN_REQUEST* mimi_open_async(
+		const char* mimi_host,
+		int mimi_port,
+		void (*on_tx_func)(char* buffer, size_t* len, bool* recog_break, int* txfunc_error, void* userdata_for_tx),
+		void (*on_rx_func)(const char* result, size_t len, int* rxfunc_error, void* userdata_for_rx),
+		void* userdata_for_tx,
+		void* userdata_for_rx,
+		MIMIIO_AUDIO_FORMAT format,
+		int samplingrate,
+		int channels,
+		const MIMIIO_HTTP_REQUEST_HEADER* request_headers,
+		int request_headers_len,
+		const char* access_token,
+		int loglevel,
+		void (*on_open_func)(MIMI_IO* mio, int errorno, void* userdata_for_open),
+		void* userdata_for_open,
+		int* errorno)
+{
+	Poco::Logger& logger = Poco::Logger::get(PACKAGE_NAME);
+	try{
+		get_logger(loglevel);
+		// copy all parameters, caller's buffers may be released before the connection is opened.
+		const std::string host(mimi_host);
+		const std::vector<MIMIIO_HTTP_REQUEST_HEADER> headers(request_headers, request_headers + (request_headers != nullptr ? request_headers_len : 0));
+		const bool authenticate = (access_token != nullptr);
+		const std::string token(authenticate ? access_token : "");
+		mimiio::mimiioOpenRequest::OPENER_T opener = [=](int* open_errorno){
+			return mimi_open(host.c_str(), mimi_port, on_tx_func, on_rx_func, userdata_for_tx, userdata_for_rx,
+					format, samplingrate, channels, headers.empty() ? nullptr : headers.data(), static_cast<int>(headers.size()),
+					authenticate ? token.c_str() : nullptr, loglevel, open_errorno);
+		};
+		mimiio::mimiioOpenRequest::Ptr request = mimiio::mimiioOpenRequest::start(opener, on_open_func, userdata_for_open);
+		if(!request){
+			*errorno = 905;
+			logger.fatal("lmio: mimi_open_async failed: %s (%d)", std::string(mimiio::strerror(*errorno)), *errorno);
+			return nullptr;
+		}
+		MIMI_OPEN_REQUEST* handle = new MIMI_OPEN_REQUEST();
+		handle->request_ = request;
+		*errorno = 0;
+		return handle;
+	}catch(...){
+		*errorno = mimiio::open_errorno(logger, "mimi_open_async");
 		return nullptr;
-	}catch(const std::exception &e){
-		*errorno = 101; // unknown error
-		(logger).fatal("lmio: mimi_open failed: %s",std::string(e.what()));
-		//(logger).getChannel()->close();
+	}
+}
+
+MIMI_OPEN_REQUEST* mimi_open_async_ex(
+		const MIMIIO_OPEN_OPTIONS* options,
+		void (*on_open_func)(MIMI_IO* mio, int errorno, void* userdata_for_open),
+		void* userdata_for_open,
+		int* errorno)
+{
+	Poco::Logger& logger = Poco::Logger::get(PACKAGE_NAME);
+	try{
+		get_logger(options->loglevel);
+		MIMIIO_OPEN_OPTIONS o;
+		if(!copy_open_options(*options, o)){
+			*errorno = 915;
+			logger.fatal("lmio: mimi_open_async failed: %s (%d)", std::string(mimiio::strerror(*errorno)), *errorno);
+			return nullptr;
+		}
+		// copy all strings, caller's buffers may be released before the connection is opened.
+		const std::string host(o.host);
+		const std::vector<MIMIIO_HTTP_REQUEST_HEADER> headers(o.request_headers, o.request_headers + (o.request_headers != nullptr ? o.request_headers_len : 0));
+		const bool authenticate = (o.access_token != nullptr);
+		const std::string token(authenticate ? o.access_token : "");
+		mimiio::mimiioOpenRequest::OPENER_T opener = [=](int* open_errorno){
+			MIMIIO_OPEN_OPTIONS copied = o;
+			copied.host = host.c_str();
+			copied.request_headers = headers.empty() ? nullptr : headers.data();
+			copied.request_headers_len = static_cast<int>(headers.size());
+			copied.access_token = authenticate ? token.c_str() : nullptr;
+			return mimi_open_ex(&copied, open_errorno);
+		};
+		mimiio::mimiioOpenRequest::Ptr request = mimiio::mimiioOpenRequest::start(opener, on_open_func, userdata_for_open);
+		if(!request){
+			*errorno = 905;
+			logger.fatal("lmio: mimi_open_async failed: %s (%d)", std::string(mimiio::strerror(*errorno)), *errorno);
+			return nullptr;
+		}
+		MIMI_OPEN_REQUEST* handle = new MIMI_OPEN_REQUEST();
+		handle->request_ = request;
+		*errorno = 0;
+		return handle;
+	}catch(...){
+		*errorno = mimiio::open_errorno(logger, "mimi_open_async");
 		return nullptr;
+	}
+}
+
+bool mimi_open_async_poll(MIMI_OPEN_REQUEST* request, MIMI_IO** mio, int* errorno)
+{
+	return request->request_->poll(mio, errorno);
+}
+
+void mimi_open_async_cancel(MIMI_OPEN_REQUEST* request)
+{
+	request->request_->cancel();
+}
+
+void mimi_open_async_release(MIMI_OPEN_REQUEST* request)
+{
+	if(request != nullptr){
+		request->request_->cancel();
+		delete request;
+	}
+}
+
+MIMI_POOL* mimi_pool_open(
+		const char* mimi_host,
+		int mimi_port,
+		MIMIIO_AUDIO_FORMAT format,
+		int samplingrate,
+		int channels,
+		const MIMIIO_HTTP_REQUEST_HEADER* request_headers,
+		int request_headers_len,
+		const char* access_token,
+		int size,
+		int ttl_sec,
+		int loglevel,
+		int* errorno)
+{
+	Poco::Logger& logger = Poco::Logger::get(PACKAGE_NAME);
+	try{
+		get_logger(loglevel);
+		mimiio::mimiioEncoderFactory encoderFactory(logger);
+		std::vector<MIMIIO_HTTP_REQUEST_HEADER> requestHeaders = make_request_headers(encoderFactory, format, samplingrate, channels, request_headers, request_headers_len);
+		MIMI_POOL* pool = new MIMI_POOL();
+		pool->pool_.reset(new mimiio::mimiioConnectionPool(mimi_host, mimi_port, requestHeaders, access_token, size, ttl_sec, logger));
+		*errorno = 0;
+		return pool;
 	}catch(...){
-		*errorno = 101; // unknown error
-		(logger).fatal("lmio: mimi_open failed with unknown reason.");
-		//(logger).getChannel()->close();
+		*errorno = mimiio::open_errorno(logger, "mimi_pool_open");
 		return nullptr;
 	}
 }
 
+int mimi_pool_available(MIMI_POOL* pool)
+{
+	return pool->pool_->available();
+}
+
+int mimi_pool_error(MIMI_POOL* pool)
+{
+	return pool->pool_->errorno();
+}
+
+void mimi_pool_close(MIMI_POOL* pool)
+{
+	if(pool != nullptr){
+		delete pool;
+	}
+}
+
+int mimi_set_tx_coalescing(MIMI_IO* mio, size_t max_bytes, int max_delay_ms)
+{
+	return mio->mt_->setTxCoalescing(max_bytes, max_delay_ms);
+}
+
+int mimi_set_native_framing(MIMI_IO* mio, bool enable)
+{
+	return mio->mt_->setNativeFraming(enable);
+}
+
+int mimi_set_rx_dispatch(MIMI_IO* mio, size_t queue_length, MIMIIO_RX_OVERFLOW_POLICY policy)
+{
+	return mio->mt_->setRxDispatch(queue_length, policy);
+}
+
+int mimi_set_tx_pipeline(MIMI_IO* mio, size_t queue_length)
+{
+	return mio->mt_->setTxPipeline(queue_length);
+}
+
+int mimi_set_state_callback(MIMI_IO* mio, void (*on_state_change)(MIMI_IO* mio, MIMIIO_STREAM_STATE state, void* userdata), void* userdata)
+{
+	if(on_state_change == nullptr){
+		return mio->mt_->setStateListener(nullptr);
+	}
+	return mio->mt_->setStateListener([=](MIMIIO_STREAM_STATE state){ on_state_change(mio, state, userdata); });
+}
+
+int mimi_get_fd(MIMI_IO* mio)
+{
+	return mio->mt_->fd();
+}
+
 int mimi_start(MIMI_IO* mio)
 {
-	return mio->mt_->start();
+	int errorno = mio->mt_->start();
+	if(errorno == 0){
+		mio->mt_->reportState(); // workers may have reported it already
+	}
+	return errorno;
 }
 
 bool mimi_is_active(MIMI_IO* mio)
@@ -204,15 +461,94 @@ bool mimi_is_active(MIMI_IO* mio)
 	return mio->mt_->isActive();
 }
 
+int mimi_write_audio(MIMI_IO* mio, const char* data, size_t len)
+{
+	return mio->mt_->writeAudio(data, len);
+}
+
+int mimi_end_audio(MIMI_IO* mio)
+{
+	return mio->mt_->endAudio();
+}
+
+int mimi_tx_acquire(MIMI_IO* mio, char** ptr, size_t* capacity)
+{
+	return mio->mt_->txAcquire(ptr, capacity);
+}
+
+int mimi_tx_commit(MIMI_IO* mio, size_t len, bool recog_break)
+{
+	return mio->mt_->txCommit(len, recog_break);
+}
+
+bool mimi_wait(MIMI_IO* mio, int timeout_ms)
+{
+	return mio->mt_->wait(timeout_ms);
+}
+
+int mimi_step(MIMI_IO* mio, int timeout_ms)
+{
+	return mio->mt_->step(timeout_ms);
+}
+
+int mimi_step_poll(MIMI_IO* mio, int* fd, int* timeout_ms)
+{
+	bool writable = false;
+	return mimi_step_poll_ex(mio, fd, &writable, timeout_ms); // the timeout is bounded while writing, see stepPoll()
+}
+
+int mimi_step_poll_ex(MIMI_IO* mio, int* fd, bool* writable, int* timeout_ms)
+{
+	long timeout = -1;
+	int errorno = mio->mt_->stepPoll(fd, writable, &timeout);
+	if(errorno == 0){
+		*timeout_ms = static_cast<int>(std::min(timeout, static_cast<long>(std::numeric_limits<int>::max())));
+	}
+	return errorno;
+}
+
 MIMIIO_STREAM_STATE mimi_stream_state(MIMI_IO* mio)
 {
 	return mio->mt_->streamState();
 }
 
 
+void mimi_connect_timings(MIMI_IO* mio, MIMIIO_CONNECT_TIMINGS* timings)
+{
+	*timings = mio->mt_->connectTimings();
+}
+
+int mimi_connect_timings_percentile(double percentile, MIMIIO_CONNECT_TIMINGS* timings, int* ssl_resumed)
+{
+	int resumed = 0;
+	int n = mimiio::mimiioConnectStats::instance().percentile(percentile, *timings, resumed);
+	if(ssl_resumed != nullptr){
+		*ssl_resumed = resumed;
+	}
+	return n;
+}
+
+void mimi_rx_dispatch_stats(MIMI_IO* mio, MIMIIO_RX_DISPATCH_STATS* stats)
+{
+	mio->mt_->rxDispatchStats(*stats);
+}
+
+void mimi_tx_pipeline_stats(MIMI_IO* mio, MIMIIO_TX_PIPELINE_STATS* stats)
+{
+	mio->mt_->txPipelineStats(*stats);
+}
+
+int mimi_tls_offload(MIMI_IO* mio)
+{
+	return mio->mt_->tlsOffload();
+}
+
 void mimi_close(MIMI_IO* mio)
 {
 	if(mio != nullptr){
+		// The close handshake and joining workers, which may be blocked in receiving, are done by the reaper.
+		mio->mt_->abandon();
+		mimiio::mimiioRuntime::instance().reaper(Poco::Logger::get(PACKAGE_NAME)).reap(std::move(mio->mt_));
 		delete mio;
 	}
 }
@@ -232,6 +568,17 @@ const char* mimi_version()
 	return PACKAGE_VERSION;
 }
 
+void mimi_ssl_handshake_count(unsigned long* resumed, unsigned long* full)
+{
+	mimiio::mimiioSSLContext& sslContext = mimiio::mimiioSSLContext::instance();
+	if(resumed != nullptr){
+		*resumed = sslContext.resumedHandshakes();
+	}
+	if(full != nullptr){
+		*full = sslContext.fullHandshakes();
+	}
+}
+
 
 /*
 int mimi_send(MIMI_IO* mio, char* buffer, size_t len)
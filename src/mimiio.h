@@ -23,6 +23,16 @@ extern "C"{
    */
   typedef struct mimi_io_s MIMI_IO;
 
+  /**
+   * @brief mimi connection pool handler
+   */
+  typedef struct mimi_pool_s MIMI_POOL;
+
+  /**
+   * @brief asynchronous mimi_open() request handler
+   */
+  typedef struct mimi_open_request_s MIMI_OPEN_REQUEST;
+
   /**
    * @brief HTTP request header
    */
@@ -31,6 +41,86 @@ extern "C"{
 	  char value[1024];
   } MIMIIO_HTTP_REQUEST_HEADER;
 
+  /**
+   * @brief Elapsed time of each phase of opening a connection, measured with monotonic clock in microseconds.
+   */
+  typedef struct{
+	  long dns_usec;           //!< Host name resolution
+	  long connect_usec;       //!< TCP connection
+	  long ssl_usec;           //!< SSL handshake, 0 for connection without authentication
+	  long upgrade_usec;       //!< WebSocket upgrade request and response
+	  long total_usec;         //!< Total time of opening the connection
+	  int ssl_session_resumed; //!< 1 if SSL session has been resumed, otherwise 0
+	  int pooled;              //!< 1 if the connection was taken from a connection pool, the timings are of the time when the pool opened it.
+  } MIMIIO_CONNECT_TIMINGS;
+
+  /**
+   * @brief Behavior of mimi_set_rx_dispatch() when the queue of received results is full
+   */
+  typedef enum{
+	  MIMIIO_RX_OVERFLOW_BLOCK       = 0, //!< The receiving thread waits until rxfunc takes a result, so reading the socket is stalled. Not supported by event loop backends (917).
+	  MIMIIO_RX_OVERFLOW_DROP_OLDEST = 1, //!< The oldest queued result is dropped.
+	  MIMIIO_RX_OVERFLOW_DROP_NEWEST = 2, //!< The received result is dropped.
+	  MIMIIO_RX_OVERFLOW_DISCONNECT  = 3  //!< The connection is terminated with error 914.
+  } MIMIIO_RX_OVERFLOW_POLICY;
+
+  /**
+   * @brief Statistics of the queue of received results, see mimi_rx_dispatch_stats().
+   */
+  typedef struct{
+	  size_t depth;            //!< The number of results waiting for rxfunc
+	  size_t peak_depth;       //!< The maximum of \e depth since the connection started
+	  unsigned long delivered; //!< The number of results passed to rxfunc
+	  unsigned long dropped;   //!< The number of results dropped because the queue was full
+  } MIMIIO_RX_DISPATCH_STATS;
+
+  /**
+   * @brief Statistics of the queues of audio blocks, see mimi_tx_pipeline_stats().
+   */
+  typedef struct{
+	  size_t encode_depth;        //!< The number of blocks waiting for encoding
+	  size_t send_depth;          //!< The number of encoded blocks waiting for sending
+	  size_t peak_encode_depth;   //!< The maximum of \e encode_depth since the connection started
+	  size_t peak_send_depth;     //!< The maximum of \e send_depth since the connection started
+	  unsigned long encoded;      //!< The number of blocks encoded
+	  unsigned long sent;         //!< The number of blocks sent
+	  unsigned long tx_stalls;    //!< The number of times txfunc was not called because the queue for encoding was full
+	  unsigned long encode_stalls; //!< The number of times encoding was stopped because the queue for sending was full
+  } MIMIIO_TX_PIPELINE_STATS;
+
+  /**
+   * @brief I/O backend driving callback API connections
+   */
+  typedef enum{
+	  MIMIIO_IO_BACKEND_THREAD = 0, //!< Each connection has its own threads for sending, receiving and monitoring (default).
+	  MIMIIO_IO_BACKEND_EPOLL  = 1  //!< Connections share a fixed set of event loop threads using epoll(7) with non-blocking sockets, Linux only.
+  } MIMIIO_IO_BACKEND;
+
+  /**
+   * @brief Current version of ::MIMIIO_INIT_OPTIONS
+   */
+#define MIMIIO_INIT_OPTIONS_VERSION 4
+
+  /**
+   * @brief Flags returned by mimi_tls_offload()
+   */
+#define MIMIIO_TLS_OFFLOAD_TX 1 //!< Records sent are encrypted by the kernel.
+#define MIMIIO_TLS_OFFLOAD_RX 2 //!< Records received are decrypted by the kernel.
+
+  /**
+   * @brief Process-wide options given to mimi_init()
+   *
+   * Initialize with mimi_init_options_default() before setting fields, so that fields added in later versions have default values.
+   */
+  typedef struct{
+	  int version;                  //!< Must be ::MIMIIO_INIT_OPTIONS_VERSION, set by mimi_init_options_default().
+	  MIMIIO_IO_BACKEND io_backend; //!< I/O backend for callback API connections
+	  int io_threads;               //!< The number of event loop threads for ::MIMIIO_IO_BACKEND_EPOLL, 0 means the number of CPU cores.
+	  bool tls_offload;             //!< (version 2) Hand TLS record encryption to Linux kernel TLS after the handshake if available, default false.
+	  int worker_threads;           //!< (version 3) Threads kept in the process-wide pool running ::MIMIIO_IO_BACKEND_THREAD connections and mimi_open_async(), 0 means MIMIIO_WORKER_THREADS environment variable or 16. The pool grows as needed up to 4096.
+	  int encoder_threads;          //!< (version 4) Threads of the process-wide pool encoding audio of connections enabled by mimi_set_tx_pipeline(), 0 means the number of CPU cores, up to 256.
+  } MIMIIO_INIT_OPTIONS;
+
   /**
    * @brief Stream Status
    */
@@ -56,7 +146,8 @@ extern "C"{
 	  MIMIIO_FLAC_6,  //!< Flac compression level is 6
 	  MIMIIO_FLAC_7,  //!< Flac compression level is 7
 	  MIMIIO_FLAC_8,  //!< Flac compression level is 8 (slowest, most compression)
-	  MIMIIO_FLAC_PASS_THROUGH //!< Input is externally encoded in flac. libmimiio do nothing with input.
+	  MIMIIO_FLAC_PASS_THROUGH, //!< Input is externally encoded in flac. libmimiio do nothing with input.
+	  MIMIIO_FLAC_ADAPTIVE //!< Flac compression level starts at 5 and is moved between blocks by CPU time of encoding and time of sending.
   } MIMIIO_AUDIO_FORMAT;
 
   /**
@@ -70,16 +161,77 @@ extern "C"{
 	  MIMIIO_LOG_TRACE   = 9  //!< debug information.
   };
 
+  /**
+   * @brief Current version of ::MIMIIO_OPEN_OPTIONS
+   */
+#define MIMIIO_OPEN_OPTIONS_VERSION 3
+
+  /**
+   * @brief Per-connection options given to mimi_open_ex()
+   *
+   * Initialize with mimi_open_options_default() before setting fields, so that fields added in later versions have default values.
+   * Thread settings apply to the sending and receiving threads of ::MIMIIO_IO_BACKEND_THREAD, and are ignored for event loops
+   * and cooperative connections.
+   */
+  typedef struct{
+	  int version;                             //!< Must be ::MIMIIO_OPEN_OPTIONS_VERSION, set by mimi_open_options_default().
+	  const char* host;                        //!< mimi(R) remote hostname
+	  int port;                                //!< mimi(R) remote host port
+	  void (*on_tx_callback)(char* buffer, size_t* len, bool* recog_break, int* txfunc_error, void* userdata_for_tx); //!< see mimi_open()
+	  void (*on_rx_callback)(const char* result, size_t len, int* rxfunc_error, void* userdata_for_rx);                //!< see mimi_open()
+	  void* userdata_for_tx;                   //!< user defined data for on_tx_callback
+	  void* userdata_for_rx;                   //!< user defined data for on_rx_callback
+	  MIMIIO_AUDIO_FORMAT format;              //!< Audio format, default ::MIMIIO_RAW_PCM
+	  int samplingrate;                        //!< Audio samplingrate, default 16000
+	  int channels;                            //!< Audio channels, default 1
+	  const MIMIIO_HTTP_REQUEST_HEADER* request_headers; //!< user defined request headers sent with WebSocket upgrade request
+	  int request_headers_len;                 //!< The number of request_headers
+	  const char* access_token;                //!< NULL for connection without authentication
+	  int loglevel;                            //!< log level, default ::MIMIIO_LOG_INFO
+	  size_t send_buffer_size;                 //!< Size of the buffer given to on_tx_callback in bytes, default 262144.
+	  size_t push_buffer_size;                 //!< Size of the ring buffer for push API in bytes, default 524288.
+	  int connect_timeout_ms;                  //!< Timeout for connecting, SSL handshake and WebSocket upgrade, default 30000.
+	  int send_timeout_ms;                     //!< Timeout for sending a frame, default 30000.
+	  int recv_timeout_ms;                     //!< Timeout for receiving a frame, default 30000.
+	  int tx_idle_sleep_ms;                    //!< Maximum pause before calling on_tx_callback again when it returned no audio, default 100.
+	  int thread_stack_size;                   //!< Stack size of dedicated sending and receiving threads in bytes, 0 runs them on the shared worker pool (default).
+	  int thread_priority;                     //!< Priority of sending and receiving threads from -2 (lowest) to 2 (highest), default 0. Other than 0 runs them on dedicated threads, on Linux with nice values +10 to -10 relative to the process; raising needs CAP_SYS_NICE or RLIMIT_NICE.
+	  int tx_cpu;                              //!< CPU which the sending thread is pinned to, -1 for no affinity (default), Linux only.
+	  int rx_cpu;                              //!< CPU which the receiving thread is pinned to, -1 for no affinity (default), Linux only.
+	  bool cooperative;                        //!< (version 2) Drive the callback API connection by mimi_step() on the caller's thread without internal threads, default false.
+	  int flac_latency_ms;                     //!< (version 3) Upper limit of audio in milliseconds held by the built-in flac encoder before a frame is written, which caps the block size of the compression level. 0 uses the block size of the compression level (default), e.g. 4096 samples at level 5.
+  } MIMIIO_OPEN_OPTIONS;
+
+  /**
+   * @brief Set process-wide options to their default values
+   *
+   * @param [out] options options
+   */
+  void mimi_init_options_default(MIMIIO_INIT_OPTIONS* options);
+
+  /**
+   * @brief Set process-wide options
+   *
+   * This function is optional, and must be called before the first connection is opened.
+   * If it is not called, default values set by mimi_init_options_default() are used.
+   *
+   * @param [in] options options
+   * @return 0 if succeeded, 909 if a connection has been already opened, 910 if options are invalid or not supported on this platform.
+   */
+  int mimi_init(const MIMIIO_INIT_OPTIONS* options);
+
   /**
    * @brief Initialize and open mimi(R) connection
    *
    * If \e access_token is NULL, libmimiio try opening connection without authentication.
    *
    * Both \e on_tx_func and \e on_rx_func can be set NULL for libmimiio blocking API. One can not use blocking API and callback API simultaneously.
+   * If only \e on_tx_func is NULL, audio is pushed by mimi_write_audio() or mimi_tx_acquire() and mimi_tx_commit(),
+   * and ended by mimi_end_audio(), instead of \e on_tx_func (push API).
    *
    * @param [in] mimi_host mimi(R) remote hostname
    * @param [in] mimi_port mimi(R) remote host port
-   * @param [in] on_tx_callback user defined callback function for sending audio, which is called periodically by libmimiio. NULL can be set for blocking API.
+   * @param [in] on_tx_callback user defined callback function for sending audio, which is called periodically by libmimiio. NULL can be set for blocking API or push API.
    * @param [in] on_rx_callback user defined callback function for receiving results from remote host, which is called periodically by libmimiio. NULL can be set for blocking API.
    * @param [in] userdata_for_tx user defined data for on_tx_callback
    * @param [in] userdata_for_rx user defined data for on_rx_callback
@@ -109,6 +261,261 @@ extern "C"{
 		  int loglevel,
 		  int* errorno);
 
+  /**
+   * @brief Set per-connection options to their default values
+   *
+   * @param [out] options options
+   */
+  void mimi_open_options_default(MIMIIO_OPEN_OPTIONS* options);
+
+  /**
+   * @brief Initialize and open mimi(R) connection with options
+   *
+   * Same as mimi_open(), with buffer sizes, timeouts and thread settings which mimi_open() uses default values for.
+   *
+   * @param [in] options options, which need not be kept after this function returns.
+   * @param [out] errorno errorno is set when something goes wrong and return NULL, otherwise 0 returns. 915 if \e options are invalid.
+   * @return mimi connection handler, or return NULL if something is wrong with opening new connection.
+   */
+  MIMI_IO* mimi_open_ex(const MIMIIO_OPEN_OPTIONS* options, int* errorno);
+
+  /**
+   * @brief Initialize and open mimi(R) connection asynchronously
+   *
+   * This function returns immediately, and the connection is opened in a background thread with the same parameters
+   * as mimi_open(). All parameters are copied, so they need not be kept by the caller.
+   *
+   * When \e on_open_callback is set, it is called from the background thread when the connection has been opened or failed,
+   * with the mimi connection handler (NULL if failed) and the error code. The ownership of the handler is moved to the callback,
+   * which should close it by mimi_close() finally. When \e on_open_callback is NULL, the result is obtained by mimi_open_async_poll().
+   *
+   * The request handler MUST be released by mimi_open_async_release() in either case.
+   *
+   * @param [in] on_open_callback user defined callback function called on completion. NULL can be set for polling.
+   * @param [in] userdata_for_open user defined data for on_open_callback
+   * @param [out] errorno errorno is set when the request could not be started and return NULL, otherwise 0 returns.
+   * @return request handler, or return NULL if the request could not be started.
+   * @see mimi_open() for the other parameters.
+   */
+  MIMI_OPEN_REQUEST* mimi_open_async(
+		  const char* mimi_host,
+		  int mimi_port,
+		  void (*on_tx_callback)(char* buffer, size_t* len, bool* recog_break, int* txfunc_error, void* userdata_for_tx),
+		  void (*on_rx_callback)(const char* result, size_t len, int* rxfunc_error, void* userdata_for_rx),
+		  void* userdata_for_tx,
+		  void* userdata_for_rx,
+		  MIMIIO_AUDIO_FORMAT format,
+		  int samplingrate,
+		  int channels,
+		  const MIMIIO_HTTP_REQUEST_HEADER* extra_request_headers,
+		  int extra_request_headers_len,
+		  const char* access_token,
+		  int loglevel,
+		  void (*on_open_callback)(MIMI_IO* mio, int errorno, void* userdata_for_open),
+		  void* userdata_for_open,
+		  int* errorno);
+
+  /**
+   * @brief Initialize and open mimi(R) connection asynchronously with options
+   *
+   * Same as mimi_open_async(), with the options of mimi_open_ex(). \e options and the strings and request headers
+   * which it points to are copied, so they need not be kept by the caller.
+   *
+   * @param [in] options options
+   * @param [in] on_open_callback user defined callback function called on completion. NULL can be set for polling.
+   * @param [in] userdata_for_open user defined data for on_open_callback
+   * @param [out] errorno errorno is set when the request could not be started and return NULL, otherwise 0 returns. 915 if \e options are invalid.
+   * @return request handler, or return NULL if the request could not be started.
+   */
+  MIMI_OPEN_REQUEST* mimi_open_async_ex(
+		  const MIMIIO_OPEN_OPTIONS* options,
+		  void (*on_open_callback)(MIMI_IO* mio, int errorno, void* userdata_for_open),
+		  void* userdata_for_open,
+		  int* errorno);
+
+  /**
+   * @brief Poll the result of asynchronous mimi_open() request
+   *
+   * This function never blocks. When the request has completed successfully and no completion callback is set,
+   * the mimi connection handler is set to \e mio once, and its ownership is moved to the caller.
+   *
+   * @param [in] request request handler
+   * @param [out] mio mimi connection handler, or NULL if the request is not completed, failed, or already taken. NULL can be set.
+   * @param [out] errorno error code of mimi_open(), which is set only when the request has completed. NULL can be set.
+   * @return Returns true when the request has completed.
+   */
+  bool mimi_open_async_poll(MIMI_OPEN_REQUEST* request, MIMI_IO** mio, int* errorno);
+
+  /**
+   * @brief Cancel asynchronous mimi_open() request
+   *
+   * This function never blocks on network. After this function returns, the completion callback is never called,
+   * and a connection which is established later or has not been taken is closed by libmimiio.
+   *
+   * @param [in] request request handler
+   */
+  void mimi_open_async_cancel(MIMI_OPEN_REQUEST* request);
+
+  /**
+   * @brief Release asynchronous mimi_open() request handler
+   *
+   * A request still in progress is cancelled as mimi_open_async_cancel().
+   *
+   * @param [in] request request handler
+   */
+  void mimi_open_async_release(MIMI_OPEN_REQUEST* request);
+
+  /**
+   * @brief Open a pool of pre-established mimi(R) connections
+   *
+   * The pool keeps \e size connections which are already authenticated and upgraded to WebSocket, refills them in background,
+   * and closes idle connections when they become older than \e ttl_sec, before remote host closes them by its idle timeout.
+   * While the pool is open, mimi_open() with the same host, port, audio format, request headers and access token
+   * takes a ready connection from the pool instead of connecting, and falls back to connecting when no connection is ready.
+   *
+   * This function does not wait for connections to be established. Use mimi_pool_available() and mimi_pool_error()
+   * to check the state of the pool.
+   *
+   * @param [in] mimi_host mimi(R) remote hostname
+   * @param [in] mimi_port mimi(R) remote host port
+   * @param [in] format Audio format defined in enum ::MIMIIO_AUDIO_FORMAT, which must match the one given to mimi_open().
+   * @param [in] samplingrate Audio samplingrate, which must match the one given to mimi_open().
+   * @param [in] channels Audio channels, which must match the one given to mimi_open().
+   * @param [in] extra_request_headers user defined request headers which is send with WebSocket upgrade request.
+   * @param [in] extra_request_headers_len The number of request_headers.
+   * @param [in] access_token if NULL is set, connections are opened without authentication.
+   * @param [in] size the number of connections to be kept, at least 1.
+   * @param [in] ttl_sec time to live of an idle connection in seconds, which should be shorter than remote host's idle timeout.
+   * @param [in] loglevel log level
+   * @param [out] errorno errorno is set when something goes wrong and return NULL, otherwise 0 returns.
+   * @return mimi connection pool handler, or return NULL if something is wrong.
+   */
+  MIMI_POOL* mimi_pool_open(
+		  const char* mimi_host,
+		  int mimi_port,
+		  MIMIIO_AUDIO_FORMAT format,
+		  int samplingrate,
+		  int channels,
+		  const MIMIIO_HTTP_REQUEST_HEADER* extra_request_headers,
+		  int extra_request_headers_len,
+		  const char* access_token,
+		  int size,
+		  int ttl_sec,
+		  int loglevel,
+		  int* errorno);
+
+  /**
+   * @brief Get the number of connections which are ready in the pool.
+   *
+   * @param [in] pool mimi connection pool handler
+   * @return the number of ready connections
+   */
+  int mimi_pool_available(MIMI_POOL* pool);
+
+  /**
+   * @brief Get error code of the last failed connection attempt in the pool.
+   *
+   * @param [in] pool mimi connection pool handler
+   * @return 0 if the last connection attempt succeeded, otherwise error code.
+   */
+  int mimi_pool_error(MIMI_POOL* pool);
+
+  /**
+   * @brief Close the pool and all connections which are not taken by mimi_open().
+   *
+   * Connections already taken by mimi_open() are not affected. This function may wait for the connection being established.
+   *
+   * @param [in] pool mimi connection pool handler
+   */
+  void mimi_pool_close(MIMI_POOL* pool);
+
+  /**
+   * @brief Merge small encoded audio chunks into larger WebSocket frames.
+   *
+   * By default each output of the audio encoder is sent as its own frame, even when it is only a few hundred bytes.
+   * When coalescing is enabled, encoded audio is kept until it reaches \e max_bytes or the oldest data has waited
+   * for \e max_delay_ms, and then sent as one frame. Pending audio is always sent before recog-break.
+   * This function must be called before mimi_start().
+   *
+   * @param [in] mio mimi connection handler
+   * @param [in] max_bytes size of merged frame in bytes, 0 disables coalescing.
+   * @param [in] max_delay_ms maximum delay of pending audio in milliseconds
+   * @return 0 if succeeded, 917 if coalescing is not supported by the connection, otherwise error code.
+   */
+  int mimi_set_tx_coalescing(MIMI_IO* mio, size_t max_bytes, int max_delay_ms);
+
+  /**
+   * @brief Use built-in WebSocket framing instead of the one of POCO library.
+   *
+   * The opening handshake is performed by POCO library in either case. The built-in framer composes each frame in a reusable
+   * buffer and writes it with a single call, masks the payload with SIMD instructions selected at runtime (SSE2/AVX2/NEON),
+   * and answers ping frames by itself. This function must be called before mimi_start().
+   * Connections of event loop backends and cooperative connections always use built-in framing, which resumes frames on their non-blocking sockets.
+   *
+   * @param [in] mio mimi connection handler
+   * @param [in] enable true to use built-in framing, false to use the one of POCO library (default).
+   * @return 0 if succeeded, 917 if built-in framing can not be disabled for the connection, otherwise error code.
+   */
+  int mimi_set_native_framing(MIMI_IO* mio, bool enable);
+
+  /**
+   * @brief Call rxfunc on a thread of the process-wide worker pool through a bounded queue, instead of the thread reading the socket.
+   *
+   * By default rxfunc is called by the thread receiving results, so a slow rxfunc delays reading the socket,
+   * which may cause receive timeout or unanswered pings. When the dispatch queue is enabled, received results are
+   * copied into the queue and rxfunc is called in order on another thread. Queued results are delivered before
+   * the connection becomes inactive. This function must be called before mimi_start(). Connections driven by mimi_step()
+   * do not support the queue, since rxfunc is called by the application's thread.
+   *
+   * @param [in] mio mimi connection handler
+   * @param [in] queue_length the maximum number of queued results, 0 disables the queue (default).
+   * @param [in] policy behavior when the queue is full
+   * @return 0 if succeeded, 917 if the queue is not supported by the connection, otherwise error code.
+   */
+  int mimi_set_rx_dispatch(MIMI_IO* mio, size_t queue_length, MIMIIO_RX_OVERFLOW_POLICY policy);
+
+  /**
+   * @brief Encode audio on the process-wide encoder pool and send it on another thread, pipelined with txfunc.
+   *
+   * By default each block of audio returned by txfunc is encoded and sent before txfunc is called again, so that
+   * encoding at a high compression level or a slow socket delays reading audio. When the pipeline is enabled,
+   * blocks are queued for the encoder pool, whose threads are shared by all connections, and encoded blocks are
+   * queued for the sending thread. txfunc is not called while the queue for encoding is full. Blocks are sent in order,
+   * followed by recog-break. Coalescing by mimi_set_tx_coalescing() is not applied to the pipeline.
+   * This function must be called before mimi_start(). Connections of event loop backends or mimi_step() do not support the pipeline.
+   *
+   * @param [in] mio mimi connection handler
+   * @param [in] queue_length the maximum number of blocks in each queue, 0 disables the pipeline (default).
+   * @return 0 if succeeded, 917 if the pipeline is not supported by the connection, otherwise error code.
+   */
+  int mimi_set_tx_pipeline(MIMI_IO* mio, size_t queue_length);
+
+  /**
+   * @brief Set the callback function called when the stream state changes
+   *
+   * \e on_state_change is called with the new state returned by mimi_stream_state(), on the thread which has changed it,
+   * e.g. a libmimiio thread when sending or receiving has finished. Calls for one connection never overlap.
+   * The callback must not call mimi_close() for the connection. This function must be called before mimi_start().
+   *
+   * @param [in] mio mimi connection handler
+   * @param [in] on_state_change user defined callback function, NULL to disable.
+   * @param [in,out] userdata user defined data for on_state_change
+   * @return 0 if succeeded, otherwise error code.
+   */
+  int mimi_set_state_callback(MIMI_IO* mio, void (*on_state_change)(MIMI_IO* mio, MIMIIO_STREAM_STATE state, void* userdata), void* userdata);
+
+  /**
+   * @brief Get a file descriptor which becomes readable on events of the connection, for epoll(7) or other event loops.
+   *
+   * The descriptor is an eventfd, which becomes readable when the stream state changes, and each time on_rx_callback has been called.
+   * The application should read 8 bytes from it to reset, then check mimi_stream_state() or results which on_rx_callback has stored.
+   * The descriptor is owned by the connection and closed by mimi_close(), so it must be removed from event loops before that.
+   *
+   * @param [in] mio mimi connection handler
+   * @return file descriptor, or -1 if eventfd is not supported on this platform or could not be created.
+   */
+  int mimi_get_fd(MIMI_IO* mio);
+
   /**
    * @brief Start loop of sending sound and receiving result.
    *
@@ -117,6 +524,58 @@ extern "C"{
    */
   int mimi_start(MIMI_IO* mio);
 
+  /**
+   * @brief Push audio data to be sent, for push API.
+   *
+   * Audio is copied into a lock-free ring buffer inside libmimiio and this function never waits for sending.
+   * The sending thread is woken up immediately, so audio is encoded and sent without waiting for the next poll.
+   * Waking it up takes a short internal lock, only for the first write since the sending thread has last taken audio.
+   * This function must be called by one thread at a time. It can be called before mimi_start().
+   *
+   * @param [in] mio mimi connection handler opened with NULL \e on_tx_func
+   * @param [in] data audio data in the format given to mimi_open()
+   * @param [in] len length of data in bytes, multiple of the frame size (2 * channels) for PCM.
+   * @return 0 if succeeded, 911 if the buffer does not have enough space and nothing is written,
+   * 912 if the connection is not for push API or mimi_end_audio() has been called, 913 if \e len is not a multiple of the frame size.
+   */
+  int mimi_write_audio(MIMI_IO* mio, const char* data, size_t len);
+
+  /**
+   * @brief Get a region of the send buffer to write audio directly, for push API.
+   *
+   * Audio written to the region is passed to the encoder in place, without being copied by libmimiio.
+   * The region is contiguous and may be smaller than the free space at the end of the ring buffer,
+   * in which case the next call returns the region at its beginning after mimi_tx_commit().
+   * This function and mimi_tx_commit() must be called by one thread at a time, and never block.
+   *
+   * @param [in] mio mimi connection handler opened with NULL \e on_tx_func
+   * @param [out] ptr start of the region
+   * @param [out] capacity length of the region in bytes, multiple of the frame size (2 * channels) for PCM.
+   * @return 0 if succeeded, 911 if the buffer is full, 912 if the connection is not for push API or audio has been ended.
+   */
+  int mimi_tx_acquire(MIMI_IO* mio, char** ptr, size_t* capacity);
+
+  /**
+   * @brief Send audio written to the region returned by mimi_tx_acquire(), for push API.
+   *
+   * @param [in] mio mimi connection handler opened with NULL \e on_tx_func
+   * @param [in] len length of audio written in bytes, multiple of the frame size for PCM, 0 is allowed.
+   * @param [in] recog_break true if this is the last audio, same as calling mimi_end_audio() after this function.
+   * @return 0 if succeeded, 912 if the connection is not for push API or audio has been ended,
+   * 913 if \e len exceeds the acquired region or is not a multiple of the frame size.
+   */
+  int mimi_tx_commit(MIMI_IO* mio, size_t len, bool recog_break);
+
+  /**
+   * @brief Mark the end of pushed audio, for push API.
+   *
+   * recog-break is sent after all audio written by mimi_write_audio() has been sent.
+   *
+   * @param [in] mio mimi connection handler opened with NULL \e on_tx_func
+   * @return 0 if succeeded, 912 if the connection is not for push API or this function has been already called.
+   */
+  int mimi_end_audio(MIMI_IO* mio);
+
   /**
    * @brief Determine whether the mimi connection is active.
    *
@@ -128,6 +587,69 @@ extern "C"{
    */
   bool mimi_is_active(MIMI_IO* mio);
 
+  /**
+   * @brief Wait until the mimi connection becomes inactive.
+   *
+   * Blocks the caller without polling until both sending and receiving streams have finished, i.e. mimi_is_active() returns false,
+   * and the error code, if any, is available by mimi_error(). The caller is woken up as soon as the streams finish.
+   * This function returns immediately for blocking API, or if mimi_start() has not been called.
+   * mimi_close() must not be called by other threads while waiting.
+   *
+   * @param [in] mio mimi connection handler
+   * @param [in] timeout_ms timeout in milliseconds, negative value to wait infinitely.
+   * @return true if the connection is not active, false if timed out.
+   */
+  bool mimi_wait(MIMI_IO* mio, int timeout_ms);
+
+  /**
+   * @brief Run one step of a cooperative connection
+   *
+   * A connection opened by mimi_open_ex() with \e cooperative has no internal threads, and is driven only by this function
+   * after mimi_start(). One call sends audio once if on_tx_callback or pushed audio is due, calling on_tx_callback at most once,
+   * then waits for the socket up to \e timeout_ms, or until the next sending is due, and receives the frames which have arrived,
+   * calling on_rx_callback for each result. Both callbacks are called on the caller's thread. Call this function repeatedly from
+   * the application's loop until mimi_is_active() returns false, then check mimi_error(). mimi_wait() does not wait for cooperative connections.
+   *
+   * The socket is non-blocking and frames are handled by the built-in framer (see mimi_set_native_framing()), so this function
+   * does not wait for the socket longer than \e timeout_ms: a frame split by the network is resumed by a later call, and a frame
+   * which the socket does not accept is written by later calls, during which on_tx_callback is not called.
+   * With \e timeout_ms 0, the time of a call is bounded by the callbacks, encoding and copying into the socket, not by the network.
+   *
+   * @param [in] mio mimi connection handler
+   * @param [in] timeout_ms maximum time waiting for the socket in milliseconds, 0 not to wait, negative value to wait until the next sending is due.
+   * @return 0 if succeeded, 916 if the connection is not cooperative.
+   */
+  int mimi_step(MIMI_IO* mio, int timeout_ms);
+
+  /**
+   * @brief Get what mimi_step() of a cooperative connection waits for, to wait in the application's event loop instead
+   *
+   * Register \e fd to poll(2), epoll(7) or other event loops for readability, and call mimi_step() with \e timeout_ms 0 when it
+   * becomes readable or \e timeout_ms has passed. Call this function again after each mimi_step(), since both values change.
+   * Both are -1 before mimi_start() and after the connection has become inactive.
+   *
+   * @param [in] mio mimi connection handler
+   * @param [out] fd socket to wait for readability, -1 if nothing is received or sent any more.
+   * @param [out] timeout_ms milliseconds until the next sending is due, 0 if mimi_step() should be called at once, -1 for infinite.
+   * @return 0 if succeeded, 916 if the connection is not cooperative.
+   */
+  int mimi_step_poll(MIMI_IO* mio, int* fd, int* timeout_ms);
+
+  /**
+   * @brief Same as mimi_step_poll(), and whether mimi_step() also waits for the socket to become writable
+   *
+   * While frames which the socket has not accepted are queued, mimi_step() waits for \e fd to become readable or writable,
+   * and sends no more audio until they have been written. Register \e fd for writability too while \e writable is true.
+   * mimi_step_poll() returns a \e timeout_ms of at most 1000 milliseconds instead in that case.
+   *
+   * @param [in] mio mimi connection handler
+   * @param [out] fd socket to wait for, -1 if nothing is received or sent any more.
+   * @param [out] writable true if \e fd should also be waited for writability.
+   * @param [out] timeout_ms milliseconds until mimi_step() should be called without waiting for \e fd, 0 if at once, -1 for infinite.
+   * @return 0 if succeeded, 916 if the connection is not cooperative.
+   */
+  int mimi_step_poll_ex(MIMI_IO* mio, int* fd, bool* writable, int* timeout_ms);
+
   /**
    * @brief Get state of the internal stream
    *
@@ -139,11 +661,69 @@ extern "C"{
    */
   MIMIIO_STREAM_STATE mimi_stream_state(MIMI_IO* mio);
 
+  /**
+   * @brief Get elapsed time of each phase of opening the connection
+   *
+   * @param [in] mio mimi connection handler
+   * @param [out] timings connection timings
+   */
+  void mimi_connect_timings(MIMI_IO* mio, MIMIIO_CONNECT_TIMINGS* timings);
+
+  /**
+   * @brief Get percentile of each phase of opening connections in this process
+   *
+   * The latest 1024 connections opened in this process, including those opened by connection pools, are used.
+   * Each phase is computed independently, so phases do not necessarily add up to \e total_usec.
+   * \e ssl_session_resumed and \e pooled of \e timings are always 0, since they are not timings.
+   *
+   * @param [in] percentile percentile in [0, 100], e.g. 50 for median, 99 for tail latency.
+   * @param [out] timings percentile of each phase
+   * @param [out] ssl_resumed the number of the connections which resumed SSL session, may be NULL.
+   * @return the number of connections used for computation.
+   */
+  int mimi_connect_timings_percentile(double percentile, MIMIIO_CONNECT_TIMINGS* timings, int* ssl_resumed);
+
+  /**
+   * @brief Get statistics of the queue of received results
+   *
+   * All fields are 0 if the queue is not enabled by mimi_set_rx_dispatch().
+   *
+   * @param [in] mio mimi connection handler
+   * @param [out] stats statistics
+   */
+  void mimi_rx_dispatch_stats(MIMI_IO* mio, MIMIIO_RX_DISPATCH_STATS* stats);
+
+  /**
+   * @brief Get statistics of the queues of audio blocks
+   *
+   * All fields are 0 if the pipeline is not enabled by mimi_set_tx_pipeline().
+   *
+   * @param [in] mio mimi connection handler
+   * @param [out] stats statistics
+   */
+  void mimi_tx_pipeline_stats(MIMI_IO* mio, MIMIIO_TX_PIPELINE_STATS* stats);
+
+  /**
+   * @brief Get whether TLS records of the connection are processed by Linux kernel TLS
+   *
+   * Kernel TLS is used only if \e tls_offload of ::MIMIIO_INIT_OPTIONS is set, and libmimiio is linked with OpenSSL 3.0 or later,
+   * and the kernel supports the negotiated cipher suite. Otherwise records are processed by OpenSSL as usual.
+   *
+   * @param [in] mio mimi connection handler
+   * @return bitwise OR of ::MIMIIO_TLS_OFFLOAD_TX and ::MIMIIO_TLS_OFFLOAD_RX, 0 if not offloaded or without authentication.
+   */
+  int mimi_tls_offload(MIMI_IO* mio);
+
   /**
    * @brief Close mimi(R) connection. Release all resources related to libmimiio.
    *
    * Close and release a mimi connection regardless whether the connection is active or not.
    *
+   * This function returns without waiting for network I/O. It waits only for on_tx_callback or on_rx_callback running now, if any,
+   * and neither of them is called after this function returns, so that user data can be released immediately.
+   * The WebSocket close handshake is performed in the background, and the socket is shut down if the remote host
+   * does not respond within 1 second. This function must not be called in the callbacks of the connection itself.
+   *
    * @param [in] mio mimi connection handler
    */
   void mimi_close(MIMI_IO* mio);
@@ -171,6 +751,18 @@ extern "C"{
    */
   const char* mimi_version();
 
+  /**
+   * @brief Get the number of SSL handshakes performed in this process.
+   *
+   * All authenticated connections share one SSL client context, and the SSL session established with
+   * a remote host is resumed by the next connection to the same host and port. This function reports
+   * how many handshakes have resumed a session and how many were full handshakes.
+   *
+   * @param [out] resumed the number of resumed handshakes. NULL can be set.
+   * @param [out] full the number of full handshakes. NULL can be set.
+   */
+  void mimi_ssl_handshake_count(unsigned long* resumed, unsigned long* full);
+
   /**
    * @brief Send audio data to mimi(R) remote host.
    * @note Hidden API without support.
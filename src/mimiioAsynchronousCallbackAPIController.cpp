@@ -6,6 +6,7 @@
  */
 
 #include "mimiioAsynchronousCallbackAPIController.hpp"
+#include "mimiioRuntime.hpp"
 
 namespace mimiio{
 
@@ -18,19 +19,28 @@ mimiioAsynchronousCallbackAPIController::mimiioAsynchronousCallbackAPIController
 		void* userdata_for_rx,
 		Poco::Logger& logger) :
 		mimiioController(impl, encoder, logger),
-		rxWorker_(new worker::mimiioRxWorker(impl_, rxfunc, userdata_for_rx, logger)),
-		txWorker_(new worker::mimiioTxWorker(impl_, encoder_, txfunc, userdata_for_tx, logger)),
-		monitor_(new mimiioAsynchronousCallbackAPIMonitor(rxWorker_, txWorker_, &errorno_, logger))
+		rxWorker_(new worker::mimiioRxWorker(impl_, rxfunc, userdata_for_rx, notifier_, logger)),
+		txWorker_(new worker::mimiioTxWorker(impl_, encoder_, txfunc, userdata_for_tx, notifier_, logger)),
+		rxfunc_(rxfunc),
+		userdata_for_rx_(userdata_for_rx),
+		monitor_(new mimiioAsynchronousCallbackAPIMonitor(rxWorker_, txWorker_, &errorno_, notifier_, logger))
 {
 	poco_debug(logger_, "AsynchronousCallbackAPIController: initialized.");
 }
 
 mimiioAsynchronousCallbackAPIController::~mimiioAsynchronousCallbackAPIController()
 {
+	if(dispatcher_){
+		dispatcher_->abort(); // queued results are dropped, and rxWorker waiting for space is released.
+	}
+	if(pipeline_){
+		pipeline_->finish(); // the sending thread stops, and queued blocks are dropped.
+	}
 	txWorker_->finish(); // if isActive() == true, following 2 lines mean force termination, otherwise they have no effect because both tx and rxWorker have already finished.
 	rxWorker_->finish();
 	monitor_->finish();
-	tpool_.joinAll();
+	tasks_.join(); // including the dispatcher, whose listener refers to this controller
+	dispatcher_.reset();
 	//poco_debug(logger_,"AsynchronousCallbackAPIController: Asynchronous callback API closed.");
 }
 
@@ -43,6 +53,11 @@ bool mimiioAsynchronousCallbackAPIController::isActive() const
 	}
 }
 
+bool mimiioAsynchronousCallbackAPIController::completed() const
+{
+	return !isActive() && monitor_->finished();
+}
+
 MIMIIO_STREAM_STATE mimiioAsynchronousCallbackAPIController::streamState() const
 {
 	if(!started_){
@@ -61,13 +76,107 @@ MIMIIO_STREAM_STATE mimiioAsynchronousCallbackAPIController::streamState() const
 }
 
 
+int mimiioAsynchronousCallbackAPIController::setTxCoalescing(size_t max_bytes, int max_delay_ms)
+{
+	if(started_){
+		logger_.error("AsynchronousCallbackAPIController: tx coalescing must be set before start (908).");
+		return 908;
+	}
+	txWorker_->setCoalescing(max_bytes, max_delay_ms);
+	return 0;
+}
+
+int mimiioAsynchronousCallbackAPIController::setRxDispatch(size_t queue_length, MIMIIO_RX_OVERFLOW_POLICY policy)
+{
+	if(started_){
+		logger_.error("AsynchronousCallbackAPIController: rx dispatch must be set before start (908).");
+		return 908;
+	}
+	if(queue_length == 0){
+		rxWorker_->setDispatcher(nullptr);
+		dispatcher_.reset();
+		return 0;
+	}
+	dispatcher_.reset(new worker::mimiioRxDispatcher(rxfunc_, userdata_for_rx_, queue_length, policy, notifier_, logger_));
+	dispatcher_->setListener([this]{ notifier_.notify(); });
+	rxWorker_->setDispatcher(dispatcher_.get());
+	return 0;
+}
+
+int mimiioAsynchronousCallbackAPIController::setTxPipeline(size_t queue_length)
+{
+	if(started_){
+		logger_.error("AsynchronousCallbackAPIController: tx pipeline must be set before start (908).");
+		return 908;
+	}
+	if(queue_length == 0){
+		txWorker_->setPipeline(nullptr);
+		pipeline_.reset();
+		return 0;
+	}
+	pipeline_ = std::make_shared<worker::mimiioTxPipeline>(impl_, encoder_, queue_length, mimiioRuntime::instance().encoders(logger_), logger_);
+	pipeline_->setListener([this]{ txWorker_->wakeup(); });
+	txWorker_->setPipeline(pipeline_.get());
+	return 0;
+}
+
+void mimiioAsynchronousCallbackAPIController::configure(const MIMIIO_OPEN_OPTIONS& options)
+{
+	mimiioController::configure(options);
+	txWorker_->setBufferSize(options.send_buffer_size);
+	txWorker_->setIdleSleep(options.tx_idle_sleep_ms);
+	const Poco::Thread::Priority priority = static_cast<Poco::Thread::Priority>(Poco::Thread::PRIO_NORMAL + options.thread_priority);
+	txThread_.stackSize = rxThread_.stackSize = options.thread_stack_size;
+	txThread_.priority = rxThread_.priority = priority;
+	txThread_.cpu = options.tx_cpu;
+	rxThread_.cpu = options.rx_cpu;
+}
+
+void mimiioAsynchronousCallbackAPIController::setPushSource(worker::mimiioPushSource* source)
+{
+	mimiioController::setPushSource(source);
+	push_->setListener([this]{ txWorker_->wakeup(); });
+	txWorker_->setPushSource(source);
+}
+
+void mimiioAsynchronousCallbackAPIController::abandon()
+{
+	mimiioController::abandon(); // no state is reported while closing
+	txWorker_->detach();
+	rxWorker_->detach(); // keeps receiving until the close frame of the remote host
+}
+
+bool mimiioAsynchronousCallbackAPIController::txFinished() const
+{
+	return !started_ || txWorker_->finished();
+}
+
+bool mimiioAsynchronousCallbackAPIController::rxFinished() const
+{
+	return !started_ || rxWorker_->finished();
+}
+
+void mimiioAsynchronousCallbackAPIController::interrupt()
+{
+	txWorker_->finish();
+	rxWorker_->finish();
+	mimiioController::interrupt();
+}
+
 int mimiioAsynchronousCallbackAPIController::start()
 {
 	try{
 		poco_debug(logger_, "AsynchronousCallbackAPIController: Asynchronous callback API starts");
-		tpool_.start(*(monitor_.get()));
-		tpool_.start(*(txWorker_.get()));
-		tpool_.start(*(rxWorker_.get()));
+		Poco::ThreadPool& pool = mimiioRuntime::instance().workers(logger_);
+		if(dispatcher_){
+			dispatcher_->start(tasks_, pool);
+		}
+		tasks_.start(pool, *(monitor_.get()));
+		if(pipeline_){
+			tasks_.start(pool, *(pipeline_.get()));
+		}
+		tasks_.start(pool, *(txWorker_.get()), txThread_);
+		tasks_.start(pool, *(rxWorker_.get()), rxThread_);
 		started_ = true;
 		return 0;
 	}catch(std::exception &e){
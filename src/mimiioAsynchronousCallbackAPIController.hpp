@@ -9,9 +9,11 @@
 #define LIBMIMIIO_MIMIIOASYNCHRONOUSCALLBACKAPICONTROLLER_HPP_
 
 #include "mimiioController.hpp"
+#include "mimiioTaskGroup.hpp"
 #include "worker/mimiioRxWorker.hpp"
 #include "worker/mimiioTxWorker.hpp"
 #include <Poco/Runnable.h>
+#include <atomic>
 
 namespace mimiio{
 class mimiioImpl;
@@ -25,10 +27,12 @@ public:
 	mimiioAsynchronousCallbackAPIMonitor(const worker::mimiioRxWorker::Ptr& rxWorker,
 										 const worker::mimiioTxWorker::Ptr& txWorker,
 										 int* errorno,
+										 mimiioNotifier& notifier,
 										 Poco::Logger& logger) :
 										 rxWorker_(rxWorker),
 										 txWorker_(txWorker),
 										 errorno_(errorno),
+										 notifier_(notifier),
 										 finish_(false),
 										 finished_(false),
 										 logger_(logger)
@@ -46,7 +50,11 @@ public:
 	 *
 	 * When this function calls, internal finish_ flag is true, then audio sending loop in run() is break.
 	 */
-	void finish(){ finish_ = true; }
+	void finish()
+	{
+		finish_ = true;
+		notifier_.notify();
+	}
 
 	/**
 	 * @brief Get finish flag, that is indicated audio sending loop is whether finished or not.
@@ -56,38 +64,39 @@ public:
 	bool finished() const { return finished_; }
 
 	/**
-	 * @brief Start audio-sending loop
+	 * @brief Wait for an error of workers, or the end of both workers
 	 *
-	 * This loop is break when finish() is called.
+	 * Sleeps until a worker finishes, and returns when finish() is called.
 	 */
 	void run()
 	{
-		poco_debug(logger_,"AsynchronousCallbackAPIMonitor: loop starts.");
-		while(!finish_){
-			if(txWorker_->errorno() != 0 || rxWorker_->errorno() != 0){
-				if(txWorker_->errorno() != 0){
-					*errorno_ = txWorker_->errorno();
-					poco_debug_f1(logger_, "AsynchronousCallbackAPIMonitor: txWorker error detected, errorno = %d", *errorno_);
-				}else{
-					*errorno_ = rxWorker_->errorno();
-					poco_debug_f1(logger_, "AsynchronousCallbackAPIMonitor: rxWorker error detected, errorno = %d", *errorno_);
-				}
-				txWorker_->finish();
-				rxWorker_->finish();
-				break; // finish monitor
+		poco_debug(logger_,"AsynchronousCallbackAPIMonitor: waiting for workers.");
+		notifier_.wait(-1, [this]{
+			return finish_ || txWorker_->errorno() != 0 || rxWorker_->errorno() != 0 || (txWorker_->finished() && rxWorker_->finished());
+		});
+		if(!finish_ && (txWorker_->errorno() != 0 || rxWorker_->errorno() != 0)){
+			if(txWorker_->errorno() != 0){
+				*errorno_ = txWorker_->errorno();
+				poco_debug_f1(logger_, "AsynchronousCallbackAPIMonitor: txWorker error detected, errorno = %d", *errorno_);
+			}else{
+				*errorno_ = rxWorker_->errorno();
+				poco_debug_f1(logger_, "AsynchronousCallbackAPIMonitor: rxWorker error detected, errorno = %d", *errorno_);
 			}
-			Poco::Thread::sleep(10);
+			txWorker_->finish();
+			rxWorker_->finish();
 		}
 		poco_debug(logger_,"AsynchronousCallbackAPIMonitor: loop ends.");
 		finished_ = true;
+		notifier_.notify(); // errorno has been reported
 	}
 
 private:
 	const worker::mimiioRxWorker::Ptr &rxWorker_;
 	const worker::mimiioTxWorker::Ptr &txWorker_;
 	int* errorno_;
-	bool finish_;
-	bool finished_;
+	mimiioNotifier& notifier_;
+	std::atomic<bool> finish_;
+	std::atomic<bool> finished_;
 	Poco::Logger& logger_;
 };
 
@@ -145,6 +154,63 @@ public:
 	 */
 	virtual int start();
 
+	/**
+	 * @brief Set coalescing policy of encoded audio data
+	 *
+	 * @param [in] max_bytes encoded audio data is sent when it reaches this size, 0 means no coalescing.
+	 * @param [in] max_delay_ms encoded audio data is sent when the oldest data has waited for this time in milliseconds.
+	 * @return 0 if succeeded, 908 if the API has been already started.
+	 */
+	virtual int setTxCoalescing(size_t max_bytes, int max_delay_ms);
+
+	/**
+	 * @brief Call rxfunc on a thread of the worker pool through a bounded queue
+	 *
+	 * @param [in] queue_length the maximum number of queued results, 0 means rxfunc is called by the rx worker.
+	 * @param [in] policy behavior when the queue is full
+	 * @return 0 if succeeded, 908 if the API has been already started.
+	 */
+	virtual int setRxDispatch(size_t queue_length, MIMIIO_RX_OVERFLOW_POLICY policy);
+
+	/**
+	 * @brief Encode audio on the encoder pool and send it on a thread of the worker pool
+	 *
+	 * @param [in] queue_length the maximum number of blocks in each queue, 0 means the tx worker encodes and sends audio.
+	 * @return 0 if succeeded, 908 if the API has been already started.
+	 */
+	virtual int setTxPipeline(size_t queue_length);
+
+	/**
+	 * @brief Apply buffer size and idle sleep to the tx worker, and thread settings to both workers
+	 */
+	virtual void configure(const MIMIIO_OPEN_OPTIONS& options);
+
+	/**
+	 * @brief Use pushed audio, the tx worker is woken up when audio is pushed.
+	 */
+	virtual void setPushSource(worker::mimiioPushSource* source);
+
+	/**
+	 * @brief Detach txfunc and rxfunc from both workers, and finish the tx worker.
+	 */
+	virtual void abandon();
+
+protected:
+
+	/**
+	 * @brief Both workers have finished and the monitor has reported the error, if any.
+	 */
+	virtual bool completed() const;
+
+	virtual bool txFinished() const;
+
+	virtual bool rxFinished() const;
+
+	/**
+	 * @brief Finish both workers and shut down the socket
+	 */
+	virtual void interrupt();
+
 private:
 
 	mimiioAsynchronousCallbackAPIController(mimiioAsynchronousCallbackAPIController const&) = delete;
@@ -152,9 +218,13 @@ private:
 	mimiioAsynchronousCallbackAPIController& operator = (mimiioAsynchronousCallbackAPIController const&) = delete;
 	mimiioAsynchronousCallbackAPIController& operator = (mimiioAsynchronousCallbackAPIController&&) = delete;
 
-	Poco::ThreadPool tpool_;
+	mimiioTaskGroup tasks_; // on the process-wide worker pool
+	mimiioThreadSettings txThread_;
+	mimiioThreadSettings rxThread_;
 	worker::mimiioRxWorker::Ptr rxWorker_;
 	worker::mimiioTxWorker::Ptr txWorker_;
+	ON_RX_CALLBACK_T rxfunc_;
+	void* userdata_for_rx_;
 	mimiioAsynchronousCallbackAPIMonitor::Ptr monitor_;
 };
 
@@ -0,0 +1,65 @@
+/**
+ * @file mimiioCallbackGate.hpp
+ * @brief Guard of user callbacks, which are never called once the gate is closed.
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_MIMIIOCALLBACKGATE_HPP__
+#define LIBMIMIIO_MIMIIOCALLBACKGATE_HPP__
+
+#include <mutex>
+
+namespace mimiio{
+
+/**
+ * @class mimiioCallbackGate
+ * @brief Guard of a user callback
+ *
+ * mimi_close() returns before the connection is closed, while the user may release the user data as soon as it returns.
+ * close() waits for the callback running now, if any, and no callback is called after that.
+ * A callback must not close its own gate, i.e. must not call mimi_close() for its own connection.
+ */
+class mimiioCallbackGate
+{
+public:
+
+	mimiioCallbackGate() : closed_(false){}
+
+	/**
+	 * @brief Call \e callback unless the gate is closed
+	 *
+	 * @param [in] callback callable without arguments
+	 * @return true if called, false if the gate is closed.
+	 */
+	template<class Callback>
+	bool call(Callback callback)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if(closed_){
+			return false;
+		}
+		callback();
+		return true;
+	}
+
+	/**
+	 * @brief Close the gate, waiting for the callback running on another thread to return
+	 */
+	void close()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		closed_ = true;
+	}
+
+private:
+
+	mimiioCallbackGate(mimiioCallbackGate const&) = delete;
+	mimiioCallbackGate& operator = (mimiioCallbackGate const&) = delete;
+
+	std::mutex mutex_; // held while the callback is running, callbacks of one gate never run concurrently
+	bool closed_;
+};
+
+}
+
+#endif
@@ -0,0 +1,80 @@
+/**
+ * @file mimiioConnectStats.cpp
+ * @brief Process-wide statistics of connection-phase latency.
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "mimiioConnectStats.hpp"
+#include <algorithm>
+
+namespace mimiio{
+
+const size_t connect_stats_samples_ = 1024; //!< The number of latest connections kept for percentiles
+
+namespace {
+
+long nth(std::vector<long>& values, double percentile)
+{
+	size_t n = static_cast<size_t>(percentile / 100.0 * static_cast<double>(values.size() - 1) + 0.5);
+	std::nth_element(values.begin(), values.begin() + n, values.end());
+	return values[n];
+}
+
+}
+
+mimiioConnectStats& mimiioConnectStats::instance()
+{
+	static mimiioConnectStats stats;
+	return stats;
+}
+
+mimiioConnectStats::mimiioConnectStats() :
+		next_(0)
+{
+	samples_.reserve(connect_stats_samples_);
+}
+
+void mimiioConnectStats::record(const MIMIIO_CONNECT_TIMINGS& timings)
+{
+	Poco::FastMutex::ScopedLock lock(mutex_);
+	if(samples_.size() < connect_stats_samples_){
+		samples_.push_back(timings);
+	}else{
+		samples_[next_] = timings;
+	}
+	next_ = (next_ + 1) % connect_stats_samples_;
+}
+
+int mimiioConnectStats::percentile(double percentile, MIMIIO_CONNECT_TIMINGS& timings, int& resumed)
+{
+	std::vector<MIMIIO_CONNECT_TIMINGS> samples;
+	{
+		Poco::FastMutex::ScopedLock lock(mutex_);
+		samples = samples_;
+	}
+	timings = MIMIIO_CONNECT_TIMINGS();
+	resumed = 0;
+	if(samples.empty()){
+		return 0;
+	}
+	percentile = std::min(std::max(percentile, 0.0), 100.0);
+	std::vector<long> values(samples.size());
+	long MIMIIO_CONNECT_TIMINGS::* phases[] = {
+			&MIMIIO_CONNECT_TIMINGS::dns_usec,
+			&MIMIIO_CONNECT_TIMINGS::connect_usec,
+			&MIMIIO_CONNECT_TIMINGS::ssl_usec,
+			&MIMIIO_CONNECT_TIMINGS::upgrade_usec,
+			&MIMIIO_CONNECT_TIMINGS::total_usec };
+	for(size_t p=0;p<sizeof(phases)/sizeof(phases[0]);++p){
+		for(size_t i=0;i<samples.size();++i){
+			values[i] = samples[i].*phases[p];
+		}
+		timings.*phases[p] = nth(values, percentile);
+	}
+	for(size_t i=0;i<samples.size();++i){
+		resumed += samples[i].ssl_session_resumed;
+	}
+	return static_cast<int>(samples.size());
+}
+
+}
@@ -0,0 +1,61 @@
+/**
+ * @file mimiioConnectStats.hpp
+ * @brief Process-wide statistics of connection-phase latency.
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_MIMIIOCONNECTSTATS_HPP__
+#define LIBMIMIIO_MIMIIOCONNECTSTATS_HPP__
+
+#include "mimiio.h"
+#include <Poco/Mutex.h>
+#include <vector>
+
+namespace mimiio{
+
+/**
+ * @class mimiioConnectStats
+ * @brief Keeps connection timings of the latest connections opened in this process and computes their percentiles.
+ */
+class mimiioConnectStats
+{
+public:
+
+	/**
+	 * @brief Get the process-wide instance
+	 */
+	static mimiioConnectStats& instance();
+
+	/**
+	 * @brief Record timings of a newly established connection
+	 *
+	 * @param [in] timings connection timings
+	 */
+	void record(const MIMIIO_CONNECT_TIMINGS& timings);
+
+	/**
+	 * @brief Compute percentile of each phase over recorded connections
+	 *
+	 * Each phase is computed independently, so the phases of the result do not necessarily add up to its total.
+	 *
+	 * @param [in] percentile percentile in [0, 100]
+	 * @param [out] timings percentile of each phase, ssl_session_resumed and pooled are 0.
+	 * @param [out] resumed the number of connections which resumed SSL session
+	 * @return the number of connections used for computation.
+	 */
+	int percentile(double percentile, MIMIIO_CONNECT_TIMINGS& timings, int& resumed);
+
+private:
+
+	mimiioConnectStats();
+	mimiioConnectStats(mimiioConnectStats const&) = delete;
+	mimiioConnectStats& operator = (mimiioConnectStats const&) = delete;
+
+	Poco::FastMutex mutex_;
+	std::vector<MIMIIO_CONNECT_TIMINGS> samples_; // ring buffer
+	size_t next_;
+};
+
+}
+
+#endif
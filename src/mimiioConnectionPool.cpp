@@ -0,0 +1,201 @@
+/**
+ * @file mimiioConnectionPool.cpp
+ * @brief Pool of pre-established mimi(R) WebSocket connections.
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "mimiioConnectionPool.hpp"
+#include "strerror.hpp"
+#include <Poco/Format.h>
+#include <algorithm>
+#include <map>
+
+namespace mimiio{
+
+const long pool_retry_min_msec_ = 1000;  //!< Wait before retrying a failed refill
+const long pool_retry_max_msec_ = 30000; //!< Maximum wait before retrying a failed refill, doubled on each failure.
+const long pool_check_msec_ = 1000;      //!< Interval of checking idle connections
+
+namespace {
+
+Poco::FastMutex& registryMutex()
+{
+	static Poco::FastMutex mutex;
+	return mutex;
+}
+
+std::map<std::string, mimiioConnectionPool*>& registry()
+{
+	static std::map<std::string, mimiioConnectionPool*> pools;
+	return pools;
+}
+
+}
+
+mimiioConnectionPool::mimiioConnectionPool(const std::string& hostname,
+										   int port,
+										   const std::vector<MIMIIO_HTTP_REQUEST_HEADER>& requestHeaders,
+										   const char* accessToken,
+										   int size,
+										   int ttl_sec,
+										   Poco::Logger& logger) :
+										   hostname_(hostname),
+										   port_(port),
+										   requestHeaders_(requestHeaders),
+										   authenticate_(accessToken != nullptr),
+										   accessToken_(accessToken != nullptr ? accessToken : ""),
+										   key_(makeKey(hostname, port, requestHeaders, accessToken)),
+										   size_(static_cast<size_t>(std::max(size, 1))),
+										   ttl_(static_cast<Poco::Timestamp::TimeDiff>(std::max(ttl_sec, 1)) * 1000000),
+										   errorno_(0),
+										   finish_(false),
+										   wakeup_(true),
+										   logger_(logger)
+{
+	{
+		Poco::FastMutex::ScopedLock lock(registryMutex());
+		registry()[key_] = this; // the latest pool wins if two pools have the same key.
+	}
+	thread_.start(*this);
+	poco_debug_f3(logger_, "lmio: connection pool: initialized for %s:%d, size = %z.", hostname_, port_, size_);
+}
+
+mimiioConnectionPool::~mimiioConnectionPool()
+{
+	{
+		Poco::FastMutex::ScopedLock lock(registryMutex());
+		std::map<std::string, mimiioConnectionPool*>::iterator it = registry().find(key_);
+		if(it != registry().end() && it->second == this){
+			registry().erase(it);
+		}
+	}
+	finish_ = true;
+	wakeup_.set();
+	thread_.join(); // waits for the connection being established, if any.
+	for(size_t i=0;i<idle_.size();++i){
+		delete idle_[i].impl;
+	}
+	idle_.clear();
+	poco_debug(logger_, "lmio: connection pool: closed.");
+}
+
+std::string mimiioConnectionPool::makeKey(const std::string& hostname,
+										  int port,
+										  const std::vector<MIMIIO_HTTP_REQUEST_HEADER>& requestHeaders,
+										  const char* accessToken)
+{
+	std::string key = Poco::format("%s:%d\n", hostname, port);
+	key += (accessToken == nullptr) ? std::string("-") : "+" + std::string(accessToken);
+	for(size_t i=0;i<requestHeaders.size();++i){
+		key += "\n" + std::string(requestHeaders[i].key) + ":" + std::string(requestHeaders[i].value);
+	}
+	return key;
+}
+
+mimiioImpl* mimiioConnectionPool::acquire(const std::string& hostname,
+										  int port,
+										  const std::vector<MIMIIO_HTTP_REQUEST_HEADER>& requestHeaders,
+										  const char* accessToken)
+{
+	Poco::FastMutex::ScopedLock lock(registryMutex()); // the pool can not be destroyed while taking.
+	if(registry().empty()){
+		return nullptr;
+	}
+	std::map<std::string, mimiioConnectionPool*>::iterator it = registry().find(makeKey(hostname, port, requestHeaders, accessToken));
+	if(it == registry().end()){
+		return nullptr;
+	}
+	return it->second->take();
+}
+
+mimiioImpl* mimiioConnectionPool::take()
+{
+	mimiioImpl* impl = nullptr;
+	{
+		Poco::FastMutex::ScopedLock lock(mutex_);
+		Poco::Timestamp now;
+		while(!idle_.empty()){
+			Entry entry = idle_.back(); // the newest one has the longest time to live
+			idle_.pop_back();
+			if(entry.expires <= now || entry.impl->stale()){
+				delete entry.impl;
+				continue;
+			}
+			impl = entry.impl;
+			impl->set_pooled();
+			break;
+		}
+	}
+	wakeup_.set(); // refill
+	if(impl == nullptr){
+		poco_debug(logger_, "lmio: connection pool: no connection is ready.");
+	}
+	return impl;
+}
+
+int mimiioConnectionPool::available()
+{
+	Poco::FastMutex::ScopedLock lock(mutex_);
+	return static_cast<int>(idle_.size());
+}
+
+mimiioImpl* mimiioConnectionPool::connect()
+{
+	if(authenticate_){
+		return new mimiioImpl(hostname_, port_, requestHeaders_, accessToken_, logger_);
+	}else{
+		return new mimiioImpl(hostname_, port_, requestHeaders_, logger_);
+	}
+}
+
+void mimiioConnectionPool::retire()
+{
+	std::vector<mimiioImpl*> retired;
+	{
+		Poco::FastMutex::ScopedLock lock(mutex_);
+		Poco::Timestamp now;
+		std::deque<Entry>::iterator it = idle_.begin();
+		while(it != idle_.end()){
+			if(it->expires <= now || it->impl->stale()){
+				retired.push_back(it->impl);
+				it = idle_.erase(it);
+			}else{
+				++it;
+			}
+		}
+	}
+	for(size_t i=0;i<retired.size();++i){
+		delete retired[i];
+	}
+	if(!retired.empty()){
+		poco_debug_f1(logger_, "lmio: connection pool: %z idle connections retired.", retired.size());
+	}
+}
+
+void mimiioConnectionPool::run()
+{
+	long retry_msec = pool_retry_min_msec_;
+	while(!finish_){
+		retire();
+		long wait_msec = pool_check_msec_;
+		while(!finish_ && available() < static_cast<int>(size_)){
+			try{
+				Entry entry;
+				entry.impl = connect();
+				entry.expires += ttl_;
+				Poco::FastMutex::ScopedLock lock(mutex_);
+				idle_.push_back(entry);
+				errorno_ = 0;
+				retry_msec = pool_retry_min_msec_;
+			}catch(...){
+				errorno_ = open_errorno(logger_, "connection pool");
+				wait_msec = retry_msec;
+				retry_msec = std::min(retry_msec * 2, pool_retry_max_msec_);
+				break;
+			}
+		}
+		wakeup_.tryWait(wait_msec);
+	}
+}
+
+}
@@ -0,0 +1,134 @@
+/**
+ * @file mimiioConnectionPool.hpp
+ * @brief Pool of pre-established mimi(R) WebSocket connections.
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_MIMIIOCONNECTIONPOOL_HPP__
+#define LIBMIMIIO_MIMIIOCONNECTIONPOOL_HPP__
+
+#include "mimiio.h"
+#include "mimiioImpl.hpp"
+#include <Poco/Runnable.h>
+#include <Poco/Thread.h>
+#include <Poco/Event.h>
+#include <Poco/Mutex.h>
+#include <Poco/Timestamp.h>
+#include <Poco/Logger.h>
+#include <atomic>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace mimiio{
+
+/**
+ * @class mimiioConnectionPool
+ * @brief Keeps pre-established, authenticated and upgraded connections to a remote host.
+ *
+ * A pool is identified by the remote host, port, request headers and access token of its connections.
+ * Background thread refills the pool up to its size, and retires idle connections before they
+ * reach their time to live so that remote host never closes them by idle timeout.
+ * mimi_open() takes a connection from the pool which has the same key, instead of connecting.
+ */
+class mimiioConnectionPool : public Poco::Runnable
+{
+public:
+
+	/**
+	 * @brief C'tor, register the pool and start refilling.
+	 *
+	 * @param [in] hostname mimi(R) remote host
+	 * @param [in] port mimi(R) remote port
+	 * @param [in] requestHeaders HTTP request headers which is sent with WebSocket upgrade request.
+	 * @param [in] accessToken access token, or NULL for connections without authentication.
+	 * @param [in] size the number of connections to be kept
+	 * @param [in] ttl_sec time to live of an idle connection in seconds
+	 * @param [in] logger logger
+	 */
+	mimiioConnectionPool(const std::string& hostname,
+						 int port,
+						 const std::vector<MIMIIO_HTTP_REQUEST_HEADER>& requestHeaders,
+						 const char* accessToken,
+						 int size,
+						 int ttl_sec,
+						 Poco::Logger& logger);
+
+	/**
+	 * @brief D'tor, unregister the pool, stop refilling and close all idle connections.
+	 */
+	~mimiioConnectionPool();
+
+	/**
+	 * @brief Take a connection from the registered pool which matches the parameters.
+	 *
+	 * @param [in] hostname mimi(R) remote host
+	 * @param [in] port mimi(R) remote port
+	 * @param [in] requestHeaders HTTP request headers which is sent with WebSocket upgrade request.
+	 * @param [in] accessToken access token, or NULL for connections without authentication.
+	 * @return established connection, or NULL if no matching pool or no connection is ready.
+	 */
+	static mimiioImpl* acquire(const std::string& hostname,
+							   int port,
+							   const std::vector<MIMIIO_HTTP_REQUEST_HEADER>& requestHeaders,
+							   const char* accessToken);
+
+	/**
+	 * @brief Get the number of connections which are ready to use.
+	 */
+	int available();
+
+	/**
+	 * @brief Get the error code of the last failed refill, 0 if the last refill succeeded.
+	 */
+	int errorno() const { return errorno_.load(); }
+
+	/**
+	 * @brief Refill loop
+	 */
+	void run();
+
+private:
+
+	/**
+	 * @brief Pooled connection
+	 */
+	struct Entry
+	{
+		mimiioImpl* impl;
+		Poco::Timestamp expires;
+	};
+
+	static std::string makeKey(const std::string& hostname,
+							   int port,
+							   const std::vector<MIMIIO_HTTP_REQUEST_HEADER>& requestHeaders,
+							   const char* accessToken);
+
+	mimiioImpl* take();
+	mimiioImpl* connect();
+	void retire();
+
+	mimiioConnectionPool(mimiioConnectionPool const&) = delete;
+	mimiioConnectionPool& operator = (mimiioConnectionPool const&) = delete;
+
+	const std::string hostname_;
+	const int port_;
+	std::vector<MIMIIO_HTTP_REQUEST_HEADER> requestHeaders_;
+	const bool authenticate_;
+	const std::string accessToken_;
+	const std::string key_;
+	const size_t size_;
+	const Poco::Timestamp::TimeDiff ttl_;
+	std::atomic<int> errorno_;
+	std::atomic<bool> finish_;
+
+	Poco::FastMutex mutex_;
+	std::deque<Entry> idle_; // oldest first
+	Poco::Event wakeup_;
+	Poco::Thread thread_;
+	Poco::Logger& logger_;
+};
+
+}
+
+#endif
@@ -15,8 +15,11 @@ mimiioController::mimiioController(mimiioImpl* impl, encoder::Encoder* encoder,
 		encoder_(encoder),
 		logger_(logger),
 		errorno_(0),
-		started_(false)
+		started_(false),
+		closeSent_(false),
+		reportedState_(MIMIIO_STREAM_WAIT)
 {
+	notifier_.setListener([this]{ reportState(); });
 	poco_debug(logger_, "mimiioController: initialized.");
 }
 
@@ -26,6 +29,159 @@ mimiioController::~mimiioController()
 	//logger_.getChannel()->close();
 }
 
+int mimiioController::setNativeFraming(bool enable)
+{
+	if(started_){
+		logger_.error("mimiioController: native framing must be set before start (908).");
+		return 908;
+	}
+	impl_->set_native_framing(enable);
+	return 0;
+}
+
+void mimiioController::configure(const MIMIIO_OPEN_OPTIONS& options)
+{
+	impl_->set_timeouts(options.send_timeout_ms, options.recv_timeout_ms);
+}
+
+int mimiioController::writeAudio(const char* data, size_t len)
+{
+	if(!push_){
+		return 912;
+	}
+	return push_->write(data, len);
+}
+
+int mimiioController::endAudio()
+{
+	if(!push_){
+		return 912;
+	}
+	return push_->end();
+}
+
+int mimiioController::setTxCoalescing(size_t max_bytes, int max_delay_ms)
+{
+	if(max_bytes == 0){
+		return 0; // default, nothing to change
+	}
+	logger_.error("mimiioController: tx coalescing: %s (917)", std::string(mimiio::strerror(917)));
+	return 917;
+}
+
+int mimiioController::setRxDispatch(size_t queue_length, MIMIIO_RX_OVERFLOW_POLICY policy)
+{
+	if(queue_length == 0){
+		return 0; // default, nothing to change
+	}
+	logger_.error("mimiioController: rx dispatch: %s (917)", std::string(mimiio::strerror(917)));
+	return 917;
+}
+
+int mimiioController::setTxPipeline(size_t queue_length)
+{
+	if(queue_length == 0){
+		return 0; // default, nothing to change
+	}
+	logger_.error("mimiioController: tx pipeline: %s (917)", std::string(mimiio::strerror(917)));
+	return 917;
+}
+
+void mimiioController::rxDispatchStats(MIMIIO_RX_DISPATCH_STATS& stats)
+{
+	if(!dispatcher_){
+		stats = MIMIIO_RX_DISPATCH_STATS();
+		return;
+	}
+	dispatcher_->stats(stats);
+}
+
+void mimiioController::txPipelineStats(MIMIIO_TX_PIPELINE_STATS& stats)
+{
+	if(!pipeline_){
+		stats = MIMIIO_TX_PIPELINE_STATS();
+		return;
+	}
+	pipeline_->stats(stats);
+}
+
+int mimiioController::txAcquire(char** data, size_t* capacity)
+{
+	if(!push_){
+		return 912;
+	}
+	return push_->acquire(data, capacity);
+}
+
+int mimiioController::txCommit(size_t len, bool recog_break)
+{
+	if(!push_){
+		return 912;
+	}
+	return push_->commit(len, recog_break);
+}
+
+int mimiioController::setStateListener(const std::function<void(MIMIIO_STREAM_STATE)>& listener)
+{
+	if(started_){
+		logger_.error("mimiioController: state callback must be set before start (908).");
+		return 908;
+	}
+	stateListener_ = listener;
+	return 0;
+}
+
+void mimiioController::reportState()
+{
+	stateGate_.call([this]{
+		const MIMIIO_STREAM_STATE state = streamState();
+		if(state == reportedState_ || (state == MIMIIO_STREAM_CLOSED && !completed())){
+			return; // closed is reported after the error is available by errorno()
+		}
+		poco_debug_f2(logger_, "mimiioController: stream state changed from %d to %d.", static_cast<int>(reportedState_), static_cast<int>(state));
+		reportedState_ = state;
+		notifier_.signal();
+		if(stateListener_){
+			stateListener_(state);
+		}
+	});
+}
+
+int mimiioController::step(long timeout_ms)
+{
+	logger_.error("mimiioController: %s (916)", std::string(mimiio::strerror(916)));
+	return 916;
+}
+
+int mimiioController::stepPoll(int* fd, bool* writable, long* timeout_ms)
+{
+	logger_.error("mimiioController: %s (916)", std::string(mimiio::strerror(916)));
+	return 916;
+}
+
+bool mimiioController::linger(bool expired)
+{
+	if(!closeSent_ && (expired || txFinished())){
+		if(txFinished()){
+			impl_->send_close(close_timeout_msec_); // not sent while the tx worker may be sending, frames must not be interleaved
+		}
+		closeSent_ = true;
+	}
+	if(!expired && !(closeSent_ && rxFinished())){
+		return false;
+	}
+	interrupt();
+	return true;
+}
+
+bool mimiioController::wait(long timeout_ms)
+{
+	if(!started_){
+		return !isActive();
+	}
+	return notifier_.wait(timeout_ms, [this]{ return completed(); });
+}
+
 int mimiioController::send(const std::vector<char>& buffer)
 {
 	try{
@@ -97,7 +253,9 @@ int mimiioController::receive(std::vector<char>& buffer, bool blocking)
 		short closeStatus = 0;
 		int n = impl_->receive_frame(buffer, opc, closeStatus);
 		poco_debug_f1(logger_, "mimiioController: receive (%d bytes)", n);
-		if(opc == mimiioImpl::PING_FRAME){
+		if(n < 0){
+			return 0; // no whole message on the non-blocking socket yet, the rest is received by the next call
+		}else if(opc == mimiioImpl::PING_FRAME){
 			return 0; // libmimiio user don't have to care about ping/pong response
 		}else if(opc == mimiioImpl::CLOSE_FRAME){
 			if(n == 0){
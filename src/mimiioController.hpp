@@ -11,8 +11,15 @@
 #include "typedef.hpp"
 #include "mimiioImpl.hpp"
 #include "mimiioEncoderFactory.hpp"
+#include "mimiioNotifier.hpp"
+#include "mimiioCallbackGate.hpp"
+#include "worker/mimiioPushSource.hpp"
+#include "worker/mimiioRxDispatcher.hpp"
+#include "worker/mimiioTxPipeline.hpp"
 #include <Poco/ThreadPool.h>
 #include <Poco/Logger.h>
+#include <atomic>
+#include <functional>
 
 namespace mimiio{
 
@@ -20,6 +27,8 @@ class mimiioController
 {
 public:
 
+	static const long close_timeout_msec_ = 100; //!< maximum time sending the close frame by linger(), within the linger time of mimiioReaper
+
 	/**
 	 * @brief C'tor with mimiioImpl class, mimi(R) API implementation class
 	 *
@@ -56,6 +65,80 @@ public:
 	 */
 	virtual MIMIIO_STREAM_STATE streamState() const = 0;
 
+	/**
+	 * @brief Wait until the connection becomes inactive
+	 *
+	 * Returns immediately if the API has not been started.
+	 *
+	 * @param [in] timeout_ms timeout in milliseconds, negative value for infinite.
+	 * @return true if the connection is not active, false if timed out.
+	 */
+	virtual bool wait(long timeout_ms);
+
+	/**
+	 * @brief Run one step of sending and receiving on the caller's thread
+	 *
+	 * Only for connections without internal threads, see mimiioCooperativeController.
+	 *
+	 * @param [in] timeout_ms maximum time waiting for a frame in milliseconds
+	 * @return 0 if succeeded, 916 if the connection is not cooperative.
+	 */
+	virtual int step(long timeout_ms);
+
+	/**
+	 * @brief Get what the next step() waits for, so that the caller can wait for it in its own event loop
+	 *
+	 * @param [out] fd socket which step() waits to become readable, -1 if nothing is received or sent any more.
+	 * @param [out] writable true if step() also waits for \e fd to become writable, to write queued frames.
+	 * @param [out] timeout_ms milliseconds until step() should be called without waiting for \e fd, -1 for infinite.
+	 * @return 0 if succeeded, 916 if the connection is not cooperative.
+	 */
+	virtual int stepPoll(int* fd, bool* writable, long* timeout_ms);
+
+	/**
+	 * @brief Stop calling user callbacks and let the connection close in the background, called by mimi_close()
+	 *
+	 * Does not wait for I/O, but waits for txfunc, rxfunc or the state listener running now, if any. No user callback is called after
+	 * this function returns, and the controller is passed to mimiioReaper. Subclasses with workers must override this function
+	 * and call it.
+	 */
+	virtual void abandon() { stateGate_.close(); }
+
+	/**
+	 * @brief Set the function called with the new stream state whenever streamState() changes
+	 *
+	 * Called on the thread which has changed the state, one at a time.
+	 *
+	 * @param [in] listener state listener
+	 * @return 0 if succeeded, 908 if the API has been already started.
+	 */
+	int setStateListener(const std::function<void(MIMIIO_STREAM_STATE)>& listener);
+
+	/**
+	 * @brief Report the stream state to the eventfd and the state listener if it has changed
+	 *
+	 * Called when workers notify, and by mimi_start().
+	 */
+	void reportState();
+
+	/**
+	 * @brief Get the eventfd which becomes readable when the stream state changes or rxfunc has been called
+	 *
+	 * @return file descriptor, -1 if not supported.
+	 */
+	int fd() { return notifier_.fd(); }
+
+	/**
+	 * @brief Advance the close handshake of an abandoned connection, called by mimiioReaper
+	 *
+	 * A close frame is sent after the tx worker has finished, waiting for the socket at most close_timeout_msec_, and the socket
+	 * is shut down after the rx worker has received the close frame of the remote host, or when \e expired is true.
+	 *
+	 * @param [in] expired linger time has passed
+	 * @return true if the controller can be destroyed without waiting for I/O
+	 */
+	bool linger(bool expired);
+
 	/**
 	 * @brief Send audio data to mimi(R) remote host.
 	 * @attention Synchronous API. Asynchronous callback API should be used for maximum performance and stability.
@@ -88,6 +171,107 @@ public:
 	 */
 	virtual int receive(std::vector<char>& buffer, bool blocking);
 
+	/**
+	 * @brief Apply per-connection options given to mimi_open_ex()
+	 *
+	 * Called once before start(). Subclasses apply the options for their workers and call this function.
+	 *
+	 * @param [in] options validated options
+	 */
+	virtual void configure(const MIMIIO_OPEN_OPTIONS& options);
+
+	/**
+	 * @brief Use audio pushed by writeAudio() instead of txfunc
+	 *
+	 * Called once before start(). The controller takes ownership of \e source, and null txfunc has been given to the constructor.
+	 * Subclasses connect the source to their tx worker.
+	 *
+	 * @param [in] source push source
+	 */
+	virtual void setPushSource(worker::mimiioPushSource* source) { push_.reset(source); }
+
+	/**
+	 * @brief Push audio data
+	 *
+	 * @param [in] data audio data
+	 * @param [in] len length of data
+	 * @return 0 if succeeded, otherwise error number.
+	 */
+	int writeAudio(const char* data, size_t len);
+
+	/**
+	 * @brief End pushed audio
+	 *
+	 * @return 0 if succeeded, otherwise error number.
+	 */
+	int endAudio();
+
+	/**
+	 * @brief Get the writable region of the push source
+	 *
+	 * @param [out] data start of the region
+	 * @param [out] capacity length of the region
+	 * @return 0 if succeeded, otherwise error number.
+	 */
+	int txAcquire(char** data, size_t* capacity);
+
+	/**
+	 * @brief Make audio written to the region returned by txAcquire() available for sending
+	 *
+	 * @param [in] len length of audio written
+	 * @param [in] recog_break end audio after this data
+	 * @return 0 if succeeded, otherwise error number.
+	 */
+	int txCommit(size_t len, bool recog_break);
+
+	/**
+	 * @brief Set coalescing policy of encoded audio data
+	 *
+	 * @param [in] max_bytes encoded audio data is sent when it reaches this size, 0 means no coalescing.
+	 * @param [in] max_delay_ms encoded audio data is sent when the oldest data has waited for this time in milliseconds.
+	 * @return 0 if succeeded, 917 if coalescing is not supported by this connection, otherwise error number.
+	 */
+	virtual int setTxCoalescing(size_t max_bytes, int max_delay_ms);
+
+	/**
+	 * @brief Call rxfunc on a thread of the worker pool through a bounded queue
+	 *
+	 * @param [in] queue_length the maximum number of queued results, 0 means rxfunc is called by the rx worker.
+	 * @param [in] policy behavior when the queue is full
+	 * @return 0 if succeeded, 917 if the queue is not supported by this connection, otherwise error number.
+	 */
+	virtual int setRxDispatch(size_t queue_length, MIMIIO_RX_OVERFLOW_POLICY policy);
+
+	/**
+	 * @brief Get statistics of the queue of received results, all 0 without the queue.
+	 *
+	 * @param [out] stats statistics
+	 */
+	void rxDispatchStats(MIMIIO_RX_DISPATCH_STATS& stats);
+
+	/**
+	 * @brief Encode audio on the encoder pool and send it on another thread, pipelined with the tx worker
+	 *
+	 * @param [in] queue_length the maximum number of blocks in each queue, 0 means the tx worker encodes and sends audio.
+	 * @return 0 if succeeded, 917 if the pipeline is not supported by this connection, otherwise error number.
+	 */
+	virtual int setTxPipeline(size_t queue_length);
+
+	/**
+	 * @brief Get statistics of the queues of the tx pipeline, all 0 without the pipeline.
+	 *
+	 * @param [out] stats statistics
+	 */
+	void txPipelineStats(MIMIIO_TX_PIPELINE_STATS& stats);
+
+	/**
+	 * @brief Use built-in WebSocket framer instead of Poco::Net::WebSocket for frame I/O
+	 *
+	 * @param [in] enable true for built-in framer
+	 * @return 0 if succeeded, 908 if the API has been already started, 917 if the connection requires the built-in framer.
+	 */
+	virtual int setNativeFraming(bool enable);
+
 	/**
 	 * @brief Get errorno
 	 *
@@ -95,12 +279,57 @@ public:
 	 */
 	int errorno() const { return errorno_; }
 
+	/**
+	 * @brief Get elapsed time of each phase of opening the connection
+	 *
+	 * @return connection timings
+	 */
+	const MIMIIO_CONNECT_TIMINGS& connectTimings() const { return impl_->timings(); }
+
+	/**
+	 * @brief Get kernel TLS offload flags of the connection
+	 */
+	int tlsOffload() const { return impl_->tls_offload(); }
+
 protected:
+
+	/**
+	 * @brief Determine whether the connection has become inactive and its error has been reported to errorno_
+	 *
+	 * Subclasses must call notifier_.notify() when the result of this function may have changed.
+	 */
+	virtual bool completed() const { return !isActive(); }
+
+	/**
+	 * @brief Determine whether nothing is sent by the tx worker any more, for linger()
+	 */
+	virtual bool txFinished() const { return true; }
+
+	/**
+	 * @brief Determine whether nothing is received by the rx worker any more, for linger()
+	 */
+	virtual bool rxFinished() const { return true; }
+
+	/**
+	 * @brief Interrupt blocked I/O of workers, for linger()
+	 *
+	 * Subclasses finish their workers and call this function, which shuts down the socket.
+	 */
+	virtual void interrupt() { impl_->shutdown(); }
+
+	mimiioNotifier notifier_;
+	worker::mimiioPushSource::Ptr push_; // only for push API
+	worker::mimiioRxDispatcher::Ptr dispatcher_; // only if set by setRxDispatch(), subclasses must abort it before their workers are destroyed
+	worker::mimiioTxPipeline::Ptr pipeline_; // only if set by setTxPipeline(), subclasses must finish it before their workers are destroyed
 	mimiioImpl::Ptr impl_;
 	encoder::Encoder::Ptr encoder_;
 	Poco::Logger& logger_;
 	int errorno_;
-	bool started_; // for streamState();
+	std::atomic<bool> started_; // for streamState();
+	bool closeSent_; // only accessed by linger()
+	mimiioCallbackGate stateGate_; // for stateListener_
+	std::function<void(MIMIIO_STREAM_STATE)> stateListener_;
+	MIMIIO_STREAM_STATE reportedState_; // accessed with stateGate_ locked
 
 private:
 
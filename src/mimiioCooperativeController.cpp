@@ -0,0 +1,126 @@
+/**
+ * @file mimiioCooperativeController.cpp
+ * @brief Controller class for asynchronous callback API driven by the caller's loop
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "mimiioCooperativeController.hpp"
+
+namespace mimiio{
+
+mimiioCooperativeController::mimiioCooperativeController(
+		mimiioImpl* impl,
+		encoder::Encoder* encoder,
+		ON_TX_CALLBACK_T txfunc,
+		ON_RX_CALLBACK_T rxfunc,
+		void* userdata_for_tx,
+		void* userdata_for_rx,
+		Poco::Logger& logger) :
+		mimiioSteppedController(impl, encoder, txfunc, rxfunc, userdata_for_tx, userdata_for_rx, "CooperativeController", logger),
+		txWakeup_(false)
+{
+	poco_debug(logger_, "CooperativeController: initialized.");
+}
+
+mimiioCooperativeController::~mimiioCooperativeController()
+{
+	poco_debug(logger_, "CooperativeController: closed.");
+}
+
+int mimiioCooperativeController::start()
+{
+	poco_debug(logger_, "CooperativeController: Asynchronous callback API starts on the caller's loop");
+	impl_->set_native_framing(true); // resumes frames split by the network
+	impl_->set_blocking(false);      // step() waits only for the socket within its timeout
+	txDue_.update();
+	started_ = true;
+	return 0;
+}
+
+bool mimiioCooperativeController::wait(long timeout_ms)
+{
+	return !isActive();
+}
+
+void mimiioCooperativeController::setPushSource(worker::mimiioPushSource* source)
+{
+	mimiioController::setPushSource(source);
+	push_->setListener([this]{ txWakeup_ = true; }); // run the tx step on the next call instead of waiting until it is due
+	txWorker_->setPushSource(source);
+}
+
+void mimiioCooperativeController::abandon()
+{
+	mimiioController::abandon(); // no state is reported while closing
+	txWorker_->detach();
+	txWorker_->step(); // mark finished without sending, step() is not called any more
+	rxWorker_->detach();
+}
+
+long mimiioCooperativeController::txWait() const
+{
+	if(txWorker_->finished() || impl_->send_pending()){
+		return -1; // due when queued frames have been written
+	}
+	if(txWakeup_){
+		return 0;
+	}
+	Poco::Clock now;
+	Poco::Clock::ClockDiff usec = txDue_ - now;
+	return usec <= 0 ? 0 : static_cast<long>((usec + 999) / 1000);
+}
+
+int mimiioCooperativeController::step(long timeout_ms)
+{
+	if(!started_ || !isActive()){
+		return 0;
+	}
+	if(txWorker_->flush() && txWait() == 0){
+		txWakeup_ = false;
+		long wait_msec = txWorker_->step();
+		txDue_.update();
+		if(0 < wait_msec){
+			txDue_ += static_cast<Poco::Clock::ClockDiff>(wait_msec) * 1000;
+		}
+		txWorker_->flush();
+	}
+	const bool reading = !rxWorker_->finished();
+	const bool writing = impl_->send_pending();
+	if(reading || writing){
+		long wait_msec = txWait(); // not to delay the next sending
+		if(0 <= timeout_ms && (wait_msec < 0 || timeout_ms < wait_msec)){
+			wait_msec = timeout_ms;
+		}
+		if(writing && (wait_msec < 0 || stall_check_msec_ < wait_msec)){
+			wait_msec = stall_check_msec_;
+		}
+		if(impl_->wait_ready(wait_msec, reading, writing)){
+			if(reading){
+				drain();
+			}
+			txWorker_->flush(); // queued frames, and pong or close frame responded while receiving
+		}
+	}
+	monitor();
+	return 0;
+}
+
+int mimiioCooperativeController::stepPoll(int* fd, bool* writable, long* timeout_ms)
+{
+	if(!started_ || !isActive()){
+		*fd = -1;
+		*writable = false;
+		*timeout_ms = -1;
+		return 0;
+	}
+	const bool reading = !rxWorker_->finished();
+	*writable = impl_->send_pending();
+	*fd = (reading || *writable) ? impl_->fd() : -1;
+	*timeout_ms = (reading && impl_->pending()) ? 0 : txWait(); // buffered by the framer, the socket may not become readable
+	if(*writable && (*timeout_ms < 0 || stall_check_msec_ < *timeout_ms)){
+		*timeout_ms = stall_check_msec_;
+	}
+	return 0;
+}
+
+}
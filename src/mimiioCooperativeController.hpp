@@ -0,0 +1,117 @@
+/**
+ * @file mimiioCooperativeController.hpp
+ * @brief Controller class for asynchronous callback API driven by the caller's loop
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_MIMIIOCOOPERATIVECONTROLLER_HPP_
+#define LIBMIMIIO_MIMIIOCOOPERATIVECONTROLLER_HPP_
+
+#include "mimiioSteppedController.hpp"
+#include <Poco/Clock.h>
+#include <atomic>
+
+namespace mimiio{
+
+/**
+ * @class mimiioCooperativeController
+ * @brief Control class for asynchronous callback API without internal threads
+ *
+ * Same as mimiioEventLoopController, but iterations of the workers are run by step(), which the application calls
+ * from its own loop via mimi_step(). No thread is created for the connection, so that memory and context switches
+ * are minimal on small devices. As with event loops, the socket is non-blocking and frames are handled by the built-in framer,
+ * so that step() waits only for the socket within its timeout, and never in the middle of a frame.
+ */
+class mimiioCooperativeController : public mimiioSteppedController
+{
+public:
+
+	/**
+	 * @brief C'tor with mimiioImpl class, mimi(R) API implementation class
+	 *
+	 * @param [in] impl mimiio implementation class
+	 * @param [in] encoder audio encoder
+	 * @param [in] txfunc user defined callback function for sending audio
+	 * @param [in] rxfunc user defined callback function for receiving response from remote host
+	 * @param [in,out] userdata_for_tx user defined data for \e txfunc
+	 * @param [in,out] userdata_for_rx user defined data for \e rxfunc
+	 * @param [in] logger logger
+	 */
+	mimiioCooperativeController(
+			mimiioImpl* impl,
+			encoder::Encoder* encoder,
+			ON_TX_CALLBACK_T txfunc,
+			ON_RX_CALLBACK_T rxfunc,
+			void* userdata_for_tx,
+			void* userdata_for_rx,
+			Poco::Logger& logger);
+
+	/**
+	 * @brief D'tor and release all subsequent resources
+	 */
+	virtual ~mimiioCooperativeController();
+
+	/**
+	 * @brief Make the connection ready for step(), no thread is started.
+	 */
+	virtual int start();
+
+	/**
+	 * @brief Return immediately, since the connection is driven only by step().
+	 *
+	 * @return true if the connection is not active.
+	 */
+	virtual bool wait(long timeout_ms);
+
+	/**
+	 * @brief Run the tx worker once if it is due, then wait for the socket and run the rx worker until the socket has no more data.
+	 *
+	 * @param [in] timeout_ms maximum time waiting for the socket in milliseconds, negative value to wait until the tx worker is due.
+	 * @return 0
+	 */
+	virtual int step(long timeout_ms);
+
+	/**
+	 * @brief The socket while the rx worker is running or frames are queued, and the time until the tx worker is due.
+	 *
+	 * Both are -1 before start() and after the connection has become inactive. The timeout is 0 if a frame is already pending.
+	 * While frames are queued, the socket is also waited for writability and the tx worker is not due until they have been written.
+	 */
+	virtual int stepPoll(int* fd, bool* writable, long* timeout_ms);
+
+	/**
+	 * @brief Use pushed audio, the tx worker becomes due when audio is pushed.
+	 */
+	virtual void setPushSource(worker::mimiioPushSource* source);
+
+	/**
+	 * @brief Detach txfunc and rxfunc, and finish the tx worker since step() is not called any more.
+	 */
+	virtual void abandon();
+
+protected:
+
+	/**
+	 * @brief Nothing is received after mimi_close(), so the close frame is sent and the socket is shut down at once.
+	 */
+	virtual bool rxFinished() const { return true; }
+
+private:
+
+	mimiioCooperativeController(mimiioCooperativeController const&) = delete;
+	mimiioCooperativeController(mimiioCooperativeController &&) = delete;
+	mimiioCooperativeController& operator = (mimiioCooperativeController const&) = delete;
+	mimiioCooperativeController& operator = (mimiioCooperativeController&&) = delete;
+
+	/**
+	 * @brief Milliseconds until the tx worker is due, -1 if it has finished.
+	 */
+	long txWait() const;
+
+	Poco::Clock txDue_;              // time when the tx worker runs next
+	std::atomic<bool> txWakeup_;     // audio has been pushed
+};
+
+}
+
+#endif
@@ -0,0 +1,68 @@
+/**
+ * @file mimiioEncodePool.cpp
+ * @brief Threads shared by all connections for encoding audio
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "mimiioEncodePool.hpp"
+#include <Poco/Environment.h>
+
+namespace mimiio{
+
+mimiioEncodePool::mimiioEncodePool(int threads, Poco::Logger& logger) :
+		finish_(false),
+		logger_(logger)
+{
+	if(threads <= 0){
+		threads = static_cast<int>(Poco::Environment::processorCount());
+	}
+	for(int i=0;i<threads;++i){
+		threads_.push_back(std::unique_ptr<Poco::Thread>(new Poco::Thread("mimiio-encoder")));
+		threads_.back()->start(*this);
+	}
+	logger_.information("lmio: encoder pool: %d threads.", threads);
+}
+
+mimiioEncodePool::~mimiioEncodePool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		finish_ = true;
+		tasks_.clear();
+	}
+	cond_.notify_all();
+	for(size_t i=0;i<threads_.size();++i){
+		threads_[i]->join();
+	}
+}
+
+void mimiioEncodePool::schedule(const TaskPtr& task)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if(finish_){
+			return;
+		}
+		tasks_.push_back(task);
+	}
+	cond_.notify_one();
+}
+
+void mimiioEncodePool::run()
+{
+	while(true){
+		TaskPtr task;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			cond_.wait(lock, [this]{ return !tasks_.empty() || finish_; });
+			if(finish_){
+				break;
+			}
+			task.swap(tasks_.front());
+			tasks_.pop_front();
+		}
+		task->encode(); // released here, the owner may have been closed
+	}
+}
+
+}
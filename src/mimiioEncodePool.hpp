@@ -0,0 +1,89 @@
+/**
+ * @file mimiioEncodePool.hpp
+ * @brief Threads shared by all connections for encoding audio
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_MIMIIOENCODEPOOL_HPP__
+#define LIBMIMIIO_MIMIIOENCODEPOOL_HPP__
+
+#include <Poco/Runnable.h>
+#include <Poco/Thread.h>
+#include <Poco/Logger.h>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mimiio{
+
+/**
+ * @class mimiioEncodePool
+ * @brief Bounded pool of threads running encoding tasks of connections
+ *
+ * The number of threads is fixed, so that encoding at high compression levels never uses more CPU cores than given,
+ * however many connections are open. A task is scheduled again by its owner while it has work, and each run
+ * processes only a slice of the work, so that connections share the threads fairly.
+ */
+class mimiioEncodePool : public Poco::Runnable
+{
+public:
+
+	/**
+	 * @brief Work of one connection, which is never run by two threads at a time if its owner schedules it only when idle.
+	 */
+	class Task
+	{
+	public:
+		virtual ~Task(){}
+
+		/**
+		 * @brief Run a slice of the work on a thread of the pool
+		 */
+		virtual void encode() = 0;
+	};
+
+	typedef std::shared_ptr<Task> TaskPtr;
+
+	/**
+	 * @brief C'tor, start threads
+	 *
+	 * @param [in] threads the number of threads, 0 for the number of CPU cores.
+	 * @param [in] logger logger
+	 */
+	mimiioEncodePool(int threads, Poco::Logger& logger);
+
+	/**
+	 * @brief D'tor, drop scheduled tasks and join threads
+	 */
+	~mimiioEncodePool();
+
+	/**
+	 * @brief Run \e task once on a thread of the pool
+	 *
+	 * @param [in] task task, kept alive until it has run.
+	 */
+	void schedule(const TaskPtr& task);
+
+	/**
+	 * @brief Run scheduled tasks until the pool is destroyed
+	 */
+	void run();
+
+private:
+
+	mimiioEncodePool(mimiioEncodePool const&) = delete;
+	mimiioEncodePool& operator = (mimiioEncodePool const&) = delete;
+
+	std::mutex mutex_; // for tasks_ and finish_
+	std::condition_variable cond_;
+	std::deque<TaskPtr> tasks_;
+	bool finish_;
+	std::vector<std::unique_ptr<Poco::Thread>> threads_;
+	Poco::Logger& logger_;
+};
+
+}
+
+#endif
@@ -9,6 +9,7 @@
 #include "encoder/flac.hpp"
 #include "encoder/pcm.hpp"
 #include "encoder/flacPT.hpp"
+#include "encoder/flacAdaptive.hpp"
 
 namespace mimiio{
 using namespace encoder;
@@ -21,34 +22,37 @@ Encoder* mimiioEncoderFactory::createEncoder(MIMIIO_AUDIO_FORMAT format, int sam
 		return new PCMEncoder(samplingrate, channels, 0, logger_);
 	case MIMIIO_FLAC_0:
 		poco_debug(logger_, "lmio: create flac encoder compression level = 0.");
-		return new FlacEncoder(samplingrate, channels, 0, logger_);
+		return new FlacEncoder(samplingrate, channels, 0, FlacEncoder::blocksize(samplingrate, 0, latencyMs_), logger_);
 	case MIMIIO_FLAC_1:
 		poco_debug(logger_, "lmio: create flac encoder compression level = 1.");
-		return new FlacEncoder(samplingrate, channels, 1, logger_);
+		return new FlacEncoder(samplingrate, channels, 1, FlacEncoder::blocksize(samplingrate, 1, latencyMs_), logger_);
 	case MIMIIO_FLAC_2:
 		poco_debug(logger_, "lmio: create flac encoder compression level = 2.");
-		return new FlacEncoder(samplingrate, channels, 2, logger_);
+		return new FlacEncoder(samplingrate, channels, 2, FlacEncoder::blocksize(samplingrate, 2, latencyMs_), logger_);
 	case MIMIIO_FLAC_3:
 		poco_debug(logger_, "lmio: create flac encoder compression level = 3.");
-		return new FlacEncoder(samplingrate, channels, 3, logger_);
+		return new FlacEncoder(samplingrate, channels, 3, FlacEncoder::blocksize(samplingrate, 3, latencyMs_), logger_);
 	case MIMIIO_FLAC_4:
 		poco_debug(logger_, "lmio: create flac encoder compression level = 4.");
-		return new FlacEncoder(samplingrate, channels, 4, logger_);
+		return new FlacEncoder(samplingrate, channels, 4, FlacEncoder::blocksize(samplingrate, 4, latencyMs_), logger_);
 	case MIMIIO_FLAC_5:
 		poco_debug(logger_, "lmio: create flac encoder compression level = 5.");
-		return new FlacEncoder(samplingrate, channels ,5, logger_);
+		return new FlacEncoder(samplingrate, channels, 5, FlacEncoder::blocksize(samplingrate, 5, latencyMs_), logger_);
 	case MIMIIO_FLAC_6:
 		poco_debug(logger_, "lmio: create flac encoder compression level = 6.");
-		return new FlacEncoder(samplingrate, channels, 6, logger_);
+		return new FlacEncoder(samplingrate, channels, 6, FlacEncoder::blocksize(samplingrate, 6, latencyMs_), logger_);
 	case MIMIIO_FLAC_7:
 		poco_debug(logger_, "lmio: create flac encoder compression level = 7.");
-		return new FlacEncoder(samplingrate, channels, 7, logger_);
+		return new FlacEncoder(samplingrate, channels, 7, FlacEncoder::blocksize(samplingrate, 7, latencyMs_), logger_);
 	case MIMIIO_FLAC_8:
 		poco_debug(logger_, "lmio: create flac encoder compression level = 8.");
-		return new FlacEncoder(samplingrate, channels, 8, logger_);
+		return new FlacEncoder(samplingrate, channels, 8, FlacEncoder::blocksize(samplingrate, 8, latencyMs_), logger_);
 	case MIMIIO_FLAC_PASS_THROUGH:
 		poco_debug(logger_, "lmio: create flac noop pass through encoder.");
 		return new FlacPTEncoder(samplingrate, channels, 0, logger_);
+	case MIMIIO_FLAC_ADAPTIVE:
+		poco_debug(logger_, "lmio: create flac adaptive encoder.");
+		return new FlacAdaptiveEncoder(samplingrate, channels, latencyMs_, logger_);
 
 	default:
 		poco_debug(logger_, "lmio: invalid format"); // not reached here.
@@ -30,7 +30,14 @@ public:
 	 *
 	 * @param [in] logger Logger
 	 */
-	explicit mimiioEncoderFactory(Poco::Logger& logger) : logger_(logger) {}
+	explicit mimiioEncoderFactory(Poco::Logger& logger) : logger_(logger), latencyMs_(0) {}
+
+	/**
+	 * @brief Limit audio held by flac encoders before a frame is written
+	 *
+	 * @param [in] msec milliseconds, 0 for the block size of each compression level.
+	 */
+	void setLatency(int msec) { latencyMs_ = msec; }
 
 	/**
 	 * @brief Create audio encoder
@@ -45,6 +52,7 @@ public:
 
 private:
 	Poco::Logger& logger_;
+	int latencyMs_;
 };
 
 }
@@ -0,0 +1,155 @@
+/**
+ * @file mimiioEventLoopController.cpp
+ * @brief Controller class for asynchronous callback API on shared event loops
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "mimiioEventLoopController.hpp"
+#include "mimiioRuntime.hpp"
+#include "strerror.hpp"
+
+namespace mimiio{
+
+mimiioEventLoopController::mimiioEventLoopController(
+		mimiioImpl* impl,
+		encoder::Encoder* encoder,
+		reactor::mimiioEventLoop& loop,
+		ON_TX_CALLBACK_T txfunc,
+		ON_RX_CALLBACK_T rxfunc,
+		void* userdata_for_tx,
+		void* userdata_for_rx,
+		Poco::Logger& logger) :
+		mimiioSteppedController(impl, encoder, txfunc, rxfunc, userdata_for_tx, userdata_for_rx, "EventLoopController", logger),
+		loop_(loop),
+		rxfunc_(rxfunc),
+		userdata_for_rx_(userdata_for_rx)
+{
+	poco_debug(logger_, "EventLoopController: initialized.");
+}
+
+mimiioEventLoopController::~mimiioEventLoopController()
+{
+	if(dispatcher_){
+		dispatcher_->abort(); // queued results are dropped, and rxWorker waiting for space is released.
+	}
+	if(started_){
+		loop_.remove(this); // waits for the callback running on the loop, if any.
+	}
+	txWorker_->finish(); // both workers are not running any more, just mark them finished.
+	rxWorker_->finish();
+	txWorker_->step();
+	rxWorker_->step();
+	tasks_.join(); // the dispatcher, whose listener refers to this controller
+	dispatcher_.reset();
+}
+
+int mimiioEventLoopController::setRxDispatch(size_t queue_length, MIMIIO_RX_OVERFLOW_POLICY policy)
+{
+	if(started_){
+		logger_.error("EventLoopController: rx dispatch must be set before start (908).");
+		return 908;
+	}
+	if(queue_length == 0){
+		rxWorker_->setDispatcher(nullptr);
+		dispatcher_.reset();
+		return 0;
+	}
+	if(policy == MIMIIO_RX_OVERFLOW_BLOCK){
+		// the rx worker would wait for space on the loop thread, blocking all connections of the loop
+		logger_.error("EventLoopController: rx dispatch with MIMIIO_RX_OVERFLOW_BLOCK: %s (917)", std::string(mimiio::strerror(917)));
+		return 917;
+	}
+	dispatcher_.reset(new worker::mimiioRxDispatcher(rxfunc_, userdata_for_rx_, queue_length, policy, notifier_, logger_));
+	dispatcher_->setListener([this]{ loop_.schedule(this, 0); notifier_.notify(); });
+	rxWorker_->setDispatcher(dispatcher_.get());
+	return 0;
+}
+
+void mimiioEventLoopController::setPushSource(worker::mimiioPushSource* source)
+{
+	mimiioController::setPushSource(source);
+	push_->setListener([this]{ loop_.schedule(this, 0); }); // run the tx step now instead of waiting for the timer
+	txWorker_->setPushSource(source);
+}
+
+void mimiioEventLoopController::abandon()
+{
+	mimiioController::abandon(); // no state is reported while closing
+	txWorker_->detach();
+	rxWorker_->detach(); // keeps receiving until the close frame of the remote host
+	if(started_){
+		loop_.schedule(this, 0); // the tx worker finishes on the next step
+	}
+}
+
+bool mimiioEventLoopController::rxFinished() const
+{
+	return !started_ || rxWorker_->finished();
+}
+
+int mimiioEventLoopController::start()
+{
+	try{
+		poco_debug(logger_, "EventLoopController: Asynchronous callback API starts on event loop");
+		impl_->set_native_framing(true); // resumes frames split by the network
+		impl_->set_blocking(false);      // no I/O waits on the loop thread
+		started_ = true;
+		if(dispatcher_){
+			dispatcher_->start(tasks_, mimiioRuntime::instance().workers(logger_));
+		}
+		loop_.add(this, impl_->fd());
+		loop_.schedule(this, 0);
+		return 0;
+	}catch(std::exception &e){
+		started_ = false;
+		logger_.fatal("EventLoopController: Could not start API (905); %s", std::string(e.what()));
+		return 905;
+	}
+}
+
+void mimiioEventLoopController::onReadable()
+{
+	if(!drain()){
+		loop_.unwatch(this);
+	}
+	flush(); // pong or close frame responded while receiving
+	monitor();
+}
+
+void mimiioEventLoopController::onTimer()
+{
+	if(!flush()){
+		loop_.schedule(this, stall_check_msec_); // the tx worker resumes when the frames have been written
+		monitor();
+		return;
+	}
+	long wait_msec = txWorker_->step();
+	if(!flush()){
+		loop_.schedule(this, stall_check_msec_);
+	}else if(0 <= wait_msec){
+		loop_.schedule(this, wait_msec);
+	}
+	monitor();
+}
+
+void mimiioEventLoopController::onWritable()
+{
+	if(flush() && !txWorker_->finished()){
+		loop_.schedule(this, 0); // run the tx worker delayed by the frames
+	}
+	monitor();
+}
+
+bool mimiioEventLoopController::flush()
+{
+	bool done = txWorker_->flush(); // an error of sending is reported by the tx worker
+	loop_.watchWritable(this, !done);
+	return done;
+}
+
+void mimiioEventLoopController::stopped()
+{
+	loop_.remove(this);
+}
+
+}
@@ -0,0 +1,121 @@
+/**
+ * @file mimiioEventLoopController.hpp
+ * @brief Controller class for asynchronous callback API on shared event loops
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_MIMIIOEVENTLOOPCONTROLLER_HPP_
+#define LIBMIMIIO_MIMIIOEVENTLOOPCONTROLLER_HPP_
+
+#include "mimiioSteppedController.hpp"
+#include "mimiioTaskGroup.hpp"
+#include "reactor/mimiioEventLoop.hpp"
+
+namespace mimiio{
+
+/**
+ * @class mimiioEventLoopController
+ * @brief Control class for asynchronous callback API, driven by an event loop shared with other connections
+ *
+ * Instead of running the workers on their own threads, one iteration of mimiioTxWorker is run by a timer of the event loop
+ * and mimiioRxWorker is run when the socket is readable. Both run on the same event loop thread,
+ * so that txfunc and rxfunc must not block for long, otherwise other connections on the loop are delayed.
+ *
+ * The socket is non-blocking and frames are handled by the built-in framer, so that no I/O waits on the loop thread.
+ * A message split by the network is kept by the framer until the rest arrives, and the rx worker is run until the socket
+ * has no more data. Frames which the socket does not accept are written when it becomes writable, and the tx worker
+ * is not run until then, so that at most one step of audio is queued.
+ * rxfunc can be moved to a thread of the process-wide worker pool by setRxDispatch().
+ * @see reactor::mimiioEventLoop
+ */
+class mimiioEventLoopController : public mimiioSteppedController, private reactor::mimiioEventHandler
+{
+public:
+
+	/**
+	 * @brief C'tor with mimiioImpl class, mimi(R) API implementation class
+	 *
+	 * @param [in] impl mimiio implementation class
+	 * @param [in] encoder audio encoder
+	 * @param [in] loop event loop which this connection is assigned to
+	 * @param [in] txfunc user defined callback function for sending audio
+	 * @param [in] rxfunc user defined callback function for receiving response from remote host
+	 * @param [in,out] userdata_for_tx user defined data for \e txfunc
+	 * @param [in,out] userdata_for_rx user defined data for \e rxfunc
+	 * @param [in] logger logger
+	 */
+	mimiioEventLoopController(
+			mimiioImpl* impl,
+			encoder::Encoder* encoder,
+			reactor::mimiioEventLoop& loop,
+			ON_TX_CALLBACK_T txfunc,
+			ON_RX_CALLBACK_T rxfunc,
+			void* userdata_for_tx,
+			void* userdata_for_rx,
+			Poco::Logger& logger);
+
+	/**
+	 * @brief D'tor, remove this connection from the event loop and release all subsequent resources
+	 */
+	virtual ~mimiioEventLoopController();
+
+	/**
+	 * @brief Add this connection to the event loop
+	 */
+	virtual int start();
+
+	/**
+	 * @brief Call rxfunc on the worker pool, so that a slow rxfunc does not block the event loop.
+	 *
+	 * ::MIMIIO_RX_OVERFLOW_BLOCK is not supported, since waiting for space would block the event loop thread.
+	 */
+	virtual int setRxDispatch(size_t queue_length, MIMIIO_RX_OVERFLOW_POLICY policy);
+
+	/**
+	 * @brief Use pushed audio, the tx worker is woken up when audio is pushed.
+	 */
+	virtual void setPushSource(worker::mimiioPushSource* source);
+
+	/**
+	 * @brief Detach txfunc and rxfunc from both workers, and finish the tx worker.
+	 */
+	virtual void abandon();
+
+protected:
+
+	virtual bool rxFinished() const;
+
+	/**
+	 * @brief Remove this connection from the event loop
+	 */
+	virtual void stopped();
+
+private:
+
+	mimiioEventLoopController(mimiioEventLoopController const&) = delete;
+	mimiioEventLoopController(mimiioEventLoopController &&) = delete;
+	mimiioEventLoopController& operator = (mimiioEventLoopController const&) = delete;
+	mimiioEventLoopController& operator = (mimiioEventLoopController&&) = delete;
+
+	virtual void onReadable();
+
+	virtual void onTimer();
+
+	virtual void onWritable();
+
+	/**
+	 * @brief Write queued frames, and watch writability of the socket if some are left
+	 *
+	 * @return true if no frame is pending.
+	 */
+	bool flush();
+
+	reactor::mimiioEventLoop& loop_;
+	ON_RX_CALLBACK_T rxfunc_;
+	void* userdata_for_rx_;
+	mimiioTaskGroup tasks_; // the rx dispatcher on the process-wide worker pool, if any
+};
+
+}
+
+#endif
@@ -7,6 +7,10 @@
 
 #include "mimiioImpl.hpp"
 #include "strerror.hpp"
+#include "mimiioSSLContext.hpp"
+#include "mimiioConnectStats.hpp"
+#include "websocket/mimiioFramer.hpp"
+#include "encoder/encoder.hpp"
 #include "config.h"
 
 #include <Poco/Net/WebSocket.h>
@@ -33,59 +37,134 @@
 #include <Poco/Format.h>
 #include <Poco/DateTime.h>
 #include <Poco/Buffer.h>
+#include <Poco/Clock.h>
 
+#include <algorithm>
+#include <cerrno>
 #include <exception>
+#include <limits>
 #include <cstdio>
 #include <sstream>
 #include <iostream>
+#include <sys/socket.h>
+#include <poll.h>
 
 namespace mimiio{
 
-const long socket_connect_timeout_sec_ = 30; //!< Timeout for connecting remote host
-const long socket_send_timeout_sec_ = 30;    //!< Timeout for sending in socket
-const long socket_recv_timeout_sec_ = 30;    //!< Timeout for receiving in socket
+const size_t rx_buffer_initial_capacity_ = 65536; //!< Initial capacity of receive buffer, grows to the largest frame received
+
+int open_errorno(Poco::Logger& logger, const std::string& caller)
+{
+	int errorno = 101;
+	try{
+		throw;
+	}catch(const Poco::Net::SSLContextException &e){
+		errorno = 601; // SSL client context error
+		logger.fatal("lmio: %s failed: SSL connection failed, client context error.", caller);
+	}catch(const Poco::Net::InvalidCertificateException &e){
+		errorno = 602; // SSL invalid certificate error
+		logger.fatal("lmio: %s failed: SSL connection failed, invalid certificate: %s", caller, e.displayText());
+	}catch(const Poco::Net::CertificateValidationException &e){
+		errorno = 603; // SSL certificate validation error
+		logger.fatal("lmio: %s failed: SSL connection failed, server certificate validation error: %s", caller, e.displayText());
+	}catch(const Poco::Net::SSLConnectionUnexpectedlyClosedException &e){
+		errorno = 604; // SSL unexpectedly connection closed.
+		logger.fatal("lmio: %s failed: SSL connection failed, ssl connection unexpectedly closed: %s", caller, e.displayText());
+	}catch(const Poco::Net::SSLException &e){
+		errorno = 605; // SSL error, server certificate validation error
+		logger.fatal("lmio: %s failed: SSL connection failed: %s", caller, e.displayText());
+	}catch(const Poco::Net::WebSocketException &e){
+		errorno = 800 + static_cast<int>(e.code()); // 800s' error
+		logger.fatal("lmio: %s failed: WebSocket exception: %s (%d)", caller, std::string(mimiio::strerror(errorno)), errorno);
+	}catch(const Poco::Net::HostNotFoundException &e){
+		errorno = 701; // host not found
+		logger.fatal("lmio: %s failed: Host not found.", caller);
+	}catch(const Poco::Net::ConnectionRefusedException &e){
+		errorno = 704; // connection refused by remote host
+		logger.fatal("lmio: %s failed: Connection refused by remote host.", caller);
+	}catch(const Poco::Net::ConnectionResetException &e){
+		errorno = 705; // connection reset by peer, which means exceeded simultaneous processing limit.
+		logger.fatal("lmio: %s failed: Connection reset by peer, which means exceeded simultaneous processing limit.", caller);
+	}catch(const Poco::Net::NoMessageException &e){
+		//NoMessageException is often occurred when connection reset by peer.
+		errorno = 705; // connection reset by peer, which means exceeded simultaneous processing limit.
+		logger.fatal("lmio: %s failed: Connection reset by peer(no msg), which means exceeded simultaneous processing limit.", caller);
+	}catch(const Poco::Net::NetException &e){
+		errorno = 799; // undefined network error
+		logger.fatal("lmio: %s failed: %s", caller, e.displayText());
+	}catch(const Poco::TimeoutException &e){
+		errorno = 703; // timed out for establishing connection
+		logger.fatal("lmio: %s failed: timed out. %s", caller, e.displayText());
+	}catch(const Poco::FileNotFoundException &e){
+		errorno = 601; // SSL client context error
+		logger.fatal("lmio: %s failed: Client context error, client cert file not found.", caller);
+	}catch(const mimiio::encoder::EncoderInitException &e){
+		errorno = 501;
+		logger.fatal("lmio: %s failed: Encoder initialization error: %s", caller, e.what());
+	}catch(const std::exception &e){
+		errorno = 101; // unknown error
+		logger.fatal("lmio: %s failed: %s", caller, std::string(e.what()));
+	}catch(...){
+		errorno = 101; // unknown error
+		logger.fatal("lmio: %s failed with unknown reason.", caller);
+	}
+	return errorno;
+}
+
 
 mimiioImpl::mimiioImpl(const std::string& hostname,
 					   int port,
 					   std::vector<MIMIIO_HTTP_REQUEST_HEADER>& requestHeaders,
 					   const std::string& accessToken,
-					   Poco::Logger& logger) :
+					   Poco::Logger& logger,
+					   long connectTimeoutMsec) :
 					   hostname_(hostname),
 					   port_(port),
 					   closed_(false),
+					   closing_(false),
+					   timings_(),
+					   tls_offload_(0),
+					   rxbuffer_(0),
+					   rxbufferGrowths_(0),
 					   logger_(logger),
 					   ws_(nullptr)
 {
-	//Initialize SSL
-	Poco::Net::initializeSSL();
-    Poco::SharedPtr<Poco::Net::PrivateKeyPassphraseHandler> ph1 = new NoopPrivateKeyPassphraseHandler(false);
-    Poco::SharedPtr<Poco::Net::InvalidCertificateHandler> ph2 = new NotifyAndRejectCertificateHandler(false);
-#ifdef WITH_SSL_DEFAULT_CERT
-    Poco::Net::Context::Ptr ptrContext = new Poco::Net::Context(Poco::Net::Context::CLIENT_USE, "", "", SSL_DEFAULT_CERT, Poco::Net::Context::VERIFY_RELAXED, 9, true, "ALL:!ADH:!LOW:!EXP:!MD5:@STRENGTH");
-#elif __ANDROID__
-    Poco::Net::Context::Ptr ptrContext = new Poco::Net::Context(Poco::Net::Context::CLIENT_USE, "", "", "/etc/security/cacerts/b0f3e76e.0", Poco::Net::Context::VERIFY_RELAXED, 9, true, "ALL:!ADH:!LOW:!EXP:!MD5:@STRENGTH");
-#else
-    Poco::Net::Context::Ptr ptrContext = new Poco::Net::Context(Poco::Net::Context::CLIENT_USE, "", "", "", Poco::Net::Context::VERIFY_RELAXED, 9, true, "ALL:!ADH:!LOW:!EXP:!MD5:@STRENGTH");
-#endif
-    ptrContext->enableSessionCache(true);
-    Poco::Net::SSLManager::instance().initializeClient(ph1, ph2, ptrContext);
-
-    //Prepare HTTP Session
-    Poco::Net::HTTPSClientSession session(hostname_, port_, ptrContext);
-    Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, "/");
-    Poco::Net::OAuth20Credentials oauth(accessToken);
-    Poco::Net::HTTPResponse response;
-	Poco::Timespan timeout_connect(mimiio::socket_connect_timeout_sec_,0); // set connection timeout
-	session.setTimeout(timeout_connect);
+	rxbuffer_.setCapacity(rx_buffer_initial_capacity_); // size stays 0
+	//Shared SSL context, initialized once per process
+	mimiioSSLContext& sslContext = mimiioSSLContext::instance();
+	Poco::Net::Context::Ptr ptrContext = sslContext.context();
+	Poco::Net::Session::Ptr ptrSession = sslContext.session(hostname_, port_);
+
+	logger_.information("mimiio: WebSocket start connecting...");
+	Poco::Clock start;
+	Poco::Timespan timeout_connect(connectTimeoutMsec * 1000); // set connection timeout, in microseconds
+	Poco::Net::StreamSocket socket = connect_socket(timeout_connect);
+
+	//SSL handshake, resuming the last session with the host if any
+	Poco::Clock phase;
+	Poco::Net::SecureStreamSocket secureSocket = Poco::Net::SecureStreamSocket::attach(socket, hostname_, ptrContext, ptrSession);
+	timings_.ssl_usec = static_cast<long>(phase.elapsed());
+	bool resumed = secureSocket.sessionWasReused();
+	sslContext.update(hostname_, port_, secureSocket.currentSession(), resumed);
+	raw_ = secureSocket;
+	timings_.ssl_session_resumed = resumed ? 1 : 0;
+	poco_debug_f2(logger_, "mimiio: SSL %s, %ld usec.", std::string(resumed ? "session resumed" : "full handshake"), timings_.ssl_usec);
+	tls_offload_ = mimiioSSLContext::offloaded(fd());
+	if(tls_offload_ != 0){
+		poco_debug_f2(logger_, "mimiio: kernel TLS tx = %b, rx = %b.", (tls_offload_ & MIMIIO_TLS_OFFLOAD_TX) != 0, (tls_offload_ & MIMIIO_TLS_OFFLOAD_RX) != 0);
+	}
+
+	//Prepare HTTP Session on the established socket
+	Poco::Net::HTTPSClientSession session(secureSocket, ptrSession);
+	Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, "/");
+	Poco::Net::OAuth20Credentials oauth(accessToken);
 	oauth.authenticate(request);
 	if(requestHeaders.size() != 0){
 		for(size_t i=0;i<requestHeaders.size();++i){
 			request.set(std::string(requestHeaders[i].key),  std::string(requestHeaders[i].value));
 		}
 	}
-
-	logger_.information("mimiio: WebSocket start connecting...");
-	Poco::Net::WebSocket *ws = new Poco::Net::WebSocket(session, request, response);
+	upgrade(session, request);
 	//Poco::Net::X509Certificate cert = session.serverCertificate(); // Poco bug
 	//X509* px509 = reinterpret_cast<X509*>(static_cast<Poco::Net::WebSocketImpl*>(ws->impl())->peerCertificateX509()); // this patch won't be applied
 	//Poco::Net::X509Certificate cert(px509);
@@ -93,11 +172,8 @@ mimiioImpl::mimiioImpl(const std::string& hostname,
     //std::string issuers = cert.issuerName();
     //std::string expiredate = Poco::format("%d-%d-%d",static_cast<int>(e.year()),static_cast<int>(e.month()),static_cast<int>(e.day()));
     //logger_.information("mimiio: SSL connection established. Issuers: %s, Expires on: %s",issuers, expiredate);
-    ws_.reset(ws);
-	Poco::Timespan timeout_send(mimiio::socket_send_timeout_sec_, 0);
-	Poco::Timespan timeout_recv(mimiio::socket_recv_timeout_sec_, 0);
-	ws_->setSendTimeout(timeout_send);
-	ws_->setReceiveTimeout(timeout_recv);
+	timings_.total_usec = static_cast<long>(start.elapsed());
+	mimiioConnectStats::instance().record(timings_);
 	logger_.information("mimiio: WebSocket connection established.");
 }
 
@@ -105,44 +181,157 @@ mimiioImpl::mimiioImpl(const std::string& hostname,
 mimiioImpl::mimiioImpl(const std::string& hostname,
 		       	   	   int port,
 					   std::vector<MIMIIO_HTTP_REQUEST_HEADER>& requestHeaders,
-		       	   	   Poco::Logger& logger) :
+		       	   	   Poco::Logger& logger,
+		       	   	   long connectTimeoutMsec) :
 		       	   	   hostname_(hostname),
 		       	   	   port_(port),
 		       	   	   closed_(false),
+		       	   	   closing_(false),
+		       	   	   timings_(),
+		       	   	   tls_offload_(0),
+		       	   	   rxbuffer_(0),
+		       	   	   rxbufferGrowths_(0),
 		       	   	   logger_(logger)
 {
-	// Prepare HTTP context
-	Poco::Net::HTTPClientSession session(hostname_, port_);
+	rxbuffer_.setCapacity(rx_buffer_initial_capacity_); // size stays 0
+	logger_.information("mimiio: WebSocket start connecting...");
+	Poco::Clock start;
+	Poco::Timespan timeout_connect(connectTimeoutMsec * 1000); // set connection timeout, in microseconds
+	Poco::Net::StreamSocket socket = connect_socket(timeout_connect);
+	raw_ = socket;
+
+	// Prepare HTTP context on the established socket
+	Poco::Net::HTTPClientSession session(socket);
 	Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, "/", "HTTP/1.1");
 	if(requestHeaders.size() != 0){
 		for(size_t i=0;i<requestHeaders.size();++i){
 			request.set(std::string(requestHeaders[i].key),  std::string(requestHeaders[i].value));
 		}
 	}
-	Poco::Net::HTTPResponse response;
-	Poco::Timespan timeout_connect(mimiio::socket_connect_timeout_sec_,0); // set connection timeout
-	session.setTimeout(timeout_connect);
 
 	// Open WebSocket connection
-	logger_.information("mimiio: WebSocket start connecting...");
-	ws_.reset(new Poco::Net::WebSocket(session, request, response));
-	Poco::Timespan timeout_send(mimiio::socket_send_timeout_sec_, 0);
-	Poco::Timespan timeout_recv(mimiio::socket_recv_timeout_sec_, 0);
-	ws_->setSendTimeout(timeout_send);
-	ws_->setReceiveTimeout(timeout_recv);
+	upgrade(session, request);
+	timings_.total_usec = static_cast<long>(start.elapsed());
+	mimiioConnectStats::instance().record(timings_);
 	poco_debug(logger_,"mimiio: send initialize command...");
 	logger_.information("mimiio: WebSocket connection established.");
 }
 
+Poco::Net::StreamSocket mimiioImpl::connect_socket(const Poco::Timespan& timeout)
+{
+	Poco::Clock phase;
+	Poco::Net::SocketAddress address(hostname_, static_cast<Poco::UInt16>(port_)); // resolve host name
+	timings_.dns_usec = static_cast<long>(phase.elapsed());
+	phase.update();
+	Poco::Net::StreamSocket socket;
+	socket.connect(address, timeout);
+	socket.setSendTimeout(timeout);    // for SSL handshake and upgrade request
+	socket.setReceiveTimeout(timeout);
+	timings_.connect_usec = static_cast<long>(phase.elapsed());
+	poco_debug_f3(logger_, "mimiio: connected to %s, dns %ld usec, connect %ld usec.", address.toString(), timings_.dns_usec, timings_.connect_usec);
+	return socket;
+}
+
+void mimiioImpl::upgrade(Poco::Net::HTTPClientSession& session, Poco::Net::HTTPRequest& request)
+{
+	// The session has been created on a connected socket, which does not know the host name.
+	request.setHost(hostname_, static_cast<Poco::UInt16>(port_));
+	Poco::Net::HTTPResponse response;
+	Poco::Clock phase;
+	ws_.reset(new Poco::Net::WebSocket(session, request, response));
+	timings_.upgrade_usec = static_cast<long>(phase.elapsed());
+	poco_debug_f1(logger_, "mimiio: WebSocket upgraded, %ld usec.", timings_.upgrade_usec);
+	set_timeouts(default_timeout_msec_, default_timeout_msec_);
+}
 
 mimiioImpl::~mimiioImpl(){}
 
+bool mimiioImpl::stale() const
+{
+	if(closed_){
+		return true;
+	}
+	try{
+		return ws_->poll(Poco::Timespan(0), Poco::Net::Socket::SELECT_READ | Poco::Net::Socket::SELECT_ERROR);
+	}catch(const Poco::Exception &e){
+		return true;
+	}
+}
+
+int mimiioImpl::fd() const
+{
+	return static_cast<int>(raw_.impl()->sockfd());
+}
+
+bool mimiioImpl::pending() const
+{
+	if(framer_ && framer_->receivePending()){
+		return true;
+	}
+	try{
+		return !closed_ && 0 < raw_.available(); // decrypted but not yet read bytes for SSL
+	}catch(const Poco::Exception &e){
+		return false;
+	}
+}
+
+bool mimiioImpl::wait_ready(long timeout_ms, bool readable, bool writable) const
+{
+	if(readable && pending()){
+		return true;
+	}
+	struct pollfd pfd;
+	pfd.fd = fd();
+	pfd.events = (readable ? POLLIN : 0) | (writable ? POLLOUT : 0);
+	pfd.revents = 0;
+	int rc = ::poll(&pfd, 1, timeout_ms < 0 ? -1 : static_cast<int>(std::min<long>(timeout_ms, std::numeric_limits<int>::max())));
+	if(rc < 0 && errno == EINTR){
+		return false;
+	}
+	return rc != 0; // other errors are reported as readable, then receive_frame() reports the error
+}
+
 void mimiioImpl::set_blocking(bool blocking)
 {
 	poco_debug_f1(logger_, "mimiio: socket blocking mode is %b", blocking);
 	ws_->setBlocking(blocking);
 }
 
+void mimiioImpl::set_timeouts(long sendMsec, long recvMsec)
+{
+	Poco::Timespan timeout_send(sendMsec * 1000); // in microseconds
+	Poco::Timespan timeout_recv(recvMsec * 1000);
+	ws_->setSendTimeout(timeout_send);
+	ws_->setReceiveTimeout(timeout_recv);
+}
+
+void mimiioImpl::send_close(long timeoutMsec)
+{
+	if(closed_ || closing_.exchange(true)){
+		return;
+	}
+	try{
+		const Poco::Timespan timeout(timeoutMsec * 1000); // in microseconds
+		if(!ws_->poll(timeout, Poco::Net::Socket::SELECT_WRITE)){
+			poco_debug(logger_, "mimiio: close frame not sent, socket is not writable.");
+			return;
+		}
+		ws_->setSendTimeout(timeout); // a stalled peer can not hold the caller longer than this
+		const char status[2] = {0x03, static_cast<char>(0xE8)}; // 1000 (normal closure) in network byte order
+		send_frame(status, 2, Poco::Net::WebSocket::FRAME_FLAG_FIN|Poco::Net::WebSocket::FRAME_OP_CLOSE);
+		poco_debug(logger_, "mimiio: tx(text) : close frame sent.");
+	}catch(const std::exception &e){
+		poco_debug_f1(logger_, "mimiio: close frame could not be sent: %s", std::string(e.what()));
+	}
+}
+
+void mimiioImpl::shutdown()
+{
+	// Not Poco's shutdown(), which performs TLS shutdown and may block on a stalled connection.
+	::shutdown(fd(), SHUT_RDWR);
+	poco_debug(logger_, "mimiio: socket shut down.");
+}
+
 void mimiioImpl::send_command(const std::string& command)
 {
 	std::string sc = Poco::format("{\"command\":\"%s\"}",command);
@@ -158,33 +347,79 @@ int mimiioImpl::send_frame(const std::string& data)
 {
 	//send text frame
 	poco_debug_f2(logger_, "mimiio: tx(text) = %s, %z byte", data, data.size());
-	return ws_->sendFrame(data.c_str(), data.size(), Poco::Net::WebSocket::FRAME_TEXT);
+	return send_frame(data.c_str(), data.size(), Poco::Net::WebSocket::FRAME_TEXT);
 }
 
 int mimiioImpl::send_frame(const std::vector<char>& buffer, size_t len)
+{
+	return send_frame(buffer.data(), len);
+}
+
+int mimiioImpl::send_frame(const char* data, size_t len)
 {
 	//send binary frame
-	//poco_debug_f1(logger_,"mimiio: tx(binary) = %z byte",len*2);
-	//return ws_->sendFrame(&buffer[0], len*2, Poco::Net::WebSocket::FRAME_BINARY);
 	poco_debug_f1(logger_,"mimiio: tx(binary) = %z byte",len);
-	return ws_->sendFrame(&buffer[0], len, Poco::Net::WebSocket::FRAME_BINARY);
+	return send_frame(data, len, Poco::Net::WebSocket::FRAME_BINARY);
+}
+
+int mimiioImpl::send_frame(const char* data, size_t len, int flags)
+{
+	if(framer_){
+		return framer_->sendFrame(data, len, flags);
+	}
+	return ws_->sendFrame(data, static_cast<int>(len), flags);
+}
+
+bool mimiioImpl::flush()
+{
+	return !framer_ || framer_->flush();
+}
+
+bool mimiioImpl::send_pending() const
+{
+	return framer_ && framer_->sendPending();
+}
+
+void mimiioImpl::set_native_framing(bool enable)
+{
+	if(enable && !framer_){
+		framer_.reset(new websocket::mimiioFramer(raw_, ws_->getMaxPayloadSize(), (tls_offload_ & MIMIIO_TLS_OFFLOAD_TX) != 0, logger_));
+	}else if(!enable){
+		framer_.reset();
+	}
 }
 
 int mimiioImpl::receive_frame(std::vector<char> &buffer, OPF_TYPE& opframe, short& closeStatus)
+{
+	const char* data = nullptr;
+	int n = receive_frame(data, opframe, closeStatus);
+	buffer.assign(data, data + rxbuffer_.size() - 1);
+	return n;
+}
+
+int mimiioImpl::receive_frame(const char*& data, OPF_TYPE& opframe, short& closeStatus)
 {
 	//POCO 1.4x,1.5x malfunction, could not handle PING/PONG response appropriately.
 	//Must be patched the malfunction otherwise this function cause incomplete frame received exception.
 	int flags = 0;
-	//int n = ws_->receiveFrame(&buffer[0], buffer.size(), flags);	
-	Poco::Buffer<char> tmpbuffer(0);
-	tmpbuffer.clear();
-	int n = ws_->receiveFrame(tmpbuffer, flags);
-	buffer.clear();
-	buffer.resize(tmpbuffer.size());
-	for(size_t i=0;i<tmpbuffer.size();++i){ // NOT EFFICIENT! it should be modified.
-		buffer[i] = tmpbuffer[i];
+	//Frames are appended at the end of the buffer, so it is emptied first. It keeps its capacity, so it is reallocated
+	//only when a frame larger than ever is received. Reallocations are counted and logged below.
+	const size_t capacity = rxbuffer_.capacity();
+	rxbuffer_.resize(0);
+	int n = framer_ ? framer_->receiveFrame(rxbuffer_, flags) : ws_->receiveFrame(rxbuffer_, flags);
+	size_t len = rxbuffer_.size();
+	rxbuffer_.append('\0'); // for null termination of text frame
+	data = rxbuffer_.begin();
+	if(rxbuffer_.capacity() != capacity){
+		++rxbufferGrowths_;
+		poco_debug_f2(logger_, "mimiio: receive buffer reallocated to %z bytes (%lu times).", rxbuffer_.capacity(), rxbufferGrowths_);
+	}
+	if(n < 0){
+		opframe = mimiioImpl::NA; // the non-blocking socket has no whole message yet
+		closeStatus = 0;
+		return n;
 	}
-		
+
 	opframe = mimiioImpl::NA;    // type of received frame
 	closeStatus = 0;
 	if(n != 0){
@@ -193,30 +428,31 @@ int mimiioImpl::receive_frame(std::vector<char> &buffer, OPF_TYPE& opframe, shor
 			//that indicates a reason for closing which defined at section 7.4.1 and implemented in strerror.hpp of above 1000 error code.
 			//mimi(R) service hosts MUST send back a reason code for closing according to the specification.
 			short statusCode = 0;
-			((char *)&statusCode)[0] = buffer[1]; // The first two bytes of the body MUST be a 2-byte unsigned integer (in network byte order) representing a status code defined in Section 7.4.
-			((char *)&statusCode)[1] = buffer[0];
+			((char *)&statusCode)[0] = data[1]; // The first two bytes of the body MUST be a 2-byte unsigned integer (in network byte order) representing a status code defined in Section 7.4.
+			((char *)&statusCode)[1] = data[0];
 			closeStatus = statusCode;
 			poco_debug_f3(logger_, "mimiio: rx(text) : close frame received: status = %hd, %d byte (%d)", statusCode, n, flags);
 			//close response
 			//according to RFC 6455 client must send back close_frame to the server with/without the status code received from the server.
-			char rst[2];
-			rst[0] = ((char*)&statusCode)[1];
-			rst[1] = ((char*)&statusCode)[0];
-			ws_->sendFrame(rst,2,Poco::Net::WebSocket::FRAME_FLAG_FIN|Poco::Net::WebSocket::FRAME_OP_CLOSE);
-			poco_debug(logger_, "mimiio: tx(text) : close frame responded.");
+			if(!closing_){
+				char rst[2];
+				rst[0] = ((char*)&statusCode)[1];
+				rst[1] = ((char*)&statusCode)[0];
+				send_frame(rst,2,Poco::Net::WebSocket::FRAME_FLAG_FIN|Poco::Net::WebSocket::FRAME_OP_CLOSE);
+				poco_debug(logger_, "mimiio: tx(text) : close frame responded.");
+			}
 			opframe = mimiioImpl::CLOSE_FRAME;
 			closed_ = true; // close frame from server.
 		}else{
-			//normal operation
-			std::string fb(buffer.begin(), buffer.end());
+			//normal operation, the frame is converted to string only if debug log is enabled.
 			if(flags == 129){
 				//text frame received
 				opframe = mimiioImpl::TEXT_FRAME;
-				poco_debug_f3(logger_, "mimiio: rx(text) = %s, %d byte (%d)", fb, n, flags);
+				poco_debug_f3(logger_, "mimiio: rx(text) = %s, %d byte (%d)", std::string(data, len), n, flags);
 			}else if(flags == 130){
 				//binary frame received
 				opframe = mimiioImpl::BINARY_FRAME;
-				poco_debug_f3(logger_, "mimiio: rx(binary) = %s, %d byte (%d)", fb, n, flags);
+				poco_debug_f3(logger_, "mimiio: rx(binary) = %s, %d byte (%d)", std::string(data, len), n, flags);
 			}
 		}
 	}else{
@@ -225,7 +461,7 @@ int mimiioImpl::receive_frame(std::vector<char> &buffer, OPF_TYPE& opframe, shor
 			//PING packet received. mimi(R) service host MAY not send a ping packet, but libmimiio SHOULD treat ping packet appropriately.
 			poco_debug(logger_,"mimiio: rx(ping)");
 			//Pong response
-			ws_->sendFrame(NULL,0,Poco::Net::WebSocket::FRAME_FLAG_FIN|Poco::Net::WebSocket::FRAME_OP_PONG);
+			send_frame(NULL,0,Poco::Net::WebSocket::FRAME_FLAG_FIN|Poco::Net::WebSocket::FRAME_OP_PONG);
 			poco_debug(logger_,"mimiio: tx(pong)");
 			opframe = mimiioImpl::PING_FRAME;
 		}else if(flags == (Poco::Net::WebSocket::FRAME_FLAG_FIN|Poco::Net::WebSocket::FRAME_OP_CLOSE)){
@@ -234,8 +470,10 @@ int mimiioImpl::receive_frame(std::vector<char> &buffer, OPF_TYPE& opframe, shor
 			poco_debug(logger_,"mimiio: rx(text) : close frame received with no status.");
 			closeStatus = 0;
 			//close response
-			ws_->sendFrame(NULL,0,Poco::Net::WebSocket::FRAME_FLAG_FIN|Poco::Net::WebSocket::FRAME_OP_CLOSE);
-			poco_debug(logger_,"mimiio: tx(text) : close frame responded.");
+			if(!closing_){
+				send_frame(NULL,0,Poco::Net::WebSocket::FRAME_FLAG_FIN|Poco::Net::WebSocket::FRAME_OP_CLOSE);
+				poco_debug(logger_,"mimiio: tx(text) : close frame responded.");
+			}
 			opframe = mimiioImpl::CLOSE_FRAME;
 			closed_ = true; // close frame from server.
 		}else if(flags == 0){
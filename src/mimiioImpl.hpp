@@ -13,11 +13,16 @@
 #include <Poco/Net/InvalidCertificateHandler.h>
 #include <Poco/Net/SSLException.h>
 #include <Poco/Logger.h>
+#include <Poco/Timespan.h>
+#include <Poco/Buffer.h>
+#include <Poco/Net/StreamSocket.h>
+#include <atomic>
 #include <string>
 #include <vector>
 #include <memory>
 
-namespace Poco{ namespace Net{ class WebSocket; } }
+namespace Poco{ namespace Net{ class WebSocket; class HTTPClientSession; class HTTPRequest; } }
+namespace mimiio{ namespace websocket{ class mimiioFramer; } }
 
 namespace mimiio{
 
@@ -65,6 +70,16 @@ public:
 	explicit UnexpectedNetworkDisconnection(const std::string& s) : std::runtime_error(s){}
 };
 
+/**
+ * @brief Translate the exception raised while opening a mimi connection into libmimiio error code.
+ * @attention This function MUST be called in a catch block, the exception being handled is rethrown and caught inside.
+ *
+ * @param [in] logger logger
+ * @param [in] caller name of the opening function, which is used for logging.
+ * @return error code, see strerror.hpp
+ */
+int open_errorno(Poco::Logger& logger, const std::string& caller);
+
 /**
  * @class mimiioImpl
  * @brief mimi(R) WebSocket API implementation class.
@@ -78,7 +93,9 @@ class mimiioImpl{
 
 public:
 
-	typedef std::unique_ptr<mimiioImpl> Ptr;
+	typedef std::shared_ptr<mimiioImpl> Ptr;
+
+	static const long default_timeout_msec_ = 30000; //!< Default timeout for connecting, sending and receiving
 
 	/**
 	 * @brief WebSocket container type defined in RFC 6445
@@ -99,12 +116,14 @@ public:
 	 * @param [in] requestHeaders HTTP request headers which is sent with WebSocket upgrade request.
 	 * @param [in] accessToken access token
 	 * @param [in] logger logger
+	 * @param [in] connectTimeoutMsec timeout for connecting, SSL handshake and upgrade in milliseconds
 	 */
 	mimiioImpl(const std::string& hostname,
 			   int port,
 			   std::vector<MIMIIO_HTTP_REQUEST_HEADER>& requestHeaders,
 			   const std::string& accessToken,
-			   Poco::Logger& logger);
+			   Poco::Logger& logger,
+			   long connectTimeoutMsec = default_timeout_msec_);
 
 	/**
 	 * @brief C'tor. Connect to mimi(R) WebSocket API service version 2.0
@@ -113,11 +132,13 @@ public:
 	 * @param [in] port mimi(R) remote port
 	 * @param [in] requestHeaders HTTP request headers which is sent with WebSocket upgrade request.
 	 * @param [in] logger logger
+	 * @param [in] connectTimeoutMsec timeout for connecting and upgrade in milliseconds
 	 */
 	mimiioImpl(const std::string& hostname,
 			   int port,
 			   std::vector<MIMIIO_HTTP_REQUEST_HEADER>& requestHeaders,
-			   Poco::Logger& logger);
+			   Poco::Logger& logger,
+			   long connectTimeoutMsec = default_timeout_msec_);
 
 	/**
 	 * @brief D'tor
@@ -131,6 +152,33 @@ public:
 	 */
 	bool closed() const { return closed_; }
 
+	/**
+	 * @brief Determine whether an idle connection is no longer usable
+	 *
+	 * Remote host never sends any frame before audio is sent, so an idle connection which has become readable
+	 * has been closed by the remote host (e.g. idle timeout).
+	 *
+	 * @return true if the connection is closed or readable, otherwise false.
+	 */
+	bool stale() const;
+
+	/**
+	 * @brief Get elapsed time of each phase of opening the connection
+	 *
+	 * @return connection timings
+	 */
+	const MIMIIO_CONNECT_TIMINGS& timings() const { return timings_; }
+
+	/**
+	 * @brief Mark the connection as taken from a connection pool
+	 */
+	void set_pooled() { timings_.pooled = 1; }
+
+	/**
+	 * @brief Get kernel TLS offload flags, ::MIMIIO_TLS_OFFLOAD_TX and ::MIMIIO_TLS_OFFLOAD_RX
+	 */
+	int tls_offload() const { return tls_offload_; }
+
 	/**
 	 * @brief Send break command to mimi(R) service
 	 */
@@ -145,39 +193,146 @@ public:
 	 */
 	int send_frame(const std::vector<char>& buffer, size_t len);
 
+	/**
+	 * @brief Send audio data to mimi(R) service
+	 *
+	 * @param [in] data audio data
+	 * @param [in] len length of data
+	 * @return Returns the number of bytes sent, which may be less than the number of bytes specified.
+	 */
+	int send_frame(const char* data, size_t len);
+
 	/**
 	 * @brief Receive response from mimi(R) service
 	 *
 	 * @param [out] buffer response from the mimi(R) service
 	 * @param [out] WebSocket frame type
 	 * @param [out] close frame status code
-	 * @return size of received bytes
+	 * @return size of received bytes, -1 if the socket is non-blocking and no whole message has been received by the built-in framer.
 	 */
 	int receive_frame(std::vector<char>& buffer, OPF_TYPE& opc, short& closeStatus);
 
+	/**
+	 * @brief Receive response from mimi(R) service without copying
+	 *
+	 * The frame is received into the buffer owned by this session, which is reused for every frame.
+	 * The received data is always followed by a null character.
+	 *
+	 * @param [out] data response from the mimi(R) service, valid until the next call of receive_frame()
+	 * @param [out] WebSocket frame type
+	 * @param [out] close frame status code
+	 * @return size of received bytes, -1 if the socket is non-blocking and no whole message has been received by the built-in framer.
+	 */
+	int receive_frame(const char*& data, OPF_TYPE& opc, short& closeStatus);
+
 	/**
 	 * @brief Set socket mode in blocking
 	 *
-	 * This function is for synchronous API. In asynchronous callback API socket mode is always in blocking.
+	 * This function is for synchronous API and event loops. With the built-in framer, frames on a non-blocking socket
+	 * are sent and received without waiting, see websocket::mimiioFramer. Other asynchronous callback APIs use blocking mode.
 	 *
 	 * @param [in] blocking If it's set true, socket mode is in blocking, false is for non-blocking.
 	 */
 	void set_blocking(bool blocking);
 
+	/**
+	 * @brief Set timeouts of sending and receiving frames
+	 *
+	 * @param [in] sendMsec timeout for sending in milliseconds
+	 * @param [in] recvMsec timeout for receiving in milliseconds
+	 */
+	void set_timeouts(long sendMsec, long recvMsec);
+
+	/**
+	 * @brief Use built-in WebSocket framer instead of Poco::Net::WebSocket for frame I/O
+	 *
+	 * The opening handshake is always performed by Poco::Net::WebSocket. This function must not be called
+	 * while frames are sent or received by other threads.
+	 *
+	 * @param [in] enable true for built-in framer, false for Poco::Net::WebSocket.
+	 */
+	void set_native_framing(bool enable);
+
+	/**
+	 * @brief Write frames queued on a non-blocking socket by the built-in framer, without waiting
+	 *
+	 * @return true if no frame is pending.
+	 * @throws Poco::TimeoutException if the socket has accepted nothing for the send timeout.
+	 */
+	bool flush();
+
+	/**
+	 * @brief Determine whether frames queued on a non-blocking socket have not been written yet
+	 */
+	bool send_pending() const;
+
+	/**
+	 * @brief Start the closing handshake by sending a close frame with status 1000
+	 *
+	 * Nothing is sent if the connection has been closed already, or if the socket does not become writable within \e timeoutMsec.
+	 * Sending is also limited by \e timeoutMsec. Errors are ignored since the socket is shut down soon.
+	 * The close frame of the remote host is the response to this frame, and is not responded.
+	 *
+	 * @param [in] timeoutMsec maximum time waiting for the socket in milliseconds
+	 */
+	void send_close(long timeoutMsec);
+
+	/**
+	 * @brief Shut down the socket in both directions
+	 *
+	 * Sending and receiving blocked on other threads return immediately with an error. The socket is closed by the destructor.
+	 */
+	void shutdown();
+
+	/**
+	 * @brief Get file descriptor of the socket, for event loops
+	 */
+	int fd() const;
+
+	/**
+	 * @brief Determine whether received data is buffered, which is not notified by readability of the socket.
+	 *
+	 * @return true if the next receive_frame() does not wait for the socket.
+	 */
+	bool pending() const;
+
+	/**
+	 * @brief Wait until receive_frame() can read without waiting for the socket, or until queued frames can be written
+	 *
+	 * @param [in] timeout_ms timeout in milliseconds, 0 not to wait, negative value for infinite.
+	 * @param [in] readable wait for a frame to receive
+	 * @param [in] writable wait for the socket to become writable, for frames queued on a non-blocking socket.
+	 * @return true if a frame is pending or the socket is ready, also true if the socket has an error or has been closed.
+	 */
+	bool wait_ready(long timeout_ms, bool readable, bool writable) const;
+
 private:
 
+	Poco::Net::StreamSocket connect_socket(const Poco::Timespan& timeout);
+
+	void upgrade(Poco::Net::HTTPClientSession& session, Poco::Net::HTTPRequest& request);
+
 	void send_command(const std::string& command);
 
+	int send_frame(const char* data, size_t len, int flags);
+
 	int send_frame(const std::string& data);
 
 	//for reconnection
 	const std::string hostname_;
 	const int port_;
 	const std::string accessToken;
-	bool closed_;
+	std::atomic<bool> closed_; // set by the rx worker, read by other threads
+	std::atomic<bool> closing_; // close frame has been sent by this side
+	MIMIIO_CONNECT_TIMINGS timings_;
+	int tls_offload_; // kernel TLS offload flags detected after the handshake
+	Poco::Buffer<char> rxbuffer_; // reused for every received frame, size 0 between frames
+	unsigned long rxbufferGrowths_; // reallocations of rxbuffer_, only while frames larger than ever are received
 
 	Poco::Logger& logger_;
 	std::unique_ptr<Poco::Net::WebSocket> ws_;
+	Poco::Net::StreamSocket raw_; // underlying (secure) socket of ws_, without WebSocket framing
+	std::unique_ptr<websocket::mimiioFramer> framer_;
 };
 
 }
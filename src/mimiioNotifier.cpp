@@ -0,0 +1,52 @@
+/**
+ * @file mimiioNotifier.cpp
+ * @brief Notification of state changes of workers, for threads waiting for them.
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "mimiioNotifier.hpp"
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace mimiio{
+
+#ifdef __linux__
+
+mimiioNotifier::~mimiioNotifier()
+{
+	if(evfd_ >= 0){
+		::close(evfd_);
+	}
+}
+
+void mimiioNotifier::signal()
+{
+	const int fd = evfd_;
+	if(fd < 0){
+		return;
+	}
+	uint64_t one = 1;
+	ssize_t n = ::write(fd, &one, sizeof(one));
+	(void)n; // the counter is already non-zero if it fails with EAGAIN
+}
+
+int mimiioNotifier::fd()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if(evfd_ < 0){
+		evfd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	}
+	return evfd_;
+}
+
+#else // eventfd is only for Linux
+
+mimiioNotifier::~mimiioNotifier(){}
+void mimiioNotifier::signal(){}
+int mimiioNotifier::fd() { return -1; }
+
+#endif
+
+}
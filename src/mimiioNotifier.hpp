@@ -0,0 +1,109 @@
+/**
+ * @file mimiioNotifier.hpp
+ * @brief Notification of state changes of workers, for threads waiting for them.
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_MIMIIONOTIFIER_HPP__
+#define LIBMIMIIO_MIMIIONOTIFIER_HPP__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+namespace mimiio{
+
+/**
+ * @class mimiioNotifier
+ * @brief Condition variable without its own state
+ *
+ * The state is kept by the notifying side, e.g. atomic flags of workers, and is changed before notify().
+ * Since notify() locks the mutex which the waiting side holds while it evaluates the condition,
+ * no notification is lost between the evaluation and the wait.
+ *
+ * Threads outside libmimiio can wait for notifications by the eventfd returned by fd(), e.g. with epoll.
+ */
+class mimiioNotifier
+{
+public:
+
+	typedef std::function<void()> LISTENER_T;
+
+	mimiioNotifier() : evfd_(-1){}
+
+	/**
+	 * @brief D'tor, close the eventfd if created
+	 */
+	~mimiioNotifier();
+
+	/**
+	 * @brief Set the function called by notify() after waking up threads, e.g. to report state changes.
+	 *
+	 * Must be set before notify() is called by other threads.
+	 */
+	void setListener(const LISTENER_T& listener) { listener_ = listener; }
+
+	/**
+	 * @brief Wake up all waiting threads to evaluate their conditions
+	 */
+	void notify()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+		}
+		cond_.notify_all();
+		if(listener_){
+			listener_();
+		}
+	}
+
+	/**
+	 * @brief Make the eventfd readable, without waking up threads waiting by wait().
+	 *
+	 * Does nothing until fd() is called.
+	 */
+	void signal();
+
+	/**
+	 * @brief Get the eventfd which becomes readable by signal(), create it on the first call.
+	 *
+	 * The counter of the eventfd is reset by reading 8 bytes from it.
+	 *
+	 * @return file descriptor, or -1 if eventfd is not supported or could not be created.
+	 */
+	int fd();
+
+	/**
+	 * @brief Wait until the condition is satisfied
+	 *
+	 * @param [in] timeout_ms timeout in milliseconds, negative value for infinite.
+	 * @param [in] condition callable returning true when waiting is done, evaluated with the mutex locked.
+	 * @return the last result of \e condition, false if timed out.
+	 */
+	template<class Condition>
+	bool wait(long timeout_ms, Condition condition)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		if(timeout_ms < 0){
+			cond_.wait(lock, condition);
+			return true;
+		}
+		return cond_.wait_for(lock, std::chrono::milliseconds(timeout_ms), condition);
+	}
+
+private:
+
+	mimiioNotifier(mimiioNotifier const&) = delete;
+	mimiioNotifier& operator = (mimiioNotifier const&) = delete;
+
+	std::mutex mutex_;
+	std::condition_variable cond_;
+	std::atomic<int> evfd_; // created by fd() with mutex_ locked
+	LISTENER_T listener_;
+};
+
+}
+
+#endif
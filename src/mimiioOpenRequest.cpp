@@ -0,0 +1,104 @@
+/**
+ * @file mimiioOpenRequest.cpp
+ * @brief Asynchronous opening of mimi(R) connection.
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "config.h"
+#include "mimiioOpenRequest.hpp"
+#include "mimiioController.hpp"
+#include "mimiioRuntime.hpp"
+#include <Poco/ThreadPool.h>
+#include <Poco/Exception.h>
+
+namespace mimiio{
+
+mimiioOpenRequest::mimiioOpenRequest(const OPENER_T& opener, ON_OPEN_CALLBACK_T callback, void* userdata) :
+		opener_(opener),
+		callback_(callback),
+		userdata_(userdata),
+		completed_(false),
+		cancelled_(false),
+		errorno_(0),
+		mio_(nullptr)
+{}
+
+mimiioOpenRequest::~mimiioOpenRequest()
+{
+	mimi_close(mio_);
+}
+
+mimiioOpenRequest::Ptr mimiioOpenRequest::start(const OPENER_T& opener, ON_OPEN_CALLBACK_T callback, void* userdata)
+{
+	Ptr request(new mimiioOpenRequest(opener, callback, userdata));
+	request->self_ = request;
+	try{
+		// threads are blocked by connecting for up to the connection timeout, the pool grows as needed.
+		mimiioRuntime::instance().workers(Poco::Logger::get(PACKAGE_NAME)).start(*request);
+	}catch(const Poco::Exception &e){
+		request->self_.reset();
+		return Ptr();
+	}
+	return request;
+}
+
+bool mimiioOpenRequest::poll(MIMI_IO** mio, int* errorno)
+{
+	Poco::Mutex::ScopedLock lock(mutex_);
+	if(mio != nullptr){
+		*mio = nullptr;
+	}
+	if(!completed_){
+		return false;
+	}
+	if(errorno != nullptr){
+		*errorno = errorno_;
+	}
+	if(mio != nullptr && !cancelled_){
+		*mio = mio_;
+		mio_ = nullptr; // ownership is moved to the user
+	}
+	return true;
+}
+
+void mimiioOpenRequest::cancel()
+{
+	MIMI_IO* mio = nullptr;
+	{
+		Poco::Mutex::ScopedLock lock(mutex_); // waits for the running callback
+		cancelled_ = true;
+		mio = mio_;
+		mio_ = nullptr;
+	}
+	mimi_close(mio);
+}
+
+void mimiioOpenRequest::run()
+{
+	Ptr self;
+	self.swap(self_); // released when this function returns
+	int errorno = 0;
+	MIMI_IO* mio = nullptr;
+	{
+		Poco::Mutex::ScopedLock lock(mutex_);
+		if(cancelled_){
+			completed_ = true;
+			return;
+		}
+	}
+	mio = opener_(&errorno);
+	Poco::Mutex::ScopedLock lock(mutex_);
+	completed_ = true;
+	errorno_ = errorno;
+	if(cancelled_){
+		mimi_close(mio);
+		return;
+	}
+	if(callback_ != nullptr){
+		callback_(mio, errorno, userdata_); // ownership is moved to the user
+	}else{
+		mio_ = mio;
+	}
+}
+
+}
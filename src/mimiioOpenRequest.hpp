@@ -0,0 +1,99 @@
+/**
+ * @file mimiioOpenRequest.hpp
+ * @brief Asynchronous opening of mimi(R) connection.
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_MIMIIOOPENREQUEST_HPP__
+#define LIBMIMIIO_MIMIIOOPENREQUEST_HPP__
+
+#include "mimiio.h"
+#include "typedef.hpp"
+#include <Poco/Runnable.h>
+#include <Poco/Mutex.h>
+#include <functional>
+#include <memory>
+
+namespace mimiio{
+
+/**
+ * @class mimiioOpenRequest
+ * @brief Opens a mimi connection in background thread and reports the result.
+ *
+ * The result is reported to the completion callback if it is set, otherwise it is kept until poll() takes it.
+ * Cancellation is cooperative: a blocking connection attempt can not be interrupted, so the attempt runs to
+ * completion (or timeout) in background, and the connection is closed instead of being reported.
+ */
+class mimiioOpenRequest : public Poco::Runnable
+{
+public:
+
+	typedef std::shared_ptr<mimiioOpenRequest> Ptr;
+
+	/**
+	 * @brief Function which actually opens the connection, same contract as mimi_open()
+	 */
+	typedef std::function<MIMI_IO*(int*)> OPENER_T;
+
+	/**
+	 * @brief Completion callback type, same as mimi_open_async()
+	 */
+	typedef void (*ON_OPEN_CALLBACK_T)(MIMI_IO*, int, void*);
+
+	/**
+	 * @brief Start opening in background thread
+	 *
+	 * @param [in] opener function which opens the connection
+	 * @param [in] callback completion callback, NULL for polling.
+	 * @param [in] userdata user defined data for \e callback
+	 * @return request, or NULL when the background thread could not be started.
+	 */
+	static Ptr start(const OPENER_T& opener, ON_OPEN_CALLBACK_T callback, void* userdata);
+
+	/**
+	 * @brief D'tor, close the connection which has not been taken.
+	 */
+	~mimiioOpenRequest();
+
+	/**
+	 * @brief Poll the result
+	 *
+	 * @param [out] mio the connection, which is set only once when the request has succeeded and no callback is set.
+	 * @param [out] errorno error code of the request
+	 * @return true if the request has completed, otherwise false.
+	 */
+	bool poll(MIMI_IO** mio, int* errorno);
+
+	/**
+	 * @brief Cancel the request
+	 *
+	 * After this function returns, the callback is never called, and the connection is closed when it is established.
+	 */
+	void cancel();
+
+	/**
+	 * @brief Open connection and report the result
+	 */
+	void run();
+
+private:
+
+	mimiioOpenRequest(const OPENER_T& opener, ON_OPEN_CALLBACK_T callback, void* userdata);
+	mimiioOpenRequest(mimiioOpenRequest const&) = delete;
+	mimiioOpenRequest& operator = (mimiioOpenRequest const&) = delete;
+
+	OPENER_T opener_;
+	ON_OPEN_CALLBACK_T callback_;
+	void* userdata_;
+	Ptr self_; // keeps this request alive while opening
+
+	Poco::Mutex mutex_; // recursive, also held while the callback is running
+	bool completed_;
+	bool cancelled_;
+	int errorno_;
+	MIMI_IO* mio_;
+};
+
+}
+
+#endif
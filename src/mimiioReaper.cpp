@@ -0,0 +1,66 @@
+/**
+ * @file mimiioReaper.cpp
+ * @brief Background closing of connections released by mimi_close()
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "mimiioReaper.hpp"
+#include <chrono>
+
+namespace mimiio{
+
+mimiioReaper::mimiioReaper(Poco::Logger& logger) :
+		finish_(false),
+		logger_(logger)
+{
+	thread_.setName("mimiio-reaper");
+	thread_.start(*this);
+}
+
+mimiioReaper::~mimiioReaper()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		finish_ = true;
+	}
+	cond_.notify_all();
+	thread_.join();
+}
+
+void mimiioReaper::reap(std::unique_ptr<mimiioController> controller)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		incoming_.push_back(Entry());
+		incoming_.back().controller = std::move(controller);
+	}
+	cond_.notify_all();
+}
+
+void mimiioReaper::run()
+{
+	bool finish = false;
+	while(!finish || !closing_.empty()){
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			if(closing_.empty()){
+				cond_.wait(lock, [this]{ return !incoming_.empty() || finish_; });
+			}else{
+				cond_.wait_for(lock, std::chrono::milliseconds(poll_msec_), [this]{ return !incoming_.empty() || finish_; });
+			}
+			closing_.splice(closing_.end(), incoming_); // the clock of each entry started in reap()
+			finish = finish_;
+		}
+		for(std::list<Entry>::iterator it = closing_.begin(); it != closing_.end();){
+			if(it->controller->linger(finish || it->since.isElapsed(linger_msec_ * 1000))){
+				it->controller.reset(); // joins workers, which are not blocked any more
+				it = closing_.erase(it);
+			}else{
+				++it;
+			}
+		}
+	}
+	poco_debug(logger_, "lmio: reaper: finished.");
+}
+
+}
@@ -0,0 +1,83 @@
+/**
+ * @file mimiioReaper.hpp
+ * @brief Background closing of connections released by mimi_close()
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_MIMIIOREAPER_HPP__
+#define LIBMIMIIO_MIMIIOREAPER_HPP__
+
+#include "mimiioController.hpp"
+#include <Poco/Runnable.h>
+#include <Poco/Thread.h>
+#include <Poco/Clock.h>
+#include <Poco/Logger.h>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+
+namespace mimiio{
+
+/**
+ * @class mimiioReaper
+ * @brief Thread performing the close handshake of abandoned connections and destroying them
+ *
+ * Destroying a controller joins its workers, which may be blocked in receiving for the receive timeout.
+ * mimi_close() passes the controller to the reaper instead, and the reaper calls mimiioController::linger() of each connection
+ * until the handshake completes or linger time passes, then destroys it. Connections are closed concurrently.
+ */
+class mimiioReaper : public Poco::Runnable
+{
+public:
+
+	static const long linger_msec_ = 1000; //!< maximum time waiting for the close handshake
+	static const long poll_msec_ = 10;     //!< interval of checking connections being closed
+
+	/**
+	 * @brief C'tor, start the thread
+	 *
+	 * @param [in] logger logger
+	 */
+	explicit mimiioReaper(Poco::Logger& logger);
+
+	/**
+	 * @brief D'tor, shut down remaining connections immediately and join the thread
+	 */
+	~mimiioReaper();
+
+	/**
+	 * @brief Close and destroy \e controller in the background
+	 *
+	 * @param [in] controller abandoned controller, see mimiioController::abandon().
+	 */
+	void reap(std::unique_ptr<mimiioController> controller);
+
+	/**
+	 * @brief Close connections until the reaper is destroyed
+	 */
+	void run();
+
+private:
+
+	mimiioReaper(mimiioReaper const&) = delete;
+	mimiioReaper& operator = (mimiioReaper const&) = delete;
+
+	struct Entry
+	{
+		std::unique_ptr<mimiioController> controller;
+		Poco::Clock since;
+	};
+
+	std::mutex mutex_; // for incoming_ and finish_
+	std::condition_variable cond_;
+	std::list<Entry> incoming_;
+	bool finish_;
+	std::list<Entry> closing_; // only accessed by the thread
+	Poco::Thread thread_;
+	Poco::Logger& logger_;
+};
+
+}
+
+#endif
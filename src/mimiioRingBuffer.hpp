@@ -0,0 +1,161 @@
+/**
+ * @file mimiioRingBuffer.hpp
+ * @brief Bounded lock-free byte ring buffer for one producer and one consumer
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_MIMIIORINGBUFFER_HPP__
+#define LIBMIMIIO_MIMIIORINGBUFFER_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+namespace mimiio{
+
+/**
+ * @class mimiioRingBuffer
+ * @brief Bounded lock-free byte ring buffer
+ *
+ * acquire(), commit() and write() must be called only by one producer thread, and peek(), consume() and read()
+ * only by one consumer thread at a time. Positions increase monotonically and are wrapped by the capacity.
+ *
+ * The capacity is a multiple of the granularity. If the producer commits only multiples of the granularity,
+ * every contiguous region returned by acquire() and peek() is also a multiple of it, e.g. whole audio frames.
+ */
+class mimiioRingBuffer
+{
+public:
+
+	/**
+	 * @brief C'tor
+	 *
+	 * @param [in] capacity capacity in bytes, rounded up to a multiple of \e granularity
+	 * @param [in] granularity unit of data in bytes
+	 */
+	mimiioRingBuffer(size_t capacity, size_t granularity = 1) :
+			head_(0),
+			tail_(0)
+	{
+		granularity = std::max<size_t>(granularity, 1);
+		buffer_.resize(std::max<size_t>((capacity + granularity - 1) / granularity, 1) * granularity);
+	}
+
+	/**
+	 * @brief Get capacity in bytes
+	 */
+	size_t capacity() const { return buffer_.size(); }
+
+	/**
+	 * @brief Get the number of bytes which can be read, called by the consumer.
+	 */
+	size_t readable() const
+	{
+		return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Get the number of bytes which can be written, called by the producer.
+	 */
+	size_t writable() const
+	{
+		return buffer_.size() - (tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_acquire));
+	}
+
+	/**
+	 * @brief Get the contiguous writable region, called by the producer.
+	 *
+	 * @param [out] len length of the region, which may be less than writable() at the end of the buffer.
+	 * @return start of the region, written data becomes readable by commit().
+	 */
+	char* acquire(size_t& len)
+	{
+		const size_t offset = tail_.load(std::memory_order_relaxed) % buffer_.size();
+		len = std::min(writable(), buffer_.size() - offset);
+		return &buffer_[offset];
+	}
+
+	/**
+	 * @brief Make \e len bytes written to the region returned by acquire() readable
+	 */
+	void commit(size_t len)
+	{
+		tail_.store(tail_.load(std::memory_order_relaxed) + len, std::memory_order_release);
+	}
+
+	/**
+	 * @brief Get the contiguous readable region, called by the consumer.
+	 *
+	 * @param [out] len length of the region, which may be less than readable() at the end of the buffer.
+	 * @return start of the region, which is valid until consume().
+	 */
+	const char* peek(size_t& len) const
+	{
+		const size_t offset = head_.load(std::memory_order_relaxed) % buffer_.size();
+		len = std::min(readable(), buffer_.size() - offset);
+		return &buffer_[offset];
+	}
+
+	/**
+	 * @brief Release \e len bytes of the region returned by peek() for the producer
+	 */
+	void consume(size_t len)
+	{
+		head_.store(head_.load(std::memory_order_relaxed) + len, std::memory_order_release);
+	}
+
+	/**
+	 * @brief Write all of \e data, or nothing if there is not enough space.
+	 *
+	 * @param [in] data data to write
+	 * @param [in] len length of data
+	 * @return true if written
+	 */
+	bool write(const char* data, size_t len)
+	{
+		if(writable() < len){
+			return false;
+		}
+		size_t first = 0;
+		char* region = acquire(first);
+		first = std::min(first, len);
+		std::memcpy(region, data, first);
+		std::memcpy(&buffer_[0], data + first, len - first);
+		commit(len);
+		return true;
+	}
+
+	/**
+	 * @brief Read up to \e len bytes
+	 *
+	 * @param [out] data buffer to read into
+	 * @param [in] len size of \e data
+	 * @return the number of bytes read
+	 */
+	size_t read(char* data, size_t len)
+	{
+		const size_t n = std::min(len, readable());
+		size_t first = 0;
+		const char* region = peek(first);
+		first = std::min(first, n);
+		std::memcpy(data, region, first);
+		std::memcpy(data + first, &buffer_[0], n - first);
+		consume(n);
+		return n;
+	}
+
+private:
+
+	mimiioRingBuffer(mimiioRingBuffer const&) = delete;
+	mimiioRingBuffer& operator = (mimiioRingBuffer const&) = delete;
+
+	std::vector<char> buffer_;
+	std::atomic<size_t> head_; // read position, written by the consumer
+	char padding_[64 - sizeof(std::atomic<size_t>)]; // keep positions on different cache lines
+	std::atomic<size_t> tail_; // write position, written by the producer
+};
+
+}
+
+#endif
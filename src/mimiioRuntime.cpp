@@ -0,0 +1,130 @@
+/**
+ * @file mimiioRuntime.cpp
+ * @brief Process-wide options and resources shared by all mimi connections.
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "mimiioRuntime.hpp"
+#include <Poco/Environment.h>
+#include <Poco/NumberParser.h>
+#include <algorithm>
+
+namespace mimiio{
+
+const int default_worker_threads_ = 16; //!< threads kept in the worker pool if not specified
+const int maximum_worker_threads_ = 4096; //!< limit of the worker pool, each connection uses 3 threads
+const int worker_idle_time_ = 60; //!< seconds until threads more than the kept ones exit
+const int maximum_encoder_threads_ = 256; //!< limit of the encoder pool
+
+mimiioRuntime& mimiioRuntime::instance()
+{
+	static mimiioRuntime runtime;
+	return runtime;
+}
+
+mimiioRuntime::mimiioRuntime() :
+		frozen_(false)
+{
+	mimi_init_options_default(&options_);
+}
+
+int mimiioRuntime::init(const MIMIIO_INIT_OPTIONS& options)
+{
+	if(options.version < 1 || MIMIIO_INIT_OPTIONS_VERSION < options.version){
+		return 910;
+	}
+	MIMIIO_INIT_OPTIONS o;
+	mimi_init_options_default(&o);
+	// version 1
+	o.io_backend = options.io_backend;
+	o.io_threads = options.io_threads;
+	if(o.io_backend != MIMIIO_IO_BACKEND_THREAD && o.io_backend != MIMIIO_IO_BACKEND_EPOLL){
+		return 910;
+	}
+	if(o.io_backend != MIMIIO_IO_BACKEND_THREAD && !reactor::mimiioReactor::supported()){
+		return 910;
+	}
+	// version 2
+	if(2 <= options.version){
+		o.tls_offload = options.tls_offload;
+	}
+	// version 3
+	if(3 <= options.version){
+		o.worker_threads = options.worker_threads;
+		if(o.worker_threads < 0 || maximum_worker_threads_ < o.worker_threads){
+			return 910;
+		}
+	}
+	// version 4
+	if(4 <= options.version){
+		o.encoder_threads = options.encoder_threads;
+		if(o.encoder_threads < 0 || maximum_encoder_threads_ < o.encoder_threads){
+			return 910;
+		}
+	}
+
+	Poco::FastMutex::ScopedLock lock(mutex_);
+	if(frozen_){
+		return 909;
+	}
+	options_ = o;
+	return 0;
+}
+
+MIMIIO_INIT_OPTIONS mimiioRuntime::options()
+{
+	Poco::FastMutex::ScopedLock lock(mutex_);
+	frozen_ = true;
+	return options_;
+}
+
+reactor::mimiioReactor& mimiioRuntime::reactor(Poco::Logger& logger)
+{
+	Poco::FastMutex::ScopedLock lock(mutex_);
+	frozen_ = true;
+	if(!reactor_){
+		reactor_.reset(new reactor::mimiioReactor(options_.io_threads, logger));
+	}
+	return *reactor_;
+}
+
+Poco::ThreadPool& mimiioRuntime::workers(Poco::Logger& logger)
+{
+	Poco::FastMutex::ScopedLock lock(mutex_);
+	frozen_ = true;
+	if(!workers_){
+		int threads = options_.worker_threads;
+		if(threads == 0 && !Poco::NumberParser::tryParse(Poco::Environment::get("MIMIIO_WORKER_THREADS", ""), threads)){
+			threads = default_worker_threads_;
+		}
+		if(threads <= 0){
+			// Poco::ThreadPool requires at least one thread kept
+			threads = default_worker_threads_;
+		}
+		threads = std::min(threads, maximum_worker_threads_);
+		workers_.reset(new Poco::ThreadPool("mimiio-worker", threads, maximum_worker_threads_, worker_idle_time_));
+		logger.information("lmio: worker pool: %d threads kept.", threads);
+	}
+	return *workers_;
+}
+
+mimiioEncodePool& mimiioRuntime::encoders(Poco::Logger& logger)
+{
+	Poco::FastMutex::ScopedLock lock(mutex_);
+	frozen_ = true;
+	if(!encoders_){
+		encoders_.reset(new mimiioEncodePool(options_.encoder_threads, logger));
+	}
+	return *encoders_;
+}
+
+mimiioReaper& mimiioRuntime::reaper(Poco::Logger& logger)
+{
+	Poco::FastMutex::ScopedLock lock(mutex_);
+	if(!reaper_){
+		reaper_.reset(new mimiioReaper(logger));
+	}
+	return *reaper_;
+}
+
+}
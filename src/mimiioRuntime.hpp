@@ -0,0 +1,108 @@
+/**
+ * @file mimiioRuntime.hpp
+ * @brief Process-wide options and resources shared by all mimi connections.
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_MIMIIORUNTIME_HPP__
+#define LIBMIMIIO_MIMIIORUNTIME_HPP__
+
+#include "mimiio.h"
+#include "reactor/mimiioEventLoop.hpp"
+#include "mimiioReaper.hpp"
+#include "mimiioEncodePool.hpp"
+#include <Poco/Mutex.h>
+#include <Poco/ThreadPool.h>
+#include <Poco/Logger.h>
+#include <memory>
+
+namespace mimiio{
+
+/**
+ * @class mimiioRuntime
+ * @brief Keeps options given by mimi_init() and creates shared resources on their first use.
+ *
+ * Options can not be changed once a shared resource has been created with them.
+ */
+class mimiioRuntime
+{
+public:
+
+	/**
+	 * @brief Get the process-wide instance
+	 */
+	static mimiioRuntime& instance();
+
+	/**
+	 * @brief Set options
+	 *
+	 * @param [in] options options, only the fields defined in its version are used.
+	 * @return 0 if succeeded, 909 if shared resources have been already created, 910 if options are invalid.
+	 */
+	int init(const MIMIIO_INIT_OPTIONS& options);
+
+	/**
+	 * @brief Get current options
+	 */
+	MIMIIO_INIT_OPTIONS options();
+
+	/**
+	 * @brief Get the reactor, start it on the first call.
+	 *
+	 * @param [in] logger logger
+	 * @return shared reactor
+	 * @throws Poco::Exception if event loops could not be started.
+	 */
+	reactor::mimiioReactor& reactor(Poco::Logger& logger);
+
+	/**
+	 * @brief Get the worker pool, create it on the first call.
+	 *
+	 * Threads of the pool run workers of callback API connections and mimi_open_async(), and are reused across connections.
+	 * The pool keeps \e worker_threads of ::MIMIIO_INIT_OPTIONS, or MIMIIO_WORKER_THREADS environment variable if it is 0 (16 if the variable is not a positive number),
+	 * and grows as needed. Threads more than that exit after being idle for a while.
+	 *
+	 * @param [in] logger logger
+	 * @return shared worker pool
+	 */
+	Poco::ThreadPool& workers(Poco::Logger& logger);
+
+	/**
+	 * @brief Get the encoder pool, start it on the first call.
+	 *
+	 * Threads of the pool encode audio of connections enabled by mimi_set_tx_pipeline(). The number of threads is
+	 * \e encoder_threads of ::MIMIIO_INIT_OPTIONS, or the number of CPU cores if it is 0.
+	 *
+	 * @param [in] logger logger
+	 * @return shared encoder pool
+	 */
+	mimiioEncodePool& encoders(Poco::Logger& logger);
+
+	/**
+	 * @brief Get the reaper closing connections released by mimi_close(), start it on the first call.
+	 *
+	 * Options are not frozen by this function.
+	 *
+	 * @param [in] logger logger
+	 * @return shared reaper
+	 */
+	mimiioReaper& reaper(Poco::Logger& logger);
+
+private:
+
+	mimiioRuntime();
+	mimiioRuntime(mimiioRuntime const&) = delete;
+	mimiioRuntime& operator = (mimiioRuntime const&) = delete;
+
+	Poco::FastMutex mutex_;
+	MIMIIO_INIT_OPTIONS options_;
+	bool frozen_; // options are in use
+	std::unique_ptr<reactor::mimiioReactor> reactor_;
+	std::unique_ptr<Poco::ThreadPool> workers_;
+	std::unique_ptr<mimiioEncodePool> encoders_;
+	std::unique_ptr<mimiioReaper> reaper_; // destroyed first, connections being closed use the reactor and workers
+};
+
+}
+
+#endif
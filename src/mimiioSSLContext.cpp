@@ -0,0 +1,118 @@
+/**
+ * @file mimiioSSLContext.cpp
+ * @brief Process-wide SSL client context shared by all mimi connections.
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "mimiioSSLContext.hpp"
+#include "mimiioImpl.hpp"
+#include "mimiioRuntime.hpp"
+#include "config.h"
+
+#include <Poco/Net/SSLManager.h>
+#include <Poco/Format.h>
+#include <Poco/Logger.h>
+#include <openssl/ssl.h>
+#ifdef __linux__
+#include <sys/socket.h>
+#if defined(__has_include)
+#if __has_include(<linux/tls.h>)
+#include <linux/tls.h>
+#endif
+#endif
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#endif
+
+namespace mimiio{
+
+mimiioSSLContext& mimiioSSLContext::instance()
+{
+	static mimiioSSLContext context;
+	return context;
+}
+
+mimiioSSLContext::mimiioSSLContext() :
+		resumed_(0),
+		full_(0)
+{}
+
+void mimiioSSLContext::initialize()
+{
+	Poco::Net::initializeSSL();
+	Poco::SharedPtr<Poco::Net::PrivateKeyPassphraseHandler> ph1 = new NoopPrivateKeyPassphraseHandler(false);
+	Poco::SharedPtr<Poco::Net::InvalidCertificateHandler> ph2 = new NotifyAndRejectCertificateHandler(false);
+#ifdef WITH_SSL_DEFAULT_CERT
+	Poco::Net::Context::Ptr ptrContext = new Poco::Net::Context(Poco::Net::Context::CLIENT_USE, "", "", SSL_DEFAULT_CERT, Poco::Net::Context::VERIFY_RELAXED, 9, true, "ALL:!ADH:!LOW:!EXP:!MD5:@STRENGTH");
+#elif __ANDROID__
+	Poco::Net::Context::Ptr ptrContext = new Poco::Net::Context(Poco::Net::Context::CLIENT_USE, "", "", "/etc/security/cacerts/b0f3e76e.0", Poco::Net::Context::VERIFY_RELAXED, 9, true, "ALL:!ADH:!LOW:!EXP:!MD5:@STRENGTH");
+#else
+	Poco::Net::Context::Ptr ptrContext = new Poco::Net::Context(Poco::Net::Context::CLIENT_USE, "", "", "", Poco::Net::Context::VERIFY_RELAXED, 9, true, "ALL:!ADH:!LOW:!EXP:!MD5:@STRENGTH");
+#endif
+	ptrContext->enableSessionCache(true);
+	// Frames queued on non-blocking sockets are written again from a queue which may have grown, see websocket::mimiioFramer.
+	SSL_CTX_set_mode(ptrContext->sslContext(), SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+	if(mimiioRuntime::instance().options().tls_offload){
+#if HAVE_KTLS
+		SSL_CTX_set_options(ptrContext->sslContext(), SSL_OP_ENABLE_KTLS);
+#else
+		Poco::Logger::get(PACKAGE_NAME).warning("lmio: kernel TLS requires OpenSSL 3.0 or later, tls_offload is ignored.");
+#endif
+	}
+	Poco::Net::SSLManager::instance().initializeClient(ph1, ph2, ptrContext);
+	context_ = ptrContext;
+}
+
+Poco::Net::Context::Ptr mimiioSSLContext::context()
+{
+	// If initialize() throws, the flag is left unset and the next connection tries again.
+	std::call_once(flag_, &mimiioSSLContext::initialize, this);
+	return context_;
+}
+
+int mimiioSSLContext::offloaded(int fd)
+{
+	int flags = 0;
+#if defined(__linux__) && defined(TLS_TX) && defined(TLS_RX)
+	// getsockopt() succeeds only if the keys have been installed in the kernel.
+	struct tls12_crypto_info_aes_gcm_256 info; // the largest crypto info
+	socklen_t len = sizeof(info);
+	if(::getsockopt(fd, SOL_TLS, TLS_TX, &info, &len) == 0){
+		flags |= MIMIIO_TLS_OFFLOAD_TX;
+	}
+	len = sizeof(info);
+	if(::getsockopt(fd, SOL_TLS, TLS_RX, &info, &len) == 0){
+		flags |= MIMIIO_TLS_OFFLOAD_RX;
+	}
+#endif
+	return flags;
+}
+
+Poco::Net::Session::Ptr mimiioSSLContext::session(const std::string& hostname, int port)
+{
+	Poco::FastMutex::ScopedLock lock(mutex_);
+	std::map<std::string, Poco::Net::Session::Ptr>::const_iterator it = sessions_.find(Poco::format("%s:%d", hostname, port));
+	if(it == sessions_.end()){
+		return Poco::Net::Session::Ptr();
+	}
+	return it->second;
+}
+
+void mimiioSSLContext::update(const std::string& hostname, int port, Poco::Net::Session::Ptr established, bool resumed)
+{
+	if(resumed){
+		++resumed_;
+	}else{
+		++full_;
+	}
+	Poco::FastMutex::ScopedLock lock(mutex_);
+	std::string key = Poco::format("%s:%d", hostname, port);
+	if(established.isNull()){
+		sessions_.erase(key);
+	}else{
+		sessions_[key] = established;
+	}
+}
+
+}
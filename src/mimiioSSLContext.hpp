@@ -0,0 +1,104 @@
+/**
+ * @file mimiioSSLContext.hpp
+ * @brief Process-wide SSL client context shared by all mimi connections.
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_MIMIIOSSLCONTEXT_HPP__
+#define LIBMIMIIO_MIMIIOSSLCONTEXT_HPP__
+
+#include <Poco/Net/Context.h>
+#include <Poco/Net/Session.h>
+#include <Poco/Mutex.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace mimiio{
+
+/**
+ * @class mimiioSSLContext
+ * @brief Process-wide SSL client context with TLS session resumption.
+ *
+ * The SSL library, the client context and the SSLManager are initialized only once per process,
+ * when the first authenticated connection is opened. The last SSL session established with each
+ * remote host and port is kept, so that following connections to the same host resume it
+ * instead of performing a full handshake.
+ * If \e tls_offload of ::MIMIIO_INIT_OPTIONS is set, OpenSSL is asked to hand the keys of each session to
+ * Linux kernel TLS after the handshake, so that records are encrypted and decrypted in the kernel.
+ */
+class mimiioSSLContext
+{
+public:
+
+	/**
+	 * @brief Get the process-wide instance
+	 *
+	 * @return process-wide SSL context
+	 */
+	static mimiioSSLContext& instance();
+
+	/**
+	 * @brief Get the client context, create it on the first call.
+	 *
+	 * @return SSL client context
+	 */
+	Poco::Net::Context::Ptr context();
+
+	/**
+	 * @brief Get the cached SSL session for the remote host
+	 *
+	 * @param [in] hostname remote host
+	 * @param [in] port remote port
+	 * @return cached SSL session, or null if no session has been established with the host yet.
+	 */
+	Poco::Net::Session::Ptr session(const std::string& hostname, int port);
+
+	/**
+	 * @brief Record the SSL session established with the remote host
+	 *
+	 * @param [in] hostname remote host
+	 * @param [in] port remote port
+	 * @param [in] established SSL session established by the handshake
+	 * @param [in] resumed true if the handshake resumed the session returned by session()
+	 */
+	void update(const std::string& hostname, int port, Poco::Net::Session::Ptr established, bool resumed);
+
+	/**
+	 * @brief Get the number of resumed handshakes since process start
+	 */
+	unsigned long resumedHandshakes() const { return resumed_.load(); }
+
+	/**
+	 * @brief Get the number of full handshakes since process start
+	 */
+	unsigned long fullHandshakes() const { return full_.load(); }
+
+	/**
+	 * @brief Determine whether TLS records on the socket are processed by Linux kernel TLS
+	 *
+	 * @param [in] fd file descriptor of the socket which has finished the handshake
+	 * @return bitwise OR of ::MIMIIO_TLS_OFFLOAD_TX and ::MIMIIO_TLS_OFFLOAD_RX
+	 */
+	static int offloaded(int fd);
+
+private:
+
+	mimiioSSLContext();
+	mimiioSSLContext(mimiioSSLContext const&) = delete;
+	mimiioSSLContext& operator = (mimiioSSLContext const&) = delete;
+
+	void initialize();
+
+	std::once_flag flag_;
+	Poco::Net::Context::Ptr context_;
+	Poco::FastMutex mutex_;
+	std::map<std::string, Poco::Net::Session::Ptr> sessions_; // key is "host:port"
+	std::atomic<unsigned long> resumed_;
+	std::atomic<unsigned long> full_;
+};
+
+}
+
+#endif
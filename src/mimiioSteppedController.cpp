@@ -0,0 +1,132 @@
+/**
+ * @file mimiioSteppedController.cpp
+ * @brief Controller base class for asynchronous callback API whose workers are run step by step
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "mimiioSteppedController.hpp"
+#include "strerror.hpp"
+
+namespace mimiio{
+
+mimiioSteppedController::mimiioSteppedController(
+		mimiioImpl* impl,
+		encoder::Encoder* encoder,
+		ON_TX_CALLBACK_T txfunc,
+		ON_RX_CALLBACK_T rxfunc,
+		void* userdata_for_tx,
+		void* userdata_for_rx,
+		const std::string& name,
+		Poco::Logger& logger) :
+		mimiioController(impl, encoder, logger),
+		name_(name),
+		rxWorker_(new worker::mimiioRxWorker(impl_, rxfunc, userdata_for_rx, notifier_, logger)),
+		txWorker_(new worker::mimiioTxWorker(impl_, encoder_, txfunc, userdata_for_tx, notifier_, logger))
+{
+}
+
+mimiioSteppedController::~mimiioSteppedController()
+{
+}
+
+bool mimiioSteppedController::isActive() const
+{
+	if(txWorker_->finished() && rxWorker_->finished()){
+		return false;
+	}else{
+		return true;
+	}
+}
+
+bool mimiioSteppedController::completed() const
+{
+	return !isActive() && (errorno_ != 0 || (txWorker_->errorno() == 0 && rxWorker_->errorno() == 0));
+}
+
+MIMIIO_STREAM_STATE mimiioSteppedController::streamState() const
+{
+	if(!started_){
+		return MIMIIO_STREAM_WAIT;
+	}
+
+	if(txWorker_->finished() && rxWorker_->finished()){
+		return MIMIIO_STREAM_CLOSED;
+	}else if(txWorker_->finished()){
+		return MIMIIO_STREAM_RECV;
+	}else if(rxWorker_->finished()){
+		return MIMIIO_STREAM_SEND;
+	}else{
+		return MIMIIO_STREAM_BOTH;
+	}
+}
+
+int mimiioSteppedController::setTxCoalescing(size_t max_bytes, int max_delay_ms)
+{
+	if(started_){
+		logger_.error("%s: tx coalescing must be set before start (908).", name_);
+		return 908;
+	}
+	txWorker_->setCoalescing(max_bytes, max_delay_ms);
+	return 0;
+}
+
+int mimiioSteppedController::setNativeFraming(bool enable)
+{
+	if(!enable){
+		logger_.error("%s: native framing can not be disabled: %s (917)", name_, std::string(mimiio::strerror(917)));
+		return 917;
+	}
+	return mimiioController::setNativeFraming(enable);
+}
+
+void mimiioSteppedController::configure(const MIMIIO_OPEN_OPTIONS& options)
+{
+	mimiioController::configure(options);
+	txWorker_->setBufferSize(options.send_buffer_size);
+	txWorker_->setIdleSleep(options.tx_idle_sleep_ms);
+}
+
+bool mimiioSteppedController::txFinished() const
+{
+	return !started_ || txWorker_->finished();
+}
+
+void mimiioSteppedController::interrupt()
+{
+	txWorker_->finish();
+	rxWorker_->finish();
+	mimiioController::interrupt();
+}
+
+bool mimiioSteppedController::drain()
+{
+	//Read until the socket has no more data, since messages buffered by SSL or the framer are not notified by the socket.
+	do{
+		if(rxWorker_->step() < 0){
+			return false;
+		}
+	}while(!rxWorker_->drained());
+	return true;
+}
+
+void mimiioSteppedController::monitor()
+{
+	if(errorno_ != 0 || (txWorker_->errorno() == 0 && rxWorker_->errorno() == 0)){
+		return;
+	}
+	if(txWorker_->errorno() != 0){
+		errorno_ = txWorker_->errorno();
+		poco_debug_f2(logger_, "%s: txWorker error detected, errorno = %d", name_, errorno_);
+	}else{
+		errorno_ = rxWorker_->errorno();
+		poco_debug_f2(logger_, "%s: rxWorker error detected, errorno = %d", name_, errorno_);
+	}
+	txWorker_->finish();
+	rxWorker_->finish();
+	txWorker_->step(); // mark finished without waiting for the next step
+	rxWorker_->step();
+	stopped();
+	notifier_.notify(); // errorno has been reported
+}
+
+}
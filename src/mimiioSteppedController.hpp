@@ -0,0 +1,119 @@
+/**
+ * @file mimiioSteppedController.hpp
+ * @brief Controller base class for asynchronous callback API whose workers are run step by step
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_MIMIIOSTEPPEDCONTROLLER_HPP_
+#define LIBMIMIIO_MIMIIOSTEPPEDCONTROLLER_HPP_
+
+#include "mimiioController.hpp"
+#include "worker/mimiioRxWorker.hpp"
+#include "worker/mimiioTxWorker.hpp"
+#include <string>
+
+namespace mimiio{
+
+/**
+ * @class mimiioSteppedController
+ * @brief Control class for asynchronous callback API without threads of its own
+ *
+ * Iterations of mimiioTxWorker and mimiioRxWorker are run by the subclass, on an event loop or on the caller's loop,
+ * with the socket non-blocking and frames handled by the built-in framer. This class holds both workers,
+ * and reports the state and the error of the connection from them.
+ * @see mimiioEventLoopController, mimiioCooperativeController
+ */
+class mimiioSteppedController : public mimiioController
+{
+public:
+
+	/**
+	 * @brief C'tor with mimiioImpl class, mimi(R) API implementation class
+	 *
+	 * @param [in] impl mimiio implementation class
+	 * @param [in] encoder audio encoder
+	 * @param [in] txfunc user defined callback function for sending audio
+	 * @param [in] rxfunc user defined callback function for receiving response from remote host
+	 * @param [in,out] userdata_for_tx user defined data for \e txfunc
+	 * @param [in,out] userdata_for_rx user defined data for \e rxfunc
+	 * @param [in] name class name prefixed to log messages
+	 * @param [in] logger logger
+	 */
+	mimiioSteppedController(
+			mimiioImpl* impl,
+			encoder::Encoder* encoder,
+			ON_TX_CALLBACK_T txfunc,
+			ON_RX_CALLBACK_T rxfunc,
+			void* userdata_for_tx,
+			void* userdata_for_rx,
+			const std::string& name,
+			Poco::Logger& logger);
+
+	virtual ~mimiioSteppedController();
+
+	virtual bool isActive() const;
+
+	virtual MIMIIO_STREAM_STATE streamState() const;
+
+	virtual int setTxCoalescing(size_t max_bytes, int max_delay_ms);
+
+	/**
+	 * @brief Built-in framing is always used, since frames on the non-blocking socket must be resumed.
+	 *
+	 * @return 917 if \e enable is false.
+	 */
+	virtual int setNativeFraming(bool enable);
+
+	/**
+	 * @brief Apply buffer size and idle sleep to the tx worker, thread settings are ignored.
+	 */
+	virtual void configure(const MIMIIO_OPEN_OPTIONS& options);
+
+protected:
+
+	static const long stall_check_msec_ = 1000; //!< maximum wait while queued frames are not written, to check the send timeout
+
+	/**
+	 * @brief Both workers have finished and the error has been reported by monitor(), if any.
+	 */
+	virtual bool completed() const;
+
+	virtual bool txFinished() const;
+
+	/**
+	 * @brief Finish both workers and shut down the socket
+	 */
+	virtual void interrupt();
+
+	/**
+	 * @brief Called by monitor() after both workers have been stopped by an error, before the error is reported.
+	 */
+	virtual void stopped() {}
+
+	/**
+	 * @brief Run the rx worker until the socket has no more data
+	 *
+	 * @return false if the rx worker has finished.
+	 */
+	bool drain();
+
+	/**
+	 * @brief Stop both workers if either of them has failed, same as mimiioAsynchronousCallbackAPIMonitor
+	 */
+	void monitor();
+
+	const std::string name_;
+	worker::mimiioRxWorker::Ptr rxWorker_;
+	worker::mimiioTxWorker::Ptr txWorker_;
+
+private:
+
+	mimiioSteppedController(mimiioSteppedController const&) = delete;
+	mimiioSteppedController(mimiioSteppedController &&) = delete;
+	mimiioSteppedController& operator = (mimiioSteppedController const&) = delete;
+	mimiioSteppedController& operator = (mimiioSteppedController&&) = delete;
+};
+
+}
+
+#endif
@@ -49,6 +49,11 @@ int mimiioSynchronousAPIController::start()
 	return 0;
 }
 
+bool mimiioSynchronousAPIController::wait(long timeout_ms)
+{
+	return !isActive();
+}
+
 }
 
 
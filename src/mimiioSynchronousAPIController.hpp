@@ -56,6 +56,13 @@ public:
 	 */
 	virtual int start();
 
+	/**
+	 * @brief Return immediately, since the connection is driven only by the caller of the synchronous API.
+	 *
+	 * @return true if the connection is not active.
+	 */
+	virtual bool wait(long timeout_ms);
+
 private:
 
 	mimiioSynchronousAPIController(mimiioSynchronousAPIController const&) = delete;
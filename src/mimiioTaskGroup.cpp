@@ -0,0 +1,145 @@
+/**
+ * @file mimiioTaskGroup.cpp
+ * @brief Tasks of one connection running on the process-wide worker pool
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "mimiioTaskGroup.hpp"
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace mimiio{
+
+namespace {
+
+#ifdef __linux__
+
+/**
+ * @brief Pin the calling thread to \e cpu, and restore the previous affinity on destruction
+ */
+class ScopedAffinity
+{
+public:
+	explicit ScopedAffinity(int cpu) : pinned_(false)
+	{
+		if(cpu < 0 || CPU_SETSIZE <= cpu || pthread_getaffinity_np(pthread_self(), sizeof(saved_), &saved_) != 0){
+			return;
+		}
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		pinned_ = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+	}
+	~ScopedAffinity()
+	{
+		if(pinned_){
+			pthread_setaffinity_np(pthread_self(), sizeof(saved_), &saved_);
+		}
+	}
+private:
+	bool pinned_;
+	cpu_set_t saved_;
+};
+
+/**
+ * @brief Set the nice value of the calling thread from \e priority, relative to the nice value it has inherited
+ *
+ * Raising the priority needs CAP_SYS_NICE or RLIMIT_NICE, otherwise the nice value is not changed.
+ */
+void set_thread_priority(Poco::Thread::Priority priority)
+{
+	static const int nice[] = {10, 5, 0, -5, -10}; // PRIO_LOWEST to PRIO_HIGHEST
+	if(priority == Poco::Thread::PRIO_NORMAL){
+		return;
+	}
+	const id_t tid = static_cast<id_t>(syscall(SYS_gettid)); // nice values of Linux are per thread
+	errno = 0;
+	const int inherited = getpriority(PRIO_PROCESS, tid);
+	if(errno == 0){
+		setpriority(PRIO_PROCESS, tid, inherited + nice[priority]);
+	}
+}
+
+#else
+
+class ScopedAffinity
+{
+public:
+	explicit ScopedAffinity(int cpu){}
+};
+
+void set_thread_priority(Poco::Thread::Priority priority)
+{
+	// set by Poco::Thread::setPriority() before the thread starts
+}
+
+#endif
+
+}
+
+void mimiioTaskGroup::start(Poco::ThreadPool& pool, Poco::Runnable& task, const mimiioThreadSettings& settings)
+{
+	tasks_.push_back(std::unique_ptr<Task>(new Task(*this, task, settings)));
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		++running_;
+	}
+	try{
+		if(settings.stackSize == 0 && settings.priority == Poco::Thread::PRIO_NORMAL){
+			pool.start(*tasks_.back());
+		}else{
+			threads_.push_back(std::unique_ptr<Poco::Thread>(new Poco::Thread("mimiio-worker")));
+			if(settings.stackSize != 0){
+				threads_.back()->setStackSize(settings.stackSize);
+			}
+#ifndef __linux__
+			threads_.back()->setPriority(settings.priority);
+#endif
+			threads_.back()->start(*tasks_.back());
+		}
+	}catch(...){
+		done();
+		throw;
+	}
+}
+
+void mimiioTaskGroup::join()
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		cond_.wait(lock, [this]{ return running_ == 0; });
+	}
+	for(size_t i=0;i<threads_.size();++i){
+		if(threads_[i]->isRunning()){
+			threads_[i]->join();
+		}
+	}
+}
+
+void mimiioTaskGroup::done()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	--running_;
+	cond_.notify_all(); // while locked, the group may be destroyed as soon as join() returns
+}
+
+void mimiioTaskGroup::Task::run()
+{
+	try{
+		ScopedAffinity affinity(settings_.cpu);
+		set_thread_priority(settings_.priority); // only on a dedicated thread, see start()
+		target_.run();
+	}catch(...){
+		group_.done();
+		throw;
+	}
+	group_.done();
+}
+
+}
@@ -0,0 +1,95 @@
+/**
+ * @file mimiioTaskGroup.hpp
+ * @brief Tasks of one connection running on the process-wide worker pool
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_MIMIIOTASKGROUP_HPP__
+#define LIBMIMIIO_MIMIIOTASKGROUP_HPP__
+
+#include <Poco/Runnable.h>
+#include <Poco/Thread.h>
+#include <Poco/ThreadPool.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mimiio{
+
+/**
+ * @brief Scheduling of a thread running a task
+ */
+struct mimiioThreadSettings
+{
+	mimiioThreadSettings() : stackSize(0), priority(Poco::Thread::PRIO_NORMAL), cpu(-1){}
+
+	int stackSize;                   //!< stack size in bytes, 0 to run on a thread of the pool
+	Poco::Thread::Priority priority; //!< priority, other than PRIO_NORMAL runs the task on a dedicated thread
+	int cpu;                         //!< CPU which the thread is pinned to, -1 for no affinity
+};
+
+/**
+ * @class mimiioTaskGroup
+ * @brief Runs tasks on a shared thread pool and waits only for them
+ *
+ * Poco::ThreadPool::joinAll() waits for all tasks of the pool, which would wait for other connections when the pool is shared.
+ * Each task is wrapped so that the group knows when its run() has returned.
+ * A task with its own stack size runs on a dedicated thread instead, since threads of the pool have been created already.
+ * So does a task with its own priority: on Linux the priority is a nice value of the thread, since Poco::Thread priorities
+ * have no effect under SCHED_OTHER, and an unprivileged thread can not restore its nice value for the next task of the pool.
+ */
+class mimiioTaskGroup
+{
+public:
+
+	mimiioTaskGroup() : running_(0){}
+
+	/**
+	 * @brief D'tor, join() must have been called.
+	 */
+	~mimiioTaskGroup(){}
+
+	/**
+	 * @brief Run \e task on a thread of \e pool, or on a dedicated thread
+	 *
+	 * @param [in] pool thread pool
+	 * @param [in] task task, which must be alive until join() returns.
+	 * @param [in] settings scheduling of the thread
+	 * @throws Poco::NoThreadAvailableException if the pool is exhausted, or Poco::SystemException if a thread could not be created.
+	 */
+	void start(Poco::ThreadPool& pool, Poco::Runnable& task, const mimiioThreadSettings& settings = mimiioThreadSettings());
+
+	/**
+	 * @brief Wait for all started tasks to return from run()
+	 */
+	void join();
+
+private:
+
+	mimiioTaskGroup(mimiioTaskGroup const&) = delete;
+	mimiioTaskGroup& operator = (mimiioTaskGroup const&) = delete;
+
+	class Task : public Poco::Runnable
+	{
+	public:
+		Task(mimiioTaskGroup& group, Poco::Runnable& target, const mimiioThreadSettings& settings) : group_(group), target_(target), settings_(settings){}
+		void run();
+	private:
+		mimiioTaskGroup& group_;
+		Poco::Runnable& target_;
+		const mimiioThreadSettings settings_;
+	};
+
+	void done();
+
+	std::mutex mutex_;
+	std::condition_variable cond_;
+	int running_;
+	std::vector<std::unique_ptr<Task>> tasks_;            // only accessed by the owner thread
+	std::vector<std::unique_ptr<Poco::Thread>> threads_; // dedicated threads, only accessed by the owner thread
+};
+
+}
+
+#endif
@@ -0,0 +1,532 @@
+/**
+ * @file mimiio_coro.hpp
+ * @brief libmimiio C++20 coroutine interface
+ * @ingroup public_header
+ *
+ * Sessions on cooperative connections (see mimi_step()) as awaitables, for servers running many sessions on coroutines.
+ * The session is driven on the thread of the application's event loop, given as mimiio::coro::reactor, so that results are
+ * delivered to the awaiting coroutine without switching threads. Only opening connects in the worker pool of libmimiio.
+ *
+ * Operations are lazy tasks, which start when awaited. A task can be started from outside of a coroutine by spawn(), or
+ * awaited from a coroutine type of the application, as long as it is resumed on the thread of the reactor.
+ *
+ * This header requires C++20 and is empty for earlier versions of C++.
+ *
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_MIMIIO_CORO_HPP__
+#define LIBMIMIIO_MIMIIO_CORO_HPP__
+
+#include "mimiio.h"
+
+#if defined(__cplusplus) && 202002L <= __cplusplus && defined(__has_include)
+#if __has_include(<coroutine>) && __has_include(<span>)
+#define LIBMIMIIO_CORO_AVAILABLE 1
+#endif
+#endif
+
+#ifdef LIBMIMIIO_CORO_AVAILABLE
+
+#include <algorithm>
+#include <coroutine>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mimiio{
+namespace coro{
+
+/**
+ * @class reactor
+ * @brief Event loop of the application, which sessions are driven on
+ *
+ * Callbacks must be run on the thread of the loop, one at a time, and never inside the call registering them.
+ */
+class reactor
+{
+public:
+
+	virtual ~reactor() = default;
+
+	/**
+	 * @brief Run \e callback on the loop
+	 *
+	 * Called from any thread, e.g. the thread of libmimiio which has opened a connection.
+	 *
+	 * @param [in] callback function to run
+	 */
+	virtual void post(std::function<void()> callback) = 0;
+
+	/**
+	 * @brief Run \e callback once on the loop when \e fd becomes readable, or also writable, or \e timeout_ms has passed
+	 *
+	 * Called only on the loop. At most one wait is registered for a session at a time.
+	 *
+	 * @param [in] fd file descriptor, -1 to wait only for the timeout.
+	 * @param [in] writable true to wait also for \e fd to become writable, while a frame is being sent.
+	 * @param [in] timeout_ms timeout in milliseconds, -1 to wait only for \e fd.
+	 * @param [in] callback function to run
+	 */
+	virtual void wait(int fd, bool writable, int timeout_ms, std::function<void()> callback) = 0;
+};
+
+template<class T = void>
+class task;
+
+namespace detail{
+
+struct task_promise_base
+{
+	struct final_awaiter
+	{
+		bool await_ready() const noexcept { return false; }
+
+		template<class Promise>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+		{
+			std::coroutine_handle<> continuation = handle.promise().continuation_;
+			return continuation ? continuation : std::noop_coroutine();
+		}
+
+		void await_resume() const noexcept {}
+	};
+
+	std::suspend_always initial_suspend() const noexcept { return {}; }
+	final_awaiter final_suspend() const noexcept { return {}; }
+	void unhandled_exception() { exception_ = std::current_exception(); }
+
+	std::coroutine_handle<> continuation_; // resumed when the task completes
+	std::exception_ptr exception_;
+};
+
+template<class T>
+struct task_promise : task_promise_base
+{
+	task<T> get_return_object();
+
+	template<class U>
+	void return_value(U&& value) { value_.emplace(std::forward<U>(value)); }
+
+	T result()
+	{
+		if(exception_){
+			std::rethrow_exception(exception_);
+		}
+		return std::move(*value_);
+	}
+
+	std::optional<T> value_;
+};
+
+template<>
+struct task_promise<void> : task_promise_base
+{
+	task<void> get_return_object();
+
+	void return_void() const noexcept {}
+
+	void result()
+	{
+		if(exception_){
+			std::rethrow_exception(exception_);
+		}
+	}
+};
+
+}
+
+/**
+ * @class task
+ * @brief Operation of a session, which starts when it is awaited and resumes the awaiting coroutine when completed
+ */
+template<class T>
+class task
+{
+public:
+
+	typedef detail::task_promise<T> promise_type;
+
+	explicit task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+	task(task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+	task& operator = (task&& other) noexcept
+	{
+		if(this != &other){
+			if(handle_){
+				handle_.destroy();
+			}
+			handle_ = std::exchange(other.handle_, nullptr);
+		}
+		return *this;
+	}
+	~task()
+	{
+		if(handle_){
+			handle_.destroy();
+		}
+	}
+
+	bool await_ready() const noexcept { return false; }
+
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+	{
+		handle_.promise().continuation_ = awaiting;
+		return handle_;
+	}
+
+	T await_resume() { return handle_.promise().result(); }
+
+private:
+
+	task(task const&) = delete;
+	task& operator = (task const&) = delete;
+
+	std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail{
+
+template<class T>
+inline task<T> task_promise<T>::get_return_object()
+{
+	return task<T>(std::coroutine_handle<task_promise<T>>::from_promise(*this));
+}
+
+inline task<void> task_promise<void>::get_return_object()
+{
+	return task<void>(std::coroutine_handle<task_promise<void>>::from_promise(*this));
+}
+
+/**
+ * @brief Coroutine type of spawn(), which runs at once and destroys itself when completed
+ */
+struct detached_task
+{
+	struct promise_type
+	{
+		detached_task get_return_object() const noexcept { return {}; }
+		std::suspend_never initial_suspend() const noexcept { return {}; }
+		std::suspend_never final_suspend() const noexcept { return {}; }
+		void return_void() const noexcept {}
+		void unhandled_exception() const noexcept { std::terminate(); }
+	};
+};
+
+template<class T>
+detached_task detach(task<T> t)
+{
+	co_await std::move(t);
+}
+
+/**
+ * @brief State of a session shared with callbacks registered to the reactor, which do nothing after the session is destroyed.
+ */
+struct session_state : std::enable_shared_from_this<session_state>
+{
+	explicit session_state(reactor& loop) : reactor_(loop) {}
+
+	~session_state()
+	{
+		mimi_open_async_release(request_); // the open callback is not running after this
+		if(mio_ != nullptr){
+			mimi_close(mio_);
+		}
+	}
+
+	static void on_rx(const char* result, size_t len, int*, void* userdata)
+	{
+		static_cast<session_state*>(userdata)->results_.emplace_back(result, len); // called in mimi_step() on the loop
+	}
+
+	static void on_open(MIMI_IO* mio, int errorno, void* userdata)
+	{
+		// called on the thread of libmimiio, the session is alive until mimi_open_async_release() returns
+		session_state* self = static_cast<session_state*>(userdata);
+		std::weak_ptr<session_state> weak = self->weak_from_this();
+		self->reactor_.post([weak, mio, errorno]{
+			std::shared_ptr<session_state> s = weak.lock();
+			if(!s){
+				mimi_close(mio);
+				return;
+			}
+			s->opened(mio, errorno);
+		});
+	}
+
+	void opened(MIMI_IO* mio, int errorno)
+	{
+		mimi_open_async_release(request_);
+		request_ = nullptr;
+		mio_ = mio;
+		errorno_ = errorno;
+		if(mio_ != nullptr){
+			errorno_ = mimi_start(mio_);
+		}
+		std::exchange(opener_, nullptr).resume();
+	}
+
+	/**
+	 * @brief Register a wait for what the next mimi_step() waits for, unless it has been registered.
+	 */
+	void arm()
+	{
+		if(armed_){
+			return;
+		}
+		armed_ = true;
+		std::weak_ptr<session_state> weak = weak_from_this();
+		int fd = -1;
+		bool writable = false;
+		int timeout_ms = -1;
+		mimi_step_poll_ex(mio_, &fd, &writable, &timeout_ms);
+		if(fd == -1 && timeout_ms == -1){
+			reactor_.post([weak]{ if(std::shared_ptr<session_state> s = weak.lock()) s->pump(); }); // inactive, let waiters see it
+		}else{
+			reactor_.wait(fd, writable, timeout_ms, [weak]{ if(std::shared_ptr<session_state> s = weak.lock()) s->pump(); });
+		}
+	}
+
+	/**
+	 * @brief Run a step when the wait has completed. mimi_step() does not block with timeout 0, so the loop is not held.
+	 */
+	void pump()
+	{
+		armed_ = false;
+		mimi_step(mio_, 0);
+		resume();
+	}
+
+	/**
+	 * @brief Run a step at once, e.g. after audio has been written, and let waiters check the result from the loop.
+	 *
+	 * A frame which the socket does not accept at once is left to the next step, see mimi_step().
+	 */
+	void kick()
+	{
+		mimi_step(mio_, 0);
+		if(!waiters_.empty()){
+			std::weak_ptr<session_state> weak = weak_from_this();
+			reactor_.post([weak]{ if(std::shared_ptr<session_state> s = weak.lock()) s->resume(); });
+		}
+	}
+
+	void resume()
+	{
+		std::vector<std::coroutine_handle<>> waiters;
+		waiters.swap(waiters_); // resumed coroutines may wait again
+		for(std::coroutine_handle<> waiter : waiters){
+			waiter.resume();
+		}
+	}
+
+	reactor& reactor_;
+	MIMI_OPEN_REQUEST* request_ = nullptr;
+	MIMI_IO* mio_ = nullptr;
+	int errorno_ = 0;                             // error of opening
+	std::coroutine_handle<> opener_;              // coroutine awaiting open()
+	std::vector<std::coroutine_handle<>> waiters_; // coroutines awaiting the next step
+	bool armed_ = false;                          // a wait is registered to the reactor
+	std::deque<std::string> results_;
+};
+
+/**
+ * @brief Awaitable resuming after the next step of the session
+ */
+struct step_awaiter
+{
+	bool await_ready() const noexcept { return false; }
+
+	void await_suspend(std::coroutine_handle<> awaiting)
+	{
+		state_.waiters_.push_back(awaiting);
+		state_.arm();
+	}
+
+	void await_resume() const noexcept {}
+
+	session_state& state_;
+};
+
+/**
+ * @brief Awaitable of session::open()
+ */
+struct open_awaiter
+{
+	bool await_ready() const noexcept { return false; }
+
+	bool await_suspend(std::coroutine_handle<> awaiting)
+	{
+		int errorno = 0;
+		state_.opener_ = awaiting;
+		state_.request_ = mimi_open_async_ex(&options_, &session_state::on_open, &state_, &errorno);
+		if(state_.request_ == nullptr){
+			state_.opener_ = nullptr;
+			state_.errorno_ = errorno;
+			return false;
+		}
+		return true;
+	}
+
+	int await_resume() const noexcept { return state_.errorno_; }
+
+	session_state& state_;
+	MIMIIO_OPEN_OPTIONS options_;
+};
+
+}
+
+/**
+ * @brief Start a task without awaiting it, e.g. from a callback of the reactor
+ *
+ * The task runs on the calling thread until its first suspension, and its result is dropped when completed.
+ * The process is terminated if it throws an exception.
+ *
+ * @param [in] t task, which is owned until completed.
+ */
+template<class T>
+void spawn(task<T> t)
+{
+	detail::detach(std::move(t));
+}
+
+/**
+ * @class session
+ * @brief A mimi(R) connection of push API driven by a reactor
+ *
+ * Operations must be awaited on the thread of the reactor, and the session must outlive them.
+ * Results are received while next_result() or write() is awaited, so a coroutine should keep awaiting next_result()
+ * while another one writes audio. The connection is closed by mimi_close() when the session is destroyed.
+ */
+class session
+{
+public:
+
+	/**
+	 * @brief C'tor
+	 *
+	 * @param [in] loop event loop driving the session, which must outlive the session.
+	 */
+	explicit session(reactor& loop) : state_(std::make_shared<detail::session_state>(loop)) {}
+
+	/**
+	 * @brief Open the connection and start it
+	 *
+	 * The connection is opened by mimi_open_async_ex() as a cooperative connection of push API. Callbacks, their user data and
+	 * \e cooperative in \e options are ignored. The connection is started by mimi_start() when opened.
+	 *
+	 * @param [in] options options initialized by mimi_open_options_default(), which are copied.
+	 * @return awaitable returning 0 if succeeded, otherwise error code.
+	 */
+	detail::open_awaiter open(const MIMIIO_OPEN_OPTIONS& options)
+	{
+		MIMIIO_OPEN_OPTIONS o = options;
+		o.on_tx_callback = nullptr;
+		o.on_rx_callback = &detail::session_state::on_rx;
+		o.userdata_for_tx = nullptr;
+		o.userdata_for_rx = state_.get();
+		o.cooperative = true;
+		return detail::open_awaiter{*state_, o};
+	}
+
+	/**
+	 * @brief Write audio to be sent, waiting for sending while the buffer is full
+	 *
+	 * @param [in] audio audio data in the format of the options, multiple of the frame size for PCM.
+	 * @param [in] recog_break true if this is the last audio, an empty \e audio can be given.
+	 * @return task returning 0 if succeeded, otherwise error code of mimi_tx_acquire() and mimi_tx_commit(),
+	 * or mimi_error() if the connection has become inactive.
+	 */
+	task<int> write(std::span<const char> audio, bool recog_break = false)
+	{
+		detail::session_state& s = *state_;
+		if(s.mio_ == nullptr){
+			co_return 912;
+		}
+		if(audio.empty() && !recog_break){
+			co_return 0;
+		}
+		for(;;){
+			char* ptr = nullptr;
+			size_t capacity = 0;
+			int errorno = mimi_tx_acquire(s.mio_, &ptr, &capacity);
+			if(errorno == 911){
+				if(!mimi_is_active(s.mio_)){
+					co_return mimi_error(s.mio_) != 0 ? mimi_error(s.mio_) : errorno;
+				}
+				co_await detail::step_awaiter{s}; // the buffer becomes free as audio is sent
+				continue;
+			}
+			if(errorno != 0){
+				co_return errorno;
+			}
+			const size_t len = std::min(capacity, audio.size());
+			std::memcpy(ptr, audio.data(), len);
+			audio = audio.subspan(len);
+			errorno = mimi_tx_commit(s.mio_, len, recog_break && audio.empty());
+			if(errorno != 0){
+				co_return errorno;
+			}
+			if(audio.empty()){
+				break;
+			}
+		}
+		s.kick(); // send at once instead of waiting for the socket
+		co_return 0;
+	}
+
+	/**
+	 * @brief Wait for the next result
+	 *
+	 * @return task returning the result, or std::nullopt if the connection has become inactive without more results,
+	 * in which case error() returns the error code, if any.
+	 */
+	task<std::optional<std::string>> next_result()
+	{
+		detail::session_state& s = *state_;
+		while(s.results_.empty()){
+			if(s.mio_ == nullptr || !mimi_is_active(s.mio_)){
+				co_return std::nullopt;
+			}
+			co_await detail::step_awaiter{s};
+		}
+		std::string result = std::move(s.results_.front());
+		s.results_.pop_front();
+		co_return std::optional<std::string>(std::move(result));
+	}
+
+	/**
+	 * @brief Determine whether the connection is active, see mimi_is_active().
+	 */
+	bool is_active() const { return state_->mio_ != nullptr && mimi_is_active(state_->mio_); }
+
+	/**
+	 * @brief Error code of opening, or the one of the connection returned by mimi_error().
+	 */
+	int error() const { return (state_->errorno_ != 0 || state_->mio_ == nullptr) ? state_->errorno_ : mimi_error(state_->mio_); }
+
+	/**
+	 * @brief mimi connection handler, NULL until opened. It must not be closed by mimi_close().
+	 */
+	MIMI_IO* handle() const { return state_->mio_; }
+
+private:
+
+	session(session const&) = delete;
+	session& operator = (session const&) = delete;
+
+	std::shared_ptr<detail::session_state> state_;
+};
+
+}
+}
+
+#endif
+
+#endif
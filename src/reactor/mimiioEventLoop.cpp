@@ -0,0 +1,315 @@
+/**
+ * @file mimiioEventLoop.cpp
+ * @brief Event loops multiplexing many mimi connections on a few threads
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "reactor/mimiioEventLoop.hpp"
+#include <Poco/Event.h>
+#include <Poco/Environment.h>
+#include <Poco/Exception.h>
+#include <Poco/Format.h>
+#include <algorithm>
+#include <limits>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace mimiio{ namespace reactor{
+
+const uint64_t event_loop_wakeup_token_ = 0; //!< Token of eventfd for wakeup
+
+#ifdef __linux__
+
+mimiioEventLoop::mimiioEventLoop(int index, Poco::Logger& logger) :
+		index_(index),
+		poller_(mimiioPoller::create()),
+		evfd_(-1),
+		nextToken_(event_loop_wakeup_token_ + 1),
+		finish_(false),
+		logger_(logger)
+{
+	evfd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if(evfd_ < 0){
+		throw Poco::SystemException("eventfd failed", errno);
+	}
+	poller_->add(evfd_, event_loop_wakeup_token_, mimiioPoller::EVENT_READ);
+	thread_.setName(Poco::format("mimiio-loop-%d", index_));
+	thread_.start(*this);
+	poco_debug_f2(logger_, "lmio: event loop %d: started with %s.", index_, std::string(poller_->name()));
+}
+
+mimiioEventLoop::~mimiioEventLoop()
+{
+	finish_ = true;
+	wakeup();
+	thread_.join();
+	runTasks(); // release threads waiting in remove()
+	poller_.reset();
+	::close(evfd_);
+}
+
+bool mimiioEventLoop::inLoopThread() const
+{
+	return Poco::Thread::current() == &thread_;
+}
+
+void mimiioEventLoop::wakeup()
+{
+	uint64_t one = 1;
+	ssize_t n = ::write(evfd_, &one, sizeof(one));
+	(void)n; // the counter is already non-zero if it fails with EAGAIN
+}
+
+void mimiioEventLoop::execute(const TASK_T& task)
+{
+	if(inLoopThread()){
+		task();
+		return;
+	}
+	{
+		Poco::FastMutex::ScopedLock lock(mutex_);
+		tasks_.push_back(task);
+	}
+	wakeup();
+}
+
+void mimiioEventLoop::add(mimiioEventHandler* handler, int fd)
+{
+	execute([=]{ doAdd(handler, fd); });
+}
+
+void mimiioEventLoop::unwatch(mimiioEventHandler* handler)
+{
+	execute([=]{ doUnwatch(handler); });
+}
+
+void mimiioEventLoop::watchWritable(mimiioEventHandler* handler, bool enable)
+{
+	execute([=]{ doWatchWritable(handler, enable); });
+}
+
+void mimiioEventLoop::schedule(mimiioEventHandler* handler, long msec)
+{
+	execute([=]{ doSchedule(handler, msec); });
+}
+
+void mimiioEventLoop::remove(mimiioEventHandler* handler)
+{
+	if(inLoopThread() || finish_){
+		doRemove(handler);
+		return;
+	}
+	Poco::Event done;
+	execute([&]{ doRemove(handler); done.set(); });
+	done.wait();
+}
+
+void mimiioEventLoop::doAdd(mimiioEventHandler* handler, int fd)
+{
+	Registration& reg = handlers_[handler];
+	reg.token = nextToken_++;
+	reg.fd = fd;
+	reg.events = 0;
+	reg.hasTimer = false;
+	tokens_[reg.token] = handler;
+	watch(reg, mimiioPoller::EVENT_READ);
+}
+
+void mimiioEventLoop::watch(Registration& reg, int events)
+{
+	if(reg.fd < 0 || events == reg.events){
+		return;
+	}
+	bool done = true;
+	if(reg.events == 0){
+		done = poller_->add(reg.fd, reg.token, events);
+	}else if(events == 0){
+		poller_->remove(reg.fd, reg.token);
+	}else{
+		done = poller_->modify(reg.fd, reg.token, events);
+	}
+	if(done){
+		reg.events = events;
+	}else{
+		logger_.error("lmio: event loop %d: could not watch fd %d (%d).", index_, reg.fd, errno);
+	}
+}
+
+void mimiioEventLoop::doUnwatch(mimiioEventHandler* handler)
+{
+	std::map<mimiioEventHandler*, Registration>::iterator it = handlers_.find(handler);
+	if(it == handlers_.end()){
+		return;
+	}
+	watch(it->second, it->second.events & ~mimiioPoller::EVENT_READ);
+}
+
+void mimiioEventLoop::doWatchWritable(mimiioEventHandler* handler, bool enable)
+{
+	std::map<mimiioEventHandler*, Registration>::iterator it = handlers_.find(handler);
+	if(it == handlers_.end()){
+		return;
+	}
+	int events = it->second.events;
+	if(enable){
+		events |= mimiioPoller::EVENT_WRITE;
+	}else{
+		events &= ~mimiioPoller::EVENT_WRITE;
+	}
+	watch(it->second, events);
+}
+
+void mimiioEventLoop::doSchedule(mimiioEventHandler* handler, long msec)
+{
+	std::map<mimiioEventHandler*, Registration>::iterator it = handlers_.find(handler);
+	if(it == handlers_.end()){
+		return;
+	}
+	if(it->second.hasTimer){
+		timers_.erase(it->second.timer);
+	}
+	Poco::Clock due;
+	it->second.timer = timers_.insert(TIMERS_T::value_type(due.microseconds() + static_cast<Poco::Clock::ClockVal>(std::max(msec, 0L)) * 1000, handler));
+	it->second.hasTimer = true;
+}
+
+void mimiioEventLoop::doRemove(mimiioEventHandler* handler)
+{
+	std::map<mimiioEventHandler*, Registration>::iterator it = handlers_.find(handler);
+	if(it == handlers_.end()){
+		return;
+	}
+	watch(it->second, 0);
+	if(it->second.hasTimer){
+		timers_.erase(it->second.timer);
+	}
+	tokens_.erase(it->second.token);
+	handlers_.erase(it);
+}
+
+void mimiioEventLoop::runTasks()
+{
+	std::vector<TASK_T> tasks;
+	{
+		Poco::FastMutex::ScopedLock lock(mutex_);
+		tasks.swap(tasks_);
+	}
+	for(size_t i=0;i<tasks.size();++i){
+		tasks[i]();
+	}
+}
+
+void mimiioEventLoop::runTimers()
+{
+	Poco::Clock now;
+	while(!timers_.empty() && timers_.begin()->first <= now.microseconds()){
+		mimiioEventHandler* handler = timers_.begin()->second;
+		timers_.erase(timers_.begin());
+		handlers_[handler].hasTimer = false;
+		handler->onTimer(); // may schedule the next timer or remove itself
+	}
+}
+
+int mimiioEventLoop::timeout() const
+{
+	if(timers_.empty()){
+		return -1;
+	}
+	Poco::Clock now;
+	Poco::Clock::ClockVal usec = timers_.begin()->first - now.microseconds();
+	if(usec <= 0){
+		return 0;
+	}
+	return static_cast<int>(std::min<Poco::Clock::ClockVal>((usec + 999) / 1000, std::numeric_limits<int>::max()));
+}
+
+void mimiioEventLoop::run()
+{
+	std::vector<mimiioPoller::Ready> ready;
+	while(!finish_){
+		ready.clear();
+		try{
+			poller_->wait(ready, timeout());
+		}catch(const Poco::Exception &e){
+			logger_.error("lmio: event loop %d: %s", index_, e.displayText());
+		}
+		for(size_t i=0;i<ready.size();++i){
+			if(ready[i].token == event_loop_wakeup_token_){
+				uint64_t counter;
+				ssize_t r = ::read(evfd_, &counter, sizeof(counter));
+				(void)r;
+				continue;
+			}
+			//the handler may have been removed by a preceding handler, or by itself while reading
+			std::map<uint64_t, mimiioEventHandler*>::iterator t = tokens_.find(ready[i].token);
+			if(t == tokens_.end()){
+				continue;
+			}
+			mimiioEventHandler* handler = t->second;
+			if(ready[i].events & handlers_[handler].events & mimiioPoller::EVENT_READ){
+				handler->onReadable();
+			}
+			if(tokens_.count(ready[i].token) != 0 && (ready[i].events & handlers_[handler].events & mimiioPoller::EVENT_WRITE)){
+				handler->onWritable();
+			}
+		}
+		runTasks();
+		runTimers();
+	}
+	poco_debug_f1(logger_, "lmio: event loop %d: finished.", index_);
+}
+
+bool mimiioReactor::supported()
+{
+	return true;
+}
+
+#else // event loops are only for Linux
+
+mimiioEventLoop::mimiioEventLoop(int index, Poco::Logger& logger) :
+		index_(index),
+		evfd_(-1),
+		nextToken_(0),
+		finish_(true),
+		logger_(logger)
+{
+	throw Poco::NotImplementedException("event loop is not supported on this platform");
+}
+
+mimiioEventLoop::~mimiioEventLoop(){}
+bool mimiioEventLoop::inLoopThread() const { return false; }
+void mimiioEventLoop::add(mimiioEventHandler* handler, int fd){}
+void mimiioEventLoop::unwatch(mimiioEventHandler* handler){}
+void mimiioEventLoop::watchWritable(mimiioEventHandler* handler, bool enable){}
+void mimiioEventLoop::schedule(mimiioEventHandler* handler, long msec){}
+void mimiioEventLoop::remove(mimiioEventHandler* handler){}
+void mimiioEventLoop::run(){}
+
+bool mimiioReactor::supported()
+{
+	return false;
+}
+
+#endif
+
+mimiioReactor::mimiioReactor(int threads, Poco::Logger& logger) :
+		next_(0)
+{
+	if(threads <= 0){
+		threads = static_cast<int>(Poco::Environment::processorCount());
+	}
+	for(int i=0;i<threads;++i){
+		loops_.push_back(mimiioEventLoop::Ptr(new mimiioEventLoop(i, logger)));
+	}
+	logger.information("lmio: reactor: %d event loops started.", threads);
+}
+
+mimiioEventLoop& mimiioReactor::next()
+{
+	return *loops_[next_++ % loops_.size()];
+}
+
+}}
@@ -0,0 +1,231 @@
+/**
+ * @file mimiioEventLoop.hpp
+ * @brief Event loops multiplexing many mimi connections on a few threads
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_REACTOR_MIMIIOEVENTLOOP_HPP__
+#define LIBMIMIIO_REACTOR_MIMIIOEVENTLOOP_HPP__
+
+#include <Poco/Runnable.h>
+#include <Poco/Thread.h>
+#include <Poco/Mutex.h>
+#include <Poco/Clock.h>
+#include <Poco/Logger.h>
+#include "reactor/mimiioPoller.hpp"
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace mimiio{ namespace reactor{
+
+/**
+ * @class mimiioEventHandler
+ * @brief Receiver of events from an event loop
+ *
+ * All functions are called on the thread of the event loop which the handler is added to.
+ */
+class mimiioEventHandler
+{
+public:
+
+	virtual ~mimiioEventHandler(){}
+
+	/**
+	 * @brief Called when the watched file descriptor is readable
+	 */
+	virtual void onReadable() = 0;
+
+	/**
+	 * @brief Called when the timer set by mimiioEventLoop::schedule() expires
+	 */
+	virtual void onTimer() = 0;
+
+	/**
+	 * @brief Called when the watched file descriptor is writable, while watched by mimiioEventLoop::watchWritable()
+	 */
+	virtual void onWritable(){}
+};
+
+/**
+ * @class mimiioEventLoop
+ * @brief Single threaded event loop with readiness notification and timers
+ *
+ * The loop waits for readable or writable file descriptors with mimiioPoller and for the earliest timer, and calls handlers.
+ * Requests from other threads are queued and the loop is woken up by eventfd(2).
+ */
+class mimiioEventLoop : public Poco::Runnable
+{
+public:
+
+	typedef std::unique_ptr<mimiioEventLoop> Ptr;
+	typedef std::function<void()> TASK_T;
+
+	/**
+	 * @brief C'tor, start the thread of the loop
+	 *
+	 * @param [in] index index of the loop, used for thread name.
+	 * @param [in] logger logger
+	 * @throws Poco::SystemException if the poller or eventfd could not be created.
+	 */
+	mimiioEventLoop(int index, Poco::Logger& logger);
+
+	/**
+	 * @brief D'tor, stop and join the thread of the loop
+	 */
+	~mimiioEventLoop();
+
+	/**
+	 * @brief Add a handler and watch readability of the file descriptor
+	 *
+	 * @param [in] handler event handler, which must be alive until remove() returns.
+	 * @param [in] fd file descriptor to watch, or -1 for timers only.
+	 */
+	void add(mimiioEventHandler* handler, int fd);
+
+	/**
+	 * @brief Stop watching readability of the file descriptor of the handler, timers and writability are not affected.
+	 *
+	 * @param [in] handler event handler
+	 */
+	void unwatch(mimiioEventHandler* handler);
+
+	/**
+	 * @brief Start or stop watching writability of the file descriptor of the handler
+	 *
+	 * @param [in] handler event handler
+	 * @param [in] enable true to call onWritable() while the file descriptor is writable
+	 */
+	void watchWritable(mimiioEventHandler* handler, bool enable);
+
+	/**
+	 * @brief Set the timer of the handler, replacing the previous one if any.
+	 *
+	 * @param [in] handler event handler
+	 * @param [in] msec milliseconds until onTimer() is called
+	 */
+	void schedule(mimiioEventHandler* handler, long msec);
+
+	/**
+	 * @brief Remove the handler
+	 *
+	 * When this function returns, the handler is not called any more and is not running on the loop.
+	 * If this function is called from another thread, it waits for the handler to return.
+	 *
+	 * @param [in] handler event handler
+	 */
+	void remove(mimiioEventHandler* handler);
+
+	/**
+	 * @brief Determine whether the caller is on the thread of this loop
+	 */
+	bool inLoopThread() const;
+
+	/**
+	 * @brief Run the loop until the loop is destroyed
+	 */
+	void run();
+
+private:
+
+	mimiioEventLoop(mimiioEventLoop const&) = delete;
+	mimiioEventLoop& operator = (mimiioEventLoop const&) = delete;
+
+	typedef std::multimap<Poco::Clock::ClockVal, mimiioEventHandler*> TIMERS_T;
+
+	struct Registration
+	{
+		uint64_t token; // identifies the handler in the poller, never reused
+		int fd;
+		int events; // mimiioPoller::EVENT_READ and/or EVENT_WRITE watched now
+		bool hasTimer;
+		TIMERS_T::iterator timer;
+	};
+
+	/**
+	 * @brief Run \e task on the loop thread, immediately if the caller is on it.
+	 */
+	void execute(const TASK_T& task);
+
+	void wakeup();
+
+	void runTasks();
+
+	void runTimers();
+
+	int timeout() const;
+
+	void doAdd(mimiioEventHandler* handler, int fd);
+
+	void doUnwatch(mimiioEventHandler* handler);
+
+	void doWatchWritable(mimiioEventHandler* handler, bool enable);
+
+	/**
+	 * @brief Change the events watched for the file descriptor, and add it to or remove it from the poller.
+	 */
+	void watch(Registration& reg, int events);
+
+	void doSchedule(mimiioEventHandler* handler, long msec);
+
+	void doRemove(mimiioEventHandler* handler);
+
+	const int index_;
+	mimiioPoller::Ptr poller_;
+	int evfd_;
+	uint64_t nextToken_;
+	std::atomic<bool> finish_;
+	Poco::FastMutex mutex_; // for tasks_
+	std::vector<TASK_T> tasks_;
+	std::map<mimiioEventHandler*, Registration> handlers_; // only accessed on the loop thread
+	std::map<uint64_t, mimiioEventHandler*> tokens_;        // only accessed on the loop thread
+	TIMERS_T timers_;                                      // only accessed on the loop thread
+	Poco::Thread thread_;
+	Poco::Logger& logger_;
+};
+
+/**
+ * @class mimiioReactor
+ * @brief Fixed set of event loops, to which connections are assigned in round robin.
+ */
+class mimiioReactor
+{
+public:
+
+	/**
+	 * @brief C'tor, start event loops
+	 *
+	 * @param [in] threads the number of event loops, the number of CPU cores if 0 or less.
+	 * @param [in] logger logger
+	 */
+	mimiioReactor(int threads, Poco::Logger& logger);
+
+	/**
+	 * @brief Get the next event loop
+	 */
+	mimiioEventLoop& next();
+
+	/**
+	 * @brief Get the number of event loops
+	 */
+	size_t size() const { return loops_.size(); }
+
+	/**
+	 * @brief Determine whether event loops are supported on this platform
+	 */
+	static bool supported();
+
+private:
+
+	mimiioReactor(mimiioReactor const&) = delete;
+	mimiioReactor& operator = (mimiioReactor const&) = delete;
+
+	std::vector<mimiioEventLoop::Ptr> loops_;
+	std::atomic<size_t> next_;
+};
+
+}}
+
+#endif
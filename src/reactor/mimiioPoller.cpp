@@ -0,0 +1,131 @@
+/**
+ * @file mimiioPoller.cpp
+ * @brief Readiness notification for event loops, by epoll(7)
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "reactor/mimiioPoller.hpp"
+#include <Poco/Exception.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace mimiio{ namespace reactor{
+
+#ifdef __linux__
+
+const int poller_max_events_ = 64; //!< The number of events received by one epoll_wait()
+
+namespace {
+
+/**
+ * @brief Events of epoll(7) to watch
+ */
+uint32_t poll_events(int events)
+{
+	uint32_t e = 0;
+	if(events & mimiioPoller::EVENT_READ){
+		e |= EPOLLIN;
+	}
+	if(events & mimiioPoller::EVENT_WRITE){
+		e |= EPOLLOUT;
+	}
+	return e;
+}
+
+/**
+ * @brief Events to report for events of epoll(7)
+ */
+int ready_events(uint32_t revents)
+{
+	int events = 0;
+	if(revents & (EPOLLIN | EPOLLERR | EPOLLHUP)){
+		events |= mimiioPoller::EVENT_READ;
+	}
+	if(revents & (EPOLLOUT | EPOLLERR | EPOLLHUP)){
+		events |= mimiioPoller::EVENT_WRITE;
+	}
+	return events;
+}
+
+/**
+ * @class mimiioEpollPoller
+ * @brief Level-triggered epoll(7)
+ */
+class mimiioEpollPoller : public mimiioPoller
+{
+public:
+
+	mimiioEpollPoller() :
+		epfd_(::epoll_create1(EPOLL_CLOEXEC))
+	{
+		if(epfd_ < 0){
+			throw Poco::SystemException("epoll_create1 failed", errno);
+		}
+	}
+
+	~mimiioEpollPoller()
+	{
+		::close(epfd_);
+	}
+
+	bool add(int fd, uint64_t token, int events)
+	{
+		struct epoll_event ev = {};
+		ev.events = poll_events(events);
+		ev.data.u64 = token;
+		return ::epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) == 0;
+	}
+
+	bool modify(int fd, uint64_t token, int events)
+	{
+		struct epoll_event ev = {};
+		ev.events = poll_events(events);
+		ev.data.u64 = token;
+		return ::epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &ev) == 0;
+	}
+
+	void remove(int fd, uint64_t token)
+	{
+		struct epoll_event ev = {};
+		::epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, &ev);
+	}
+
+	void wait(std::vector<Ready>& ready, int timeout_ms)
+	{
+		struct epoll_event events[poller_max_events_];
+		int n = ::epoll_wait(epfd_, events, poller_max_events_, timeout_ms);
+		if(n < 0 && errno != EINTR){
+			throw Poco::SystemException("epoll_wait failed", errno);
+		}
+		for(int i=0;i<n;++i){
+			Ready r = { events[i].data.u64, ready_events(events[i].events) };
+			ready.push_back(r);
+		}
+	}
+
+	const char* name() const { return "epoll"; }
+
+private:
+	int epfd_;
+};
+
+}
+
+mimiioPoller::Ptr mimiioPoller::create()
+{
+	return Ptr(new mimiioEpollPoller());
+}
+
+#else
+
+mimiioPoller::Ptr mimiioPoller::create()
+{
+	throw Poco::NotImplementedException("event loop is not supported on this platform");
+}
+
+#endif
+
+}}
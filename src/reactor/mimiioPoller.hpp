@@ -0,0 +1,103 @@
+/**
+ * @file mimiioPoller.hpp
+ * @brief Readiness notification for event loops, by epoll(7)
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_REACTOR_MIMIIOPOLLER_HPP__
+#define LIBMIMIIO_REACTOR_MIMIIOPOLLER_HPP__
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace mimiio{ namespace reactor{
+
+/**
+ * @class mimiioPoller
+ * @brief Waits until watched file descriptors become readable or writable
+ *
+ * A poller is used only by the thread of one event loop. Each watched file descriptor is identified by a token given by the caller.
+ */
+class mimiioPoller
+{
+public:
+
+	typedef std::unique_ptr<mimiioPoller> Ptr;
+
+	/**
+	 * @brief Events to watch and to report, combined by bitwise OR
+	 */
+	enum
+	{
+		EVENT_READ = 1,  //!< readable, also reported on errors and hang-up
+		EVENT_WRITE = 2  //!< writable, also reported on errors and hang-up
+	};
+
+	/**
+	 * @brief Events reported for a file descriptor
+	 */
+	struct Ready
+	{
+		uint64_t token;
+		int events;
+	};
+
+	virtual ~mimiioPoller(){}
+
+	/**
+	 * @brief Create a poller
+	 *
+	 * @throws Poco::SystemException if no poller could be created.
+	 */
+	static Ptr create();
+
+	/**
+	 * @brief Start watching the file descriptor
+	 *
+	 * @param [in] fd file descriptor
+	 * @param [in] token token returned by wait() when \e fd is ready
+	 * @param [in] events ::EVENT_READ and/or ::EVENT_WRITE
+	 * @return true if succeeded
+	 */
+	virtual bool add(int fd, uint64_t token, int events) = 0;
+
+	/**
+	 * @brief Change the events watched for the file descriptor
+	 *
+	 * @param [in] fd file descriptor
+	 * @param [in] token token given to add()
+	 * @param [in] events ::EVENT_READ and/or ::EVENT_WRITE, not 0.
+	 * @return true if succeeded
+	 */
+	virtual bool modify(int fd, uint64_t token, int events) = 0;
+
+	/**
+	 * @brief Stop watching the file descriptor
+	 *
+	 * The token may still be returned by the next wait() once.
+	 *
+	 * @param [in] fd file descriptor
+	 * @param [in] token token given to add()
+	 */
+	virtual void remove(int fd, uint64_t token) = 0;
+
+	/**
+	 * @brief Wait for ready file descriptors
+	 *
+	 * Events which are not watched may also be reported.
+	 *
+	 * @param [out] ready tokens and events of ready file descriptors are appended.
+	 * @param [in] timeout_ms timeout in milliseconds, -1 for infinite.
+	 */
+	virtual void wait(std::vector<Ready>& ready, int timeout_ms) = 0;
+
+	/**
+	 * @brief Get the name of the backend
+	 */
+	virtual const char* name() const = 0;
+};
+
+}}
+
+#endif
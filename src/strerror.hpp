@@ -92,6 +92,26 @@ inline const char* strerror(int errorno)
 		  return "received zero length text frame.";
 	  case 907:
 		  return "received zero length binary frame.";
+	  case 908:
+		  return "option can not be changed after mimi_start().";
+	  case 909:
+		  return "mimi_init() must be called before opening connections.";
+	  case 910:
+		  return "invalid or unsupported initialization options.";
+	  case 911:
+		  return "audio buffer is full, audio is not written.";
+	  case 912:
+		  return "audio can not be written, not push API or audio has been ended.";
+	  case 913:
+		  return "audio length is not a multiple of the frame size or exceeds the acquired buffer.";
+	  case 914:
+		  return "rx dispatch queue is full, rxfunc can not keep up with received results.";
+	  case 915:
+		  return "invalid open options.";
+	  case 916:
+		  return "mimi_step() is called for a connection which is not cooperative.";
+	  case 917:
+		  return "the setting is not supported by this connection.";
 	  case 1000: // 1000s' are errors defined in RFC 6455
 		  return "WebSocket connection closed by host, no error, normal close.";
 	  case 1001:
@@ -22,6 +22,8 @@
 namespace mimiio
 {
 	class mimiioController;
+	class mimiioConnectionPool;
+	class mimiioOpenRequest;
 }
 
 /**
@@ -32,6 +34,22 @@ struct mimi_io_s
 	std::unique_ptr<mimiio::mimiioController> mt_;
 };
 
+/**
+ * @brief just encapsulation of mimiioConnectionPool class
+ */
+struct mimi_pool_s
+{
+	std::unique_ptr<mimiio::mimiioConnectionPool> pool_;
+};
+
+/**
+ * @brief just encapsulation of mimiioOpenRequest class
+ */
+struct mimi_open_request_s
+{
+	std::shared_ptr<mimiio::mimiioOpenRequest> request_;
+};
+
 /**
  * @brief On tx callback type definition
  *
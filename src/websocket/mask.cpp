@@ -0,0 +1,133 @@
+/**
+ * @file mask.cpp
+ * @brief WebSocket payload masking (RFC 6455 section 5.3)
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "websocket/mask.hpp"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define MIMIIO_MASK_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MIMIIO_MASK_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace mimiio{ namespace websocket{
+
+namespace {
+
+typedef void (*MASK_FUNC_T)(char*, const char*, size_t, uint32_t);
+
+/**
+ * @brief Mask the tail which is shorter than a vector, key is already rotated to the first byte of \e src.
+ */
+inline void mask_tail(char* dst, const char* src, size_t len, uint32_t key)
+{
+	unsigned char k[4];
+	std::memcpy(k, &key, 4);
+	for(size_t i=0;i<len;++i){
+		dst[i] = src[i] ^ k[i & 3];
+	}
+}
+
+#if !defined(MIMIIO_MASK_X86) && !defined(MIMIIO_MASK_NEON)
+void mask_scalar(char* dst, const char* src, size_t len, uint32_t key)
+{
+	uint64_t k64;
+	std::memcpy(&k64, &key, 4);
+	std::memcpy(reinterpret_cast<char*>(&k64) + 4, &key, 4);
+	size_t i = 0;
+	for(;i+8<=len;i+=8){
+		uint64_t v;
+		std::memcpy(&v, src + i, 8);
+		v ^= k64;
+		std::memcpy(dst + i, &v, 8);
+	}
+	mask_tail(dst + i, src + i, len - i, key);
+}
+#endif
+
+#ifdef MIMIIO_MASK_X86
+void mask_sse2(char* dst, const char* src, size_t len, uint32_t key)
+{
+	const __m128i k = _mm_set1_epi32(static_cast<int>(key));
+	size_t i = 0;
+	for(;i+16<=len;i+=16){
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(v, k));
+	}
+	mask_tail(dst + i, src + i, len - i, key);
+}
+
+__attribute__((target("avx2")))
+void mask_avx2(char* dst, const char* src, size_t len, uint32_t key)
+{
+	const __m256i k = _mm256_set1_epi32(static_cast<int>(key));
+	size_t i = 0;
+	for(;i+32<=len;i+=32){
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_xor_si256(v, k));
+	}
+	mask_tail(dst + i, src + i, len - i, key);
+}
+#endif
+
+#ifdef MIMIIO_MASK_NEON
+void mask_neon(char* dst, const char* src, size_t len, uint32_t key)
+{
+	const uint8x16_t k = vreinterpretq_u8_u32(vdupq_n_u32(key));
+	size_t i = 0;
+	for(;i+16<=len;i+=16){
+		uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(src + i));
+		vst1q_u8(reinterpret_cast<uint8_t*>(dst + i), veorq_u8(v, k));
+	}
+	mask_tail(dst + i, src + i, len - i, key);
+}
+#endif
+
+struct MaskImplementation
+{
+	MASK_FUNC_T func;
+	const char* name;
+};
+
+MaskImplementation select_implementation()
+{
+#ifdef MIMIIO_MASK_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2")){
+		return MaskImplementation{ &mask_avx2, "avx2" };
+	}
+	return MaskImplementation{ &mask_sse2, "sse2" };
+#elif defined(MIMIIO_MASK_NEON)
+	return MaskImplementation{ &mask_neon, "neon" };
+#else
+	return MaskImplementation{ &mask_scalar, "scalar" };
+#endif
+}
+
+const MaskImplementation& implementation()
+{
+	static const MaskImplementation impl = select_implementation();
+	return impl;
+}
+
+}
+
+void mask(char* dst, const char* src, size_t len, const unsigned char key[4])
+{
+	uint32_t k;
+	std::memcpy(&k, key, 4); // byte order in memory is kept by broadcasting
+	implementation().func(dst, src, len, k);
+}
+
+const char* mask_implementation()
+{
+	return implementation().name;
+}
+
+}}
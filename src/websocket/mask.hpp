@@ -0,0 +1,36 @@
+/**
+ * @file mask.hpp
+ * @brief WebSocket payload masking (RFC 6455 section 5.3)
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_WEBSOCKET_MASK_HPP__
+#define LIBMIMIIO_WEBSOCKET_MASK_HPP__
+
+#include <cstddef>
+
+namespace mimiio{ namespace websocket{
+
+/**
+ * @brief XOR payload with masking key
+ *
+ * The implementation is selected at the first call according to the CPU: AVX2 or SSE2 on x86, NEON on ARM,
+ * otherwise word-at-a-time scalar code. Masking and unmasking are the same operation.
+ *
+ * @param [out] dst masked payload, may be the same as \e src
+ * @param [in] src payload
+ * @param [in] len length of payload
+ * @param [in] key 4-byte masking key, applied from its first byte
+ */
+void mask(char* dst, const char* src, size_t len, const unsigned char key[4]);
+
+/**
+ * @brief Get the name of the masking implementation selected for this CPU
+ *
+ * @return "avx2", "sse2", "neon" or "scalar"
+ */
+const char* mask_implementation();
+
+}}
+
+#endif
@@ -0,0 +1,410 @@
+/**
+ * @file mimiioFramer.cpp
+ * @brief WebSocket client framing (RFC 6455 section 5) on an established connection
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "websocket/mimiioFramer.hpp"
+#include "websocket/mask.hpp"
+#include <Poco/Net/WebSocket.h>
+#include <Poco/Net/NetException.h>
+#include <Poco/Exception.h>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <random>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+namespace mimiio{ namespace websocket{
+
+const size_t max_frame_header_size_ = 14;  //!< 2 bytes, 8 bytes of extended payload length and 4 bytes of masking key
+const size_t max_control_payload_size_ = 125; //!< RFC 6455 section 5.5
+const size_t receive_chunk_size_ = 16384;     //!< Bytes read at a time from a non-blocking socket, one TLS record
+
+namespace {
+
+/**
+ * @brief Length of the frame header at \e p, or 0 if \e avail bytes do not contain the whole header.
+ */
+size_t header_size(const unsigned char* p, size_t avail)
+{
+	if(avail < 2){
+		return 0;
+	}
+	size_t hlen = 2;
+	if((p[1] & 0x7f) == 126){
+		hlen += 2;
+	}else if((p[1] & 0x7f) == 127){
+		hlen += 8;
+	}
+	if(p[1] & 0x80){
+		hlen += 4;
+	}
+	return avail < hlen ? 0 : hlen;
+}
+
+/**
+ * @brief Payload length in the frame header at \e p, whose whole header has been received.
+ */
+uint64_t payload_size(const unsigned char* p)
+{
+	uint64_t len = p[1] & 0x7f;
+	if(len == 126 || len == 127){
+		size_t n = (len == 126) ? 2 : 8;
+		len = 0;
+		for(size_t i=0;i<n;++i){
+			len = (len << 8) | p[2 + i];
+		}
+	}
+	return len;
+}
+
+}
+
+mimiioFramer::mimiioFramer(const Poco::Net::StreamSocket& socket, int maxPayloadSize, bool directSend, Poco::Logger& logger) :
+		socket_(socket),
+		maxPayloadSize_(static_cast<uint64_t>(maxPayloadSize)),
+		directSend_(directSend),
+		txhead_(0),
+		rxqueue_(0),
+		rxhead_(0),
+		fragments_(0),
+		fragmentOpcode_(0),
+		seed_(0),
+		logger_(logger)
+{
+	std::random_device rd;
+	while(seed_ == 0){
+		seed_ = rd();
+	}
+	poco_debug_f2(logger_, "mimiio: native WebSocket framing enabled, masking = %s, direct send = %b.", std::string(mask_implementation()), directSend_);
+}
+
+uint32_t mimiioFramer::nextMaskingKey()
+{
+	//xorshift32, called with sendMutex_ locked.
+	seed_ ^= seed_ << 13;
+	seed_ ^= seed_ >> 17;
+	seed_ ^= seed_ << 5;
+	return seed_;
+}
+
+int mimiioFramer::sendSome(const char* data, size_t len)
+{
+	while(true){
+		int n;
+		if(directSend_){
+			//The kernel encrypts the record, OpenSSL keeps no pending data to be sent with kernel TLS.
+			ssize_t r = ::send(static_cast<int>(socket_.impl()->sockfd()), data, len, MSG_NOSIGNAL);
+			if(r < 0){
+				if(errno == EINTR){
+					continue;
+				}else if(errno == EAGAIN || errno == EWOULDBLOCK){
+					return -1;
+				}
+				throw Poco::Net::NetException("Could not send WebSocket frame", errno);
+			}
+			n = static_cast<int>(r);
+		}else{
+			n = socket_.sendBytes(data, static_cast<int>(len));
+			if(n < 0){
+				return -1; // would block, or SSL wants to read or write first
+			}
+		}
+		if(n == 0){
+			throw Poco::Net::NetException("Could not send WebSocket frame");
+		}
+		return n;
+	}
+}
+
+void mimiioFramer::sendAll(const char* data, size_t len)
+{
+	while(len != 0){
+		int n = sendSome(data, len);
+		if(n < 0){
+			throw Poco::TimeoutException("Could not send WebSocket frame"); // send timeout of a blocking socket
+		}
+		data += n;
+		len -= static_cast<size_t>(n);
+	}
+}
+
+bool mimiioFramer::receiveAll(char* data, size_t len)
+{
+	size_t received = 0;
+	while(received < len){
+		int n = socket_.receiveBytes(data + received, static_cast<int>(len - received));
+		if(n <= 0){
+			if(received == 0){
+				return false;
+			}
+			throw Poco::Net::WebSocketException("Incomplete frame received", Poco::Net::WebSocket::WS_ERR_INCOMPLETE_FRAME);
+		}
+		received += static_cast<size_t>(n);
+	}
+	return true;
+}
+
+size_t mimiioFramer::compose(char* out, const char* data, size_t len, int flags)
+{
+	unsigned char* header = reinterpret_cast<unsigned char*>(out);
+	size_t hlen = 0;
+	header[hlen++] = static_cast<unsigned char>(flags & 0xff);
+	if(len < 126){
+		header[hlen++] = static_cast<unsigned char>(0x80 | len);
+	}else if(len <= 0xffff){
+		header[hlen++] = 0x80 | 126;
+		header[hlen++] = static_cast<unsigned char>(len >> 8);
+		header[hlen++] = static_cast<unsigned char>(len);
+	}else{
+		header[hlen++] = 0x80 | 127;
+		for(int shift=56;shift>=0;shift-=8){
+			header[hlen++] = static_cast<unsigned char>(static_cast<uint64_t>(len) >> shift);
+		}
+	}
+	uint32_t key = nextMaskingKey();
+	std::memcpy(header + hlen, &key, 4);
+	unsigned char* maskingKey = header + hlen;
+	hlen += 4;
+	if(len != 0){
+		mask(out + hlen, data, len, maskingKey);
+	}
+	return hlen + len;
+}
+
+int mimiioFramer::sendFrame(const char* data, size_t len, int flags)
+{
+	Poco::FastMutex::ScopedLock lock(sendMutex_);
+	if(!socket_.getBlocking()){
+		//Queued after the pending frames. The queue may be moved by growing while OpenSSL retries a partial record,
+		//which is allowed by SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER, see mimiioSSLContext.
+		if(txhead_ == txqueue_.size()){
+			txqueue_.clear(); // capacity is kept between frames
+			txhead_ = 0;
+			txProgress_.update();
+		}
+		const size_t offset = txqueue_.size();
+		txqueue_.resize(offset + max_frame_header_size_ + len);
+		txqueue_.resize(offset + compose(&txqueue_[offset], data, len, flags));
+		writeQueued();
+		return static_cast<int>(len);
+	}
+	txbuffer_.resize(max_frame_header_size_ + len); // capacity is kept between frames
+	sendAll(&txbuffer_[0], compose(&txbuffer_[0], data, len, flags));
+	return static_cast<int>(len);
+}
+
+bool mimiioFramer::writeQueued()
+{
+	while(txhead_ < txqueue_.size()){
+		int n = sendSome(&txqueue_[txhead_], txqueue_.size() - txhead_);
+		if(n < 0){
+			return false;
+		}
+		txhead_ += static_cast<size_t>(n);
+		txProgress_.update();
+	}
+	return true;
+}
+
+bool mimiioFramer::flush()
+{
+	Poco::FastMutex::ScopedLock lock(sendMutex_);
+	if(writeQueued()){
+		return true;
+	}
+	if(txProgress_.isElapsed(socket_.getSendTimeout().totalMicroseconds())){
+		throw Poco::TimeoutException("Could not send WebSocket frame");
+	}
+	return false;
+}
+
+bool mimiioFramer::sendPending() const
+{
+	Poco::FastMutex::ScopedLock lock(sendMutex_);
+	return txhead_ < txqueue_.size();
+}
+
+bool mimiioFramer::receivePending() const
+{
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(rxqueue_.begin()) + rxhead_;
+	const size_t avail = rxqueue_.size() - rxhead_;
+	const size_t hlen = header_size(p, avail);
+	return hlen != 0 && payload_size(p) <= avail - hlen;
+}
+
+int mimiioFramer::receiveFrame(Poco::Buffer<char>& buffer, int& flags)
+{
+	if(!socket_.getBlocking()){
+		return receiveQueued(buffer, flags);
+	}
+	const size_t base = buffer.size();
+	int opcode = 0; // opcode of the first frame of the message
+	flags = 0;
+	while(true){
+		unsigned char header[2];
+		if(!receiveAll(reinterpret_cast<char*>(header), 2)){
+			flags = 0;
+			return 0; // closed by peer
+		}
+		const bool fin = (header[0] & Poco::Net::WebSocket::FRAME_FLAG_FIN) != 0;
+		const int frameOpcode = header[0] & Poco::Net::WebSocket::FRAME_OP_BITMASK;
+		const bool masked = (header[1] & 0x80) != 0; // server must not mask, but accept it
+		uint64_t len = header[1] & 0x7f;
+		if(len == 126 || len == 127){
+			unsigned char ext[8];
+			size_t n = (len == 126) ? 2 : 8;
+			if(!receiveAll(reinterpret_cast<char*>(ext), n)){
+				throw Poco::Net::WebSocketException("Incomplete frame received", Poco::Net::WebSocket::WS_ERR_INCOMPLETE_FRAME);
+			}
+			len = 0;
+			for(size_t i=0;i<n;++i){
+				len = (len << 8) | ext[i];
+			}
+		}
+		unsigned char maskingKey[4];
+		if(masked && !receiveAll(reinterpret_cast<char*>(maskingKey), 4)){
+			throw Poco::Net::WebSocketException("Incomplete frame received", Poco::Net::WebSocket::WS_ERR_INCOMPLETE_FRAME);
+		}
+
+		if(frameOpcode & 0x08){
+			//control frame, which may be injected in the middle of a fragmented message.
+			if(len > max_control_payload_size_ || !fin){
+				throw Poco::Net::WebSocketException("Invalid control frame received", Poco::Net::WebSocket::WS_ERR_PAYLOAD_TOO_BIG);
+			}
+			char payload[max_control_payload_size_];
+			if(len != 0 && !receiveAll(payload, static_cast<size_t>(len))){
+				throw Poco::Net::WebSocketException("Incomplete frame received", Poco::Net::WebSocket::WS_ERR_INCOMPLETE_FRAME);
+			}
+			if(masked){
+				mask(payload, payload, static_cast<size_t>(len), maskingKey);
+			}
+			if(frameOpcode == Poco::Net::WebSocket::FRAME_OP_PING){
+				poco_debug(logger_, "mimiio: rx(ping)");
+				sendFrame(payload, static_cast<size_t>(len), Poco::Net::WebSocket::FRAME_FLAG_FIN | Poco::Net::WebSocket::FRAME_OP_PONG);
+				poco_debug(logger_, "mimiio: tx(pong)");
+				continue;
+			}else if(frameOpcode == Poco::Net::WebSocket::FRAME_OP_PONG){
+				continue; // unsolicited pong
+			}
+			//close frame, discard incomplete message if any.
+			buffer.resize(base);
+			buffer.append(payload, static_cast<size_t>(len));
+			flags = header[0];
+			return static_cast<int>(len);
+		}
+
+		if(frameOpcode != Poco::Net::WebSocket::FRAME_OP_CONT){
+			opcode = frameOpcode;
+		}
+		if(maxPayloadSize_ < buffer.size() - base + len){
+			throw Poco::Net::WebSocketException("Payload too big", Poco::Net::WebSocket::WS_ERR_PAYLOAD_TOO_BIG);
+		}
+		const size_t offset = buffer.size();
+		buffer.resize(offset + static_cast<size_t>(len));
+		if(len != 0 && !receiveAll(buffer.begin() + offset, static_cast<size_t>(len))){
+			throw Poco::Net::WebSocketException("Incomplete frame received", Poco::Net::WebSocket::WS_ERR_INCOMPLETE_FRAME);
+		}
+		if(masked){
+			mask(buffer.begin() + offset, buffer.begin() + offset, static_cast<size_t>(len), maskingKey);
+		}
+		if(fin){
+			flags = Poco::Net::WebSocket::FRAME_FLAG_FIN | opcode;
+			return static_cast<int>(buffer.size() - base);
+		}
+	}
+}
+
+int mimiioFramer::receiveQueued(Poco::Buffer<char>& buffer, int& flags)
+{
+	flags = 0;
+	while(true){
+		//Frames are taken from the queue only when they have arrived as a whole.
+		unsigned char* p = reinterpret_cast<unsigned char*>(rxqueue_.begin()) + rxhead_;
+		const size_t avail = rxqueue_.size() - rxhead_;
+		size_t need = 2; // bytes of the first frame in the queue needed to go on
+		const size_t hlen = header_size(p, avail);
+		if(hlen != 0){
+			const bool fin = (p[0] & Poco::Net::WebSocket::FRAME_FLAG_FIN) != 0;
+			const int frameOpcode = p[0] & Poco::Net::WebSocket::FRAME_OP_BITMASK;
+			const uint64_t len = payload_size(p);
+			if(frameOpcode & 0x08){
+				if(len > max_control_payload_size_ || !fin){
+					throw Poco::Net::WebSocketException("Invalid control frame received", Poco::Net::WebSocket::WS_ERR_PAYLOAD_TOO_BIG);
+				}
+			}else if(maxPayloadSize_ < fragments_.size() + len){
+				throw Poco::Net::WebSocketException("Payload too big", Poco::Net::WebSocket::WS_ERR_PAYLOAD_TOO_BIG); // before it is buffered
+			}
+			need = hlen + static_cast<size_t>(len);
+			if(need <= avail){
+				char* payload = reinterpret_cast<char*>(p) + hlen;
+				if(p[1] & 0x80){
+					mask(payload, payload, static_cast<size_t>(len), p + hlen - 4);
+				}
+				rxhead_ += need;
+				if(frameOpcode == Poco::Net::WebSocket::FRAME_OP_PING){
+					poco_debug(logger_, "mimiio: rx(ping)");
+					sendFrame(payload, static_cast<size_t>(len), Poco::Net::WebSocket::FRAME_FLAG_FIN | Poco::Net::WebSocket::FRAME_OP_PONG);
+					poco_debug(logger_, "mimiio: tx(pong)");
+					continue;
+				}else if(frameOpcode == Poco::Net::WebSocket::FRAME_OP_PONG){
+					continue; // unsolicited pong
+				}else if(frameOpcode & 0x08){
+					//close frame, discard incomplete message if any.
+					fragments_.resize(0);
+					buffer.append(payload, static_cast<size_t>(len));
+					flags = p[0];
+					return static_cast<int>(len);
+				}
+				if(frameOpcode != Poco::Net::WebSocket::FRAME_OP_CONT){
+					fragmentOpcode_ = frameOpcode;
+				}
+				if(!fin){
+					fragments_.append(payload, static_cast<size_t>(len));
+					continue;
+				}
+				flags = Poco::Net::WebSocket::FRAME_FLAG_FIN | fragmentOpcode_;
+				if(fragments_.size() == 0){
+					buffer.append(payload, static_cast<size_t>(len)); // not fragmented
+					return static_cast<int>(len);
+				}
+				fragments_.append(payload, static_cast<size_t>(len));
+				buffer.append(fragments_.begin(), fragments_.size());
+				const int n = static_cast<int>(fragments_.size());
+				fragments_.resize(0);
+				return n;
+			}
+		}
+
+		//The first frame is incomplete, move it to the front and read more.
+		if(rxhead_ != 0){
+			if(avail != 0){
+				std::memmove(rxqueue_.begin(), rxqueue_.begin() + rxhead_, avail);
+			}
+			rxqueue_.resize(avail);
+			rxhead_ = 0;
+		}
+		const size_t offset = rxqueue_.size();
+		const size_t size = std::max(need, offset + receive_chunk_size_);
+		if(rxqueue_.capacity() < size){
+			rxqueue_.setCapacity(std::max(size, rxqueue_.capacity() * 2)); // kept between frames
+		}
+		rxqueue_.resize(size);
+		int n = socket_.receiveBytes(rxqueue_.begin() + offset, static_cast<int>(rxqueue_.size() - offset));
+		if(n < 0){
+			rxqueue_.resize(offset);
+			return -1; // would block, the partial message is kept
+		}
+		rxqueue_.resize(offset + static_cast<size_t>(n));
+		if(n == 0){
+			if(offset == 0 && fragments_.size() == 0){
+				return 0; // closed by peer
+			}
+			throw Poco::Net::WebSocketException("Incomplete frame received", Poco::Net::WebSocket::WS_ERR_INCOMPLETE_FRAME);
+		}
+	}
+}
+
+}}
@@ -0,0 +1,164 @@
+/**
+ * @file mimiioFramer.hpp
+ * @brief WebSocket client framing (RFC 6455 section 5) on an established connection
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_WEBSOCKET_MIMIIOFRAMER_HPP__
+#define LIBMIMIIO_WEBSOCKET_MIMIIOFRAMER_HPP__
+
+#include <Poco/Net/StreamSocket.h>
+#include <Poco/Buffer.h>
+#include <Poco/Logger.h>
+#include <Poco/Mutex.h>
+#include <Poco/Clock.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace mimiio{ namespace websocket{
+
+/**
+ * @class mimiioFramer
+ * @brief Client side WebSocket framer used instead of Poco::Net::WebSocket after the opening handshake
+ *
+ * Frames are written and read directly on the socket of the connection, which is shared with Poco::Net::WebSocket
+ * so that timeouts, blocking mode and closing are still controlled through it.
+ * The frame header and the masked payload are composed in one buffer reused for every frame, and sent by one call.
+ * Ping and pong frames are handled inside receiveFrame() and never returned to the caller,
+ * and fragmented messages are returned as one message.
+ * If records sent on the socket are encrypted by Linux kernel TLS, frames are written to the file descriptor
+ * directly without passing through OpenSSL.
+ *
+ * If the socket is non-blocking, neither sending nor receiving waits for the socket. Frames to send are queued and
+ * written as far as the socket accepts, and the rest is written by flush() when the socket becomes writable.
+ * Received bytes are kept across calls of receiveFrame() until a whole message has arrived, so that a frame split
+ * by the network is resumed by the next call instead of being reported as incomplete.
+ */
+class mimiioFramer
+{
+public:
+
+	typedef std::unique_ptr<mimiioFramer> Ptr;
+
+	/**
+	 * @brief C'tor
+	 *
+	 * @param [in] socket socket of the WebSocket connection, which has already finished the opening handshake.
+	 * @param [in] maxPayloadSize maximum size of message to receive
+	 * @param [in] directSend true if frames can be written to the file descriptor of \e socket directly, i.e. kernel TLS.
+	 * @param [in] logger logger
+	 */
+	mimiioFramer(const Poco::Net::StreamSocket& socket, int maxPayloadSize, bool directSend, Poco::Logger& logger);
+
+	/**
+	 * @brief Send a frame
+	 *
+	 * This function is thread-safe. If the socket is non-blocking, the frame is queued after the pending frames,
+	 * and the part which the socket does not accept now is left to flush().
+	 *
+	 * @param [in] data payload
+	 * @param [in] len length of payload
+	 * @param [in] flags FIN flag and opcode, same as Poco::Net::WebSocket::sendFrame()
+	 * @return length of payload sent or queued
+	 */
+	int sendFrame(const char* data, size_t len, int flags);
+
+	/**
+	 * @brief Write frames queued on a non-blocking socket without waiting
+	 *
+	 * This function is thread-safe.
+	 *
+	 * @return true if no frame is pending.
+	 * @throws Poco::TimeoutException if no byte has been accepted by the socket for its send timeout.
+	 */
+	bool flush();
+
+	/**
+	 * @brief Determine whether frames queued on a non-blocking socket have not been written yet
+	 */
+	bool sendPending() const;
+
+	/**
+	 * @brief Receive a message
+	 *
+	 * Data frames of the message are appended to \e buffer. Ping frames are answered with pong frames while receiving.
+	 * If the socket is non-blocking, the socket is read until it has no more data, and -1 is returned if the message
+	 * is not complete yet. The partial message is kept for the next call.
+	 *
+	 * @param [in,out] buffer received payload is appended
+	 * @param [out] flags FIN flag and opcode of the message, same as Poco::Net::WebSocket::receiveFrame(),
+	 * or 0 if the connection has been closed by the peer without close frame.
+	 * @return length of received payload, 0 if the connection has been closed, -1 if a non-blocking socket has no whole message.
+	 * @throws Poco::Net::WebSocketException if a frame is incomplete, too large or violates the protocol.
+	 */
+	int receiveFrame(Poco::Buffer<char>& buffer, int& flags);
+
+	/**
+	 * @brief Determine whether a whole frame has been received on a non-blocking socket but not returned yet
+	 *
+	 * Such a frame is not notified by readability of the socket.
+	 */
+	bool receivePending() const;
+
+private:
+
+	mimiioFramer(mimiioFramer const&) = delete;
+	mimiioFramer& operator = (mimiioFramer const&) = delete;
+
+	/**
+	 * @brief Receive exactly \e len bytes
+	 *
+	 * @return false if the connection has been closed before receiving the first byte.
+	 */
+	bool receiveAll(char* data, size_t len);
+
+	void sendAll(const char* data, size_t len);
+
+	/**
+	 * @brief Send as many bytes as the socket accepts by one call
+	 *
+	 * @return the number of bytes sent, or -1 if a non-blocking socket accepts nothing now.
+	 */
+	int sendSome(const char* data, size_t len);
+
+	/**
+	 * @brief Compose a frame into \e out, which has max_frame_header_size_ + \e len bytes, called with sendMutex_ locked.
+	 *
+	 * @return length of the frame
+	 */
+	size_t compose(char* out, const char* data, size_t len, int flags);
+
+	/**
+	 * @brief Write queued frames until the socket accepts no more, called with sendMutex_ locked.
+	 *
+	 * @return true if no frame is pending.
+	 */
+	bool writeQueued();
+
+	/**
+	 * @brief Receive a message on a non-blocking socket, see receiveFrame().
+	 */
+	int receiveQueued(Poco::Buffer<char>& buffer, int& flags);
+
+	uint32_t nextMaskingKey();
+
+	Poco::Net::StreamSocket socket_;
+	const uint64_t maxPayloadSize_;
+	const bool directSend_;
+	mutable Poco::FastMutex sendMutex_;
+	std::vector<char> txbuffer_; // header and masked payload
+	std::vector<char> txqueue_;  // frames not written yet on a non-blocking socket
+	size_t txhead_;              // bytes of txqueue_ already written
+	Poco::Clock txProgress_;     // when the socket has accepted queued bytes last
+	Poco::Buffer<char> rxqueue_; // bytes received on a non-blocking socket, from the first frame not returned yet
+	size_t rxhead_;              // bytes of rxqueue_ already returned
+	Poco::Buffer<char> fragments_; // data frames of a fragmented message received on a non-blocking socket
+	int fragmentOpcode_;         // opcode of the first frame of the message in fragments_
+	uint32_t seed_;
+	Poco::Logger& logger_;
+};
+
+}}
+
+#endif
@@ -0,0 +1,100 @@
+/**
+ * @file mimiioPushSource.cpp
+ * @brief Audio source for push API, mimi_write_audio(), mimi_tx_acquire() and mimi_tx_commit()
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "worker/mimiioPushSource.hpp"
+#include "strerror.hpp"
+
+namespace mimiio{ namespace worker{
+
+const size_t push_chunk_size_ = 32768; //!< maximum size of audio passed to the encoder at once, same as txfunc.
+
+mimiioPushSource::mimiioPushSource(size_t capacity, size_t frameBytes, Poco::Logger& logger) :
+		ring_(capacity, frameBytes),
+		frameBytes_(frameBytes),
+		acquired_(0),
+		ended_(false),
+		notified_(false),
+		logger_(logger)
+{
+	poco_debug_f1(logger_, "lmio: push source: ring buffer %z bytes.", ring_.capacity());
+}
+
+void mimiioPushSource::notify()
+{
+	// Only the first write since the worker has peeked wakes it up, which takes a lock of the event loop or the worker.
+	// The worker sees later writes when it peeks anyway.
+	std::atomic_thread_fence(std::memory_order_seq_cst); // audio is written before checking the flag, see peek()
+	if(listener_ && !notified_.exchange(true)){
+		listener_();
+	}
+}
+
+int mimiioPushSource::write(const char* data, size_t len)
+{
+	if(ended_.load(std::memory_order_relaxed)){
+		return 912;
+	}
+	if(len % frameBytes_ != 0){
+		return 913;
+	}
+	if(!ring_.write(data, len)){
+		poco_debug_f2(logger_, "lmio: push source: %s, %z bytes dropped.", std::string(mimiio::strerror(911)), len);
+		return 911;
+	}
+	acquired_ = 0;
+	notify();
+	return 0;
+}
+
+int mimiioPushSource::acquire(char** data, size_t* capacity)
+{
+	if(ended_.load(std::memory_order_relaxed)){
+		return 912;
+	}
+	*data = ring_.acquire(acquired_);
+	*capacity = acquired_;
+	return acquired_ == 0 ? 911 : 0;
+}
+
+int mimiioPushSource::commit(size_t len, bool recog_break)
+{
+	if(ended_.load(std::memory_order_relaxed)){
+		return 912;
+	}
+	if(acquired_ < len || len % frameBytes_ != 0){
+		return 913;
+	}
+	acquired_ = 0;
+	ring_.commit(len);
+	if(recog_break){
+		return end();
+	}
+	notify();
+	return 0;
+}
+
+int mimiioPushSource::end()
+{
+	if(ended_.exchange(true, std::memory_order_release)){
+		return 912;
+	}
+	notify();
+	return 0;
+}
+
+const char* mimiioPushSource::peek(size_t& len, bool& recog_break) const
+{
+	notified_.store(false);
+	std::atomic_thread_fence(std::memory_order_seq_cst); // audio written after this is notified again
+	// All audio written before end() is visible once ended_ is observed.
+	const bool ended = ended_.load(std::memory_order_acquire);
+	const char* data = ring_.peek(len);
+	len = std::min(len, push_chunk_size_ - push_chunk_size_ % frameBytes_);
+	recog_break = ended && ring_.readable() == len;
+	return data;
+}
+
+}}
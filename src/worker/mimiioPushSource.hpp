@@ -0,0 +1,123 @@
+/**
+ * @file mimiioPushSource.hpp
+ * @brief Audio source for push API, mimi_write_audio(), mimi_tx_acquire() and mimi_tx_commit()
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_WORKER_MIMIIOPUSHSOURCE_HPP__
+#define LIBMIMIIO_WORKER_MIMIIOPUSHSOURCE_HPP__
+
+#include "mimiioRingBuffer.hpp"
+#include <Poco/Logger.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace mimiio{ namespace worker{
+
+/**
+ * @class mimiioPushSource
+ * @brief Audio written by the user thread, read by mimiioTxWorker in place
+ *
+ * Audio data is passed through a bounded lock-free ring buffer, so that the user's capture thread never blocks.
+ * The user either copies audio into the ring buffer by write(), or writes it directly into the ring buffer
+ * between acquire() and commit(). mimiioTxWorker passes the ring buffer to the encoder without copying.
+ * The ring buffer holds whole audio frames only, so that every contiguous region can be encoded as it is.
+ * The listener is called after a write to wake up the worker sleeping because there was no audio, but only for the first
+ * write since the worker has last peeked, so that a burst of small writes takes the lock of the wakeup only once.
+ */
+class mimiioPushSource
+{
+public:
+
+	typedef std::unique_ptr<mimiioPushSource> Ptr;
+	typedef std::function<void()> LISTENER_T;
+
+	/**
+	 * @brief C'tor
+	 *
+	 * @param [in] capacity size of the ring buffer in bytes, rounded up to a multiple of \e frameBytes
+	 * @param [in] frameBytes size of one audio frame, i.e. one sample of all channels, in bytes
+	 * @param [in] logger logger
+	 */
+	mimiioPushSource(size_t capacity, size_t frameBytes, Poco::Logger& logger);
+
+	/**
+	 * @brief Default size of the ring buffer, about 16 seconds of 16kHz monaural PCM.
+	 */
+	static const size_t default_capacity_ = 524288;
+
+	/**
+	 * @brief Set the function called after audio is written or ended, unless it has been called since the last peek()
+	 *
+	 * Must be set before the worker starts.
+	 */
+	void setListener(const LISTENER_T& listener) { listener_ = listener; }
+
+	/**
+	 * @brief Write audio data, called by one user thread
+	 *
+	 * @param [in] data audio data
+	 * @param [in] len length of data, multiple of the frame size
+	 * @return 0 if succeeded, 911 if the buffer does not have enough space, 912 if audio has been ended, 913 if \e len is invalid.
+	 */
+	int write(const char* data, size_t len);
+
+	/**
+	 * @brief Get the writable region of the ring buffer, called by one user thread
+	 *
+	 * @param [out] data start of the region
+	 * @param [out] capacity length of the region, multiple of the frame size
+	 * @return 0 if succeeded, 911 if the buffer is full, 912 if audio has been ended.
+	 */
+	int acquire(char** data, size_t* capacity);
+
+	/**
+	 * @brief Make audio written to the region returned by acquire() available for sending
+	 *
+	 * @param [in] len length of audio written, multiple of the frame size
+	 * @param [in] recog_break end audio after this data, same as end()
+	 * @return 0 if succeeded, 912 if audio has been ended, 913 if \e len exceeds the acquired region or is not a multiple of the frame size.
+	 */
+	int commit(size_t len, bool recog_break);
+
+	/**
+	 * @brief Mark the end of audio, recog-break is sent after the written audio.
+	 *
+	 * @return 0 if succeeded, 912 if audio has been already ended.
+	 */
+	int end();
+
+	/**
+	 * @brief Get audio to be encoded, called by the tx worker.
+	 *
+	 * @param [out] len length of audio, 0 if there is no audio.
+	 * @param [out] recog_break true if the returned audio is the last one.
+	 * @return start of audio in the ring buffer, valid until consume().
+	 */
+	const char* peek(size_t& len, bool& recog_break) const;
+
+	/**
+	 * @brief Release audio returned by peek() after encoding, called by the tx worker.
+	 */
+	void consume(size_t len) { ring_.consume(len); }
+
+private:
+
+	mimiioPushSource(mimiioPushSource const&) = delete;
+	mimiioPushSource& operator = (mimiioPushSource const&) = delete;
+
+	void notify();
+
+	mimiioRingBuffer ring_;
+	const size_t frameBytes_;
+	size_t acquired_; // length returned by the last acquire()
+	std::atomic<bool> ended_;
+	mutable std::atomic<bool> notified_; // listener_ has been called since the last peek()
+	LISTENER_T listener_;
+	Poco::Logger& logger_;
+};
+
+}}
+
+#endif
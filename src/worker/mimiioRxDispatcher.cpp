@@ -0,0 +1,161 @@
+/**
+ * @file mimiioRxDispatcher.cpp
+ * @brief Delivery of received results to rxfunc on a thread of the worker pool
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "worker/mimiioRxDispatcher.hpp"
+#include <algorithm>
+
+namespace mimiio{ namespace worker{
+
+mimiioRxDispatcher::mimiioRxDispatcher(ON_RX_CALLBACK_T func, void* userdata, size_t capacity, MIMIIO_RX_OVERFLOW_POLICY policy, mimiioNotifier& notifier, Poco::Logger& logger) :
+		func_(func),
+		userdata_(userdata),
+		policy_(policy),
+		notifier_(notifier),
+		slots_(std::max<size_t>(capacity, 1)),
+		head_(0),
+		depth_(0),
+		started_(false),
+		closed_(false),
+		aborted_(false),
+		peak_depth_(0),
+		delivered_(0),
+		dropped_(0),
+		errorno_(0),
+		finished_(false),
+		logger_(logger)
+{
+	poco_debug_f2(logger_, "lmio: rxDispatcher: queue length %z, overflow policy %d.", slots_.size(), static_cast<int>(policy_));
+}
+
+mimiioRxDispatcher::~mimiioRxDispatcher()
+{
+}
+
+void mimiioRxDispatcher::start(mimiioTaskGroup& tasks, Poco::ThreadPool& pool)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		started_ = true;
+	}
+	try{
+		tasks.start(pool, *this);
+	}catch(...){
+		std::lock_guard<std::mutex> lock(mutex_);
+		started_ = false;
+		throw;
+	}
+}
+
+void mimiioRxDispatcher::notify()
+{
+	if(listener_){
+		listener_();
+	}
+}
+
+int mimiioRxDispatcher::post(const char* data, size_t len)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	if(depth_ == slots_.size()){
+		switch(policy_){
+		case MIMIIO_RX_OVERFLOW_BLOCK:
+			cond_.wait(lock, [this]{ return depth_ < slots_.size() || aborted_; });
+			break;
+		case MIMIIO_RX_OVERFLOW_DROP_OLDEST:
+			head_ = (head_ + 1) % slots_.size();
+			--depth_;
+			++dropped_;
+			break;
+		case MIMIIO_RX_OVERFLOW_DROP_NEWEST:
+			++dropped_;
+			return 0;
+		default:
+			++dropped_;
+			return 914;
+		}
+	}
+	if(aborted_ || closed_){
+		return 0;
+	}
+	slots_[(head_ + depth_) % slots_.size()].assign(data, len); // reuses memory of the slot
+	++depth_;
+	peak_depth_ = std::max(peak_depth_, depth_);
+	cond_.notify_all();
+	return 0;
+}
+
+void mimiioRxDispatcher::close()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	closed_ = true;
+	if(!started_){
+		finished_ = true; // run() will never be called, nothing to deliver
+	}
+	cond_.notify_all();
+}
+
+void mimiioRxDispatcher::abort()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	aborted_ = true;
+	if(!started_){
+		finished_ = true; // run() will never be called
+	}
+	cond_.notify_all();
+}
+
+void mimiioRxDispatcher::detach()
+{
+	abort();
+	gate_.close();
+}
+
+void mimiioRxDispatcher::stats(MIMIIO_RX_DISPATCH_STATS& stats)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	stats.depth = depth_;
+	stats.peak_depth = peak_depth_;
+	stats.delivered = delivered_;
+	stats.dropped = dropped_;
+}
+
+void mimiioRxDispatcher::run()
+{
+	std::string result; // swapped with a slot, so that memory of both is reused
+	while(true){
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			cond_.wait(lock, [this]{ return depth_ != 0 || closed_ || aborted_; });
+			if(aborted_ || depth_ == 0){
+				break;
+			}
+			result.swap(slots_[head_]);
+			head_ = (head_ + 1) % slots_.size();
+			--depth_;
+			cond_.notify_all(); // for post() waiting for space
+		}
+		int rxfunc_error = 0;
+		if(!gate_.call([&]{ func_(result.c_str(), result.size(), &rxfunc_error, userdata_); })){
+			break; // detached
+		}
+		if(rxfunc_error != 0){
+			errorno_ = rxfunc_error;
+			logger_.fatal("lmio: rxDispatcher: User defined error occurred in mimi_rxfunc callback (%d)", errorno_.load());
+			abort();
+			break;
+		}
+		notifier_.signal(); // the result has been handed to the user
+		std::lock_guard<std::mutex> lock(mutex_);
+		++delivered_;
+	}
+	MIMIIO_RX_DISPATCH_STATS last;
+	stats(last);
+	poco_debug_f2(logger_, "lmio: rxDispatcher: finished, %lu results delivered, %lu dropped.", last.delivered, last.dropped);
+	finished_ = true;
+	notify();
+}
+
+}}
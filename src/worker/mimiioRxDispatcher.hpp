@@ -0,0 +1,156 @@
+/**
+ * @file mimiioRxDispatcher.hpp
+ * @brief Delivery of received results to rxfunc on a thread of the worker pool
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_WORKER_MIMIIORXDISPATCHER_HPP__
+#define LIBMIMIIO_WORKER_MIMIIORXDISPATCHER_HPP__
+
+#include "mimiio.h"
+#include "typedef.hpp"
+#include "mimiioCallbackGate.hpp"
+#include "mimiioNotifier.hpp"
+#include "mimiioTaskGroup.hpp"
+#include <Poco/Runnable.h>
+#include <Poco/ThreadPool.h>
+#include <Poco/Logger.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mimiio{ namespace worker{
+
+/**
+ * @class mimiioRxDispatcher
+ * @brief Bounded queue of received results and the task calling rxfunc
+ *
+ * mimiioRxWorker posts each received frame to the queue instead of calling rxfunc, so that reading the socket,
+ * answering pings and detecting close frames never wait for the user's callback.
+ * When the queue is full, the frame is handled according to ::MIMIIO_RX_OVERFLOW_POLICY.
+ * Slots of the queue keep their memory, so no allocation is needed once the slots have grown to the size of results.
+ * run() is a task of the connection on the process-wide worker pool, like the rx and tx workers.
+ */
+class mimiioRxDispatcher : public Poco::Runnable
+{
+public:
+
+	typedef std::unique_ptr<mimiioRxDispatcher> Ptr;
+	typedef std::function<void()> LISTENER_T;
+
+	/**
+	 * @brief C'tor
+	 *
+	 * @param [in] func rxfunc
+	 * @param [in] userdata User defined data for rxfunc
+	 * @param [in] capacity the maximum number of queued results, at least 1.
+	 * @param [in] policy behavior when the queue is full
+	 * @param [in] notifier signaled each time a result has been delivered
+	 * @param [in] logger logger
+	 */
+	mimiioRxDispatcher(ON_RX_CALLBACK_T func, void* userdata, size_t capacity, MIMIIO_RX_OVERFLOW_POLICY policy, mimiioNotifier& notifier, Poco::Logger& logger);
+
+	/**
+	 * @brief D'tor, the task group which has started run() must have been joined.
+	 */
+	~mimiioRxDispatcher();
+
+	/**
+	 * @brief Set the function called when the dispatcher has finished, or rxfunc has failed
+	 *
+	 * Called on the thread running run(). Must be set before start().
+	 */
+	void setListener(const LISTENER_T& listener) { listener_ = listener; }
+
+	/**
+	 * @brief Start run() as a task of \e tasks on \e pool
+	 *
+	 * If this function is not called, the dispatcher is regarded as finished by close() or abort().
+	 *
+	 * @param [in] tasks task group of the connection, joined before the dispatcher is destroyed.
+	 * @param [in] pool process-wide worker pool
+	 */
+	void start(mimiioTaskGroup& tasks, Poco::ThreadPool& pool);
+
+	/**
+	 * @brief Queue a received result, called by the rx worker
+	 *
+	 * @param [in] data received result
+	 * @param [in] len length of result
+	 * @return 0 if queued or dropped according to the policy, 914 if the queue is full with ::MIMIIO_RX_OVERFLOW_DISCONNECT.
+	 */
+	int post(const char* data, size_t len);
+
+	/**
+	 * @brief No more results are posted, the thread finishes after delivering queued results.
+	 */
+	void close();
+
+	/**
+	 * @brief Drop queued results and stop run(), the running rxfunc is not interrupted.
+	 */
+	void abort();
+
+	/**
+	 * @brief abort() and wait for rxfunc running now, if any, so that rxfunc is never called after this function returns.
+	 */
+	void detach();
+
+	/**
+	 * @brief Determine whether all results have been delivered, or delivery has been stopped.
+	 */
+	bool finished() const { return finished_; }
+
+	/**
+	 * @brief Get the error set by rxfunc, 0 if none.
+	 */
+	int errorno() const { return errorno_; }
+
+	/**
+	 * @brief Get queue statistics
+	 *
+	 * @param [out] stats statistics
+	 */
+	void stats(MIMIIO_RX_DISPATCH_STATS& stats);
+
+	/**
+	 * @brief Deliver queued results to rxfunc until close() or abort()
+	 */
+	void run();
+
+private:
+
+	mimiioRxDispatcher(mimiioRxDispatcher const&) = delete;
+	mimiioRxDispatcher& operator = (mimiioRxDispatcher const&) = delete;
+
+	void notify();
+
+	ON_RX_CALLBACK_T func_;
+	void* userdata_;
+	const MIMIIO_RX_OVERFLOW_POLICY policy_;
+	mimiioCallbackGate gate_; // for func_
+	mimiioNotifier& notifier_;
+	std::mutex mutex_; // for following members until the statistics
+	std::condition_variable cond_;
+	std::vector<std::string> slots_; // ring of queued results
+	size_t head_;
+	size_t depth_;
+	bool started_;
+	bool closed_;
+	bool aborted_;
+	size_t peak_depth_;
+	unsigned long delivered_;
+	unsigned long dropped_;
+	std::atomic<int> errorno_;
+	std::atomic<bool> finished_;
+	LISTENER_T listener_;
+	Poco::Logger& logger_;
+};
+
+}}
+
+#endif
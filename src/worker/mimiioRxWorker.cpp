@@ -16,13 +16,16 @@
 
 namespace mimiio{ namespace worker{
 
-mimiioRxWorker::mimiioRxWorker(const mimiioImpl::Ptr& impl, ON_RX_CALLBACK_T func, void* userdata, Poco::Logger& logger) :
+mimiioRxWorker::mimiioRxWorker(const mimiioImpl::Ptr& impl, ON_RX_CALLBACK_T func, void* userdata, mimiioNotifier& notifier, Poco::Logger& logger) :
 		impl_(impl),
 		func_(func),
 		userdata_(userdata),
+		dispatcher_(nullptr),
+		notifier_(notifier),
 		errorno_(0),
 		finish_(false),
 		finished_(false),
+		drained_(false),
 		logger_(logger)
 {
 	poco_debug(logger_, "lmio: rxWorker: initialized.");
@@ -38,107 +41,169 @@ void mimiioRxWorker::finish()
 	finish_ = true;
 }
 
+void mimiioRxWorker::detach()
+{
+	if(dispatcher_ != nullptr){
+		dispatcher_->detach();
+	}
+	gate_.close();
+}
+
 bool mimiioRxWorker::finished() const
 {
-	return finished_;
+	return finished_ && (dispatcher_ == nullptr || dispatcher_->finished());
 }
 
 int mimiioRxWorker::errorno() const
 {
+	if(errorno_ == 0 && dispatcher_ != nullptr){
+		return dispatcher_->errorno();
+	}
 	return errorno_;
 }
 
 void mimiioRxWorker::run()
 {
-	while(!finish_){
-	    std::vector<char> buffer;
+	long wait_msec = 0;
+	while((wait_msec = step()) >= 0){
+		if(wait_msec > 0){
+			Poco::Thread::sleep(wait_msec);
+		}
+	}
+}
+
+long mimiioRxWorker::stop()
+{
+	if(!finished_){
+		logger_.information("lmio: rxWorker: rx loop finished with code %d",errorno_.load());
+		if(dispatcher_ != nullptr){
+			dispatcher_->close(); // the dispatcher notifies when queued results have been delivered
+		}
+		finished_ = true;
+		notifier_.notify();
+	}
+	return -1;
+}
+
+int mimiioRxWorker::deliver(const char* data, size_t len)
+{
+	if(dispatcher_ != nullptr){
+		return dispatcher_->post(data, len);
+	}
+	int rxfunc_error = 0;
+	if(gate_.call([&]{ func_(data, len, &rxfunc_error, userdata_); })){ // dropped after mimi_close()
+		notifier_.signal(); // the result has been handed to the user
+	}
+	return rxfunc_error;
+}
+
+long mimiioRxWorker::step()
+{
+	drained_ = false;
+	if(finish_ || finished_){
+		return stop();
+	}
+	try{
+		if(impl_->closed()){
+			return stop(); //break rx loop
+		}
+
+		short closeStatus = 0;
+		mimiioImpl::OPF_TYPE opc;
+		const char* data = nullptr; // null terminated, owned by impl_
+		int n = 0;
 		try{
-			if(impl_->closed()){
-				break; //break rx loop
+			n = impl_->receive_frame(data, opc, closeStatus);	//Note that this function is Blocking I/O
+		}catch(...){
+			if(finish_){
+				poco_debug(logger_, "lmio: rxWorker: receiving interrupted by closing.");
+				return stop(); // the socket has been shut down by mimiioController::linger()
 			}
+			throw;
+		}
 
-			short closeStatus = 0;
-			mimiioImpl::OPF_TYPE opc;
-			int n = impl_->receive_frame(buffer, opc, closeStatus);	//Note that this function is Blocking I/O
-
-			if(opc == mimiioImpl::PING_FRAME){
-				continue;
-			}else if(opc == mimiioImpl::CLOSE_FRAME){
-				if(n == 0){
-					errorno_ = 904;
-					logger_.warning("lmio: rxWorker(n=0): %s (%d)", std::string(mimiio::strerror(errorno_)), errorno_);
-					break; //break rx loop
+		if(n < 0){
+			drained_ = true; // the partial message is kept by the framer until the socket becomes readable
+			return 0;
+		}else if(opc == mimiioImpl::PING_FRAME){
+			return 0;
+		}else if(opc == mimiioImpl::CLOSE_FRAME){
+			if(n == 0){
+				errorno_ = 904;
+				logger_.warning("lmio: rxWorker(n=0): %s (%d)", std::string(mimiio::strerror(errorno_.load())), errorno_.load());
+				return stop(); //break rx loop
+			}else{
+				if(closeStatus == 1000){
+					poco_debug(logger_, "lmio: rxWorker: Close frame received by remote host with code 1000, finish rxWorker normally.");
+					return stop(); //break rx loop
 				}else{
-					if(closeStatus == 1000){
-						poco_debug(logger_, "lmio: rxWorker: Close frame received by remote host with code 1000, finish rxWorker normally.");
-						break; //break rx loop
-					}else{
-						//pass through server side's error code.
-						errorno_ = static_cast<int>(closeStatus);
-						logger_.warning("lmio: rxWorker(n!=0): %s (%d), terminate rxWorker.", std::string(mimiio::strerror(errorno_)), errorno_);
-						break; //break rx loop
-					}
+					//pass through server side's error code.
+					errorno_ = static_cast<int>(closeStatus);
+					logger_.warning("lmio: rxWorker(n!=0): %s (%d), terminate rxWorker.", std::string(mimiio::strerror(errorno_.load())), errorno_.load());
+					return stop(); //break rx loop
 				}
 			}
+		}
 
-			//receive callback (only for text or binary frame)
-			int rxfunc_error = 0;
-			if(opc == mimiioImpl::TEXT_FRAME){
-				if(n == 0){
-					errorno_ = 906;
-					logger_.warning("lmio: rxWorker: %s (%d)", std::string(mimiio::strerror(errorno_)), errorno_);
-					break; //break rx loop
-				}else{
-					std::string s(buffer.begin(), buffer.end()); //for null termination
-					func_(s.c_str(), buffer.size(), &rxfunc_error, userdata_);
-				}
+		//receive callback (only for text or binary frame)
+		int rxfunc_error = 0;
+		if(opc == mimiioImpl::TEXT_FRAME){
+			if(n == 0){
+				errorno_ = 906;
+				logger_.warning("lmio: rxWorker: %s (%d)", std::string(mimiio::strerror(errorno_.load())), errorno_.load());
+				return stop(); //break rx loop
 			}else{
-				if(n == 0){
-					errorno_ = 907;
-					logger_.warning("lmio: rxWorker: %s (%d)", std::string(mimiio::strerror(errorno_)), errorno_);
-					break; //break rx loop
-				}else{
-					func_(&buffer[0], buffer.size(), &rxfunc_error, userdata_);
-				}
+				rxfunc_error = deliver(data, static_cast<size_t>(n));
 			}
-			if(rxfunc_error != 0){
-				errorno_ = rxfunc_error;
-				logger_.fatal("lmio: rxWorker: User defined error occurred in mimi_rxfunc callback (%d)", errorno_);
-				break; //break tx loop
+		}else{
+			if(n == 0){
+				errorno_ = 907;
+				logger_.warning("lmio: rxWorker: %s (%d)", std::string(mimiio::strerror(errorno_.load())), errorno_.load());
+				return stop(); //break rx loop
+			}else{
+				rxfunc_error = deliver(data, static_cast<size_t>(n));
 			}
-			Poco::Thread::sleep(1); // avoid busy loop, even if Poco's receive_frame() is set non-blocking mode.
-		}catch(const Poco::Net::WebSocketException &e){
-			errorno_ = 800 + static_cast<int>(e.code());
-			logger_.fatal("lmio: rxWorker: WebSocket exception: %s (%d)", std::string(mimiio::strerror(errorno_)), errorno_);
-			break;
-		}catch(const Poco::TimeoutException &e){
-			errorno_ = 830; // timeout
-			logger_.fatal("lmio: rxWorker: Timeout exception: %s (%d)", std::string(mimiio::strerror(errorno_)), errorno_);
-			break;
-		}catch(const Poco::Net::NetException &e){
-			errorno_ = 790; // network error
-			logger_.error("lmio: rxWorker: Network exception: %s (%d)", e.displayText(), errorno_);
-			break;
-		}catch(const UnknownFrameReceived &e){
-			errorno_ = 890; // unknown flag received
-			logger_.fatal("lmio: rxWorker: WebSocket exception: %s (%d), terminate rxWorker.", std::string(mimiio::strerror(errorno_)), errorno_);
-			break;
-		}catch(const UnexpectedNetworkDisconnection &e){
-			errorno_ = 791; // unexpected network disconnection
-			logger_.fatal("lmio: rxWorker: Network exception: %s (%d), terminate rxWorker.", std::string(mimiio::strerror(errorno_)), errorno_);
-			break;
-		}catch(const std::exception &e){
-			errorno_ = 799; // undefined network error
-			logger_.fatal("lmio: rxWorker: Unknown error, std exception: %s, terminate rxWorker.", std::string(e.what()));
-			break;
-		}catch(...){
-			errorno_ = 799; // undefined network error
-			logger_.fatal("lmio: rxWorker: Unknown error, terminate rxWorker.");
-			break;
 		}
-	}//while
-	logger_.information("lmio: rxWorker: rx loop finished with code %d",errorno_);
-	finished_ = true;
+		if(rxfunc_error != 0){
+			errorno_ = rxfunc_error;
+			if(dispatcher_ != nullptr){
+				logger_.fatal("lmio: rxWorker: %s (%d)", std::string(mimiio::strerror(errorno_.load())), errorno_.load());
+			}else{
+				logger_.fatal("lmio: rxWorker: User defined error occurred in mimi_rxfunc callback (%d)", errorno_.load());
+			}
+			return stop(); //break tx loop
+		}
+		return 1; // avoid busy loop, even if Poco's receive_frame() is set non-blocking mode.
+	}catch(const Poco::Net::WebSocketException &e){
+		errorno_ = 800 + static_cast<int>(e.code());
+		logger_.fatal("lmio: rxWorker: WebSocket exception: %s (%d)", std::string(mimiio::strerror(errorno_.load())), errorno_.load());
+		return stop();
+	}catch(const Poco::TimeoutException &e){
+		errorno_ = 830; // timeout
+		logger_.fatal("lmio: rxWorker: Timeout exception: %s (%d)", std::string(mimiio::strerror(errorno_.load())), errorno_.load());
+		return stop();
+	}catch(const Poco::Net::NetException &e){
+		errorno_ = 790; // network error
+		logger_.error("lmio: rxWorker: Network exception: %s (%d)", e.displayText(), errorno_.load());
+		return stop();
+	}catch(const UnknownFrameReceived &e){
+		errorno_ = 890; // unknown flag received
+		logger_.fatal("lmio: rxWorker: WebSocket exception: %s (%d), terminate rxWorker.", std::string(mimiio::strerror(errorno_.load())), errorno_.load());
+		return stop();
+	}catch(const UnexpectedNetworkDisconnection &e){
+		errorno_ = 791; // unexpected network disconnection
+		logger_.fatal("lmio: rxWorker: Network exception: %s (%d), terminate rxWorker.", std::string(mimiio::strerror(errorno_.load())), errorno_.load());
+		return stop();
+	}catch(const std::exception &e){
+		errorno_ = 799; // undefined network error
+		logger_.fatal("lmio: rxWorker: Unknown error, std exception: %s, terminate rxWorker.", std::string(e.what()));
+		return stop();
+	}catch(...){
+		errorno_ = 799; // undefined network error
+		logger_.fatal("lmio: rxWorker: Unknown error, terminate rxWorker.");
+		return stop();
+	}
+	return 0;
 }
 
 }}
@@ -9,7 +9,11 @@
 #define LIBMIMIIO_MIMIIOIMPLRXWORKER_HPP__
 
 #include "typedef.hpp"
+#include "mimiioNotifier.hpp"
+#include "mimiioCallbackGate.hpp"
+#include "worker/mimiioRxDispatcher.hpp"
 #include <Poco/Runnable.h>
+#include <atomic>
 #include <memory>
 
 /**
@@ -32,9 +36,12 @@ public:
 	 * @brief C'tor
 	 *
 	 * @param [in] impl mimiioImpl class, mimi(R) API implementation encapsulated.
+	 * @param [in] func rxfunc
+	 * @param [in] userdata User defined data for rxfunc
+	 * @param [in] notifier notified when the loop has finished
 	 * @param [in] logger logger
 	 */
-	mimiioRxWorker(const mimiioImpl::Ptr& impl, ON_RX_CALLBACK_T func, void* userdata, Poco::Logger& logger);
+	mimiioRxWorker(const mimiioImpl::Ptr& impl, ON_RX_CALLBACK_T func, void* userdata, mimiioNotifier& notifier, Poco::Logger& logger);
 
 	/**
 	 * @brief D'tor
@@ -51,12 +58,30 @@ public:
 	/**
 	 * @brief Get finish flag, that is indicated response receiving loop is whether finished or not.
 	 *
+	 * With a dispatcher, the loop is regarded as finished after the dispatcher has delivered all results.
+	 *
 	 * @return true if response receiving loop is finished, otherwise false.
 	 */
 	bool finished() const;
 
 	/**
-	 * @brief Get errorno in this class
+	 * @brief Stop calling rxfunc, received results are dropped.
+	 *
+	 * Waits for rxfunc running now, if any. The loop keeps running to receive the close frame of the remote host.
+	 */
+	void detach();
+
+	/**
+	 * @brief Post received results to the dispatcher instead of calling rxfunc
+	 *
+	 * This function must be called before run().
+	 *
+	 * @param [in] dispatcher dispatcher, which must be alive while the loop is running.
+	 */
+	void setDispatcher(mimiioRxDispatcher* dispatcher) { dispatcher_ = dispatcher; }
+
+	/**
+	 * @brief Get errorno in this class, including the error of rxfunc called by the dispatcher
 	 *
 	 * @return error number
 	 */
@@ -65,18 +90,54 @@ public:
 	/**
 	 * @brief Start response receiving loop
 	 *
-	 * This loop is break when finish() is called.
+	 * This loop calls step() repeatedly, and is break when finish() is called.
 	 */
 	void run();
 
+	/**
+	 * @brief Run one iteration of response receiving loop
+	 *
+	 * Receives one frame and calls rxfunc. On a blocking socket it blocks until a frame is received, so event loops
+	 * should call it only when the socket is readable. On a non-blocking socket with the built-in framer it returns
+	 * without a frame when the socket has no more data, see drained().
+	 *
+	 * @return milliseconds to wait before the next call, 0 to call again immediately, or -1 if the loop has finished.
+	 */
+	long step();
+
+	/**
+	 * @brief Determine whether the last step() has read the non-blocking socket until it had no more data, without a whole message
+	 *
+	 * The rest of the message is received by the next step() after the socket becomes readable.
+	 */
+	bool drained() const { return drained_; }
+
 private:
 
+	/**
+	 * @brief Mark the loop as finished
+	 *
+	 * @return -1
+	 */
+	long stop();
+
+	/**
+	 * @brief Call rxfunc, or post the result to the dispatcher
+	 *
+	 * @return error number
+	 */
+	int deliver(const char* data, size_t len);
+
 	const mimiioImpl::Ptr& impl_;
 	ON_RX_CALLBACK_T func_;
 	void* userdata_;
-	int errorno_;
-	bool finish_;
-	bool finished_;
+	mimiioRxDispatcher* dispatcher_;
+	mimiioNotifier& notifier_;
+	mimiioCallbackGate gate_; // for func_
+	std::atomic<int> errorno_;
+	std::atomic<bool> finish_;
+	std::atomic<bool> finished_;
+	bool drained_; // only accessed by the thread calling step()
 	Poco::Logger& logger_;
 };
 
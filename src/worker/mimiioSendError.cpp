@@ -0,0 +1,39 @@
+/**
+ * @file mimiioSendError.cpp
+ * @brief Error number of an exception thrown while encoding or sending audio
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "strerror.hpp"
+#include "worker/mimiioSendError.hpp"
+#include <Poco/Exception.h>
+#include <Poco/Net/NetException.h>
+#include <exception>
+
+namespace mimiio{ namespace worker{
+
+int send_errorno(const std::string& name, Poco::Logger& logger)
+{
+	int errorno = 799; // undefined network error
+	try{
+		throw;
+	}catch(const Poco::Net::WebSocketException &e){
+		errorno = 800 + static_cast<int>(e.code());
+		logger.fatal("lmio: %s: WebSocket exception: %s (%d)", name, std::string(mimiio::strerror(errorno)), errorno);
+	}catch(const Poco::TimeoutException &e){
+		errorno = 830; //timeout;
+		logger.fatal("lmio: %s: WebSocket exception: %s (%d)", name, std::string(mimiio::strerror(errorno)), errorno);
+	}catch(const Poco::Net::NetException &e){
+		errorno = 790; // network error
+		logger.fatal("lmio: %s: Network exception: %s (%d)", name, e.displayText(), errorno);
+	}catch(const Poco::IOException &e){
+		logger.fatal("lmio: %s: I/O error, %s, terminate %s.", name, std::string(e.displayText()), name);
+	}catch(const std::exception &e){
+		logger.fatal("lmio: %s: Unknown error, std exception %s, terminate %s.", name, std::string(e.what()), name);
+	}catch(...){
+		logger.fatal("lmio: %s: Unknown error, terminate %s.", name, name);
+	}
+	return errorno;
+}
+
+}}
@@ -0,0 +1,28 @@
+/**
+ * @file mimiioSendError.hpp
+ * @brief Error number of an exception thrown while encoding or sending audio
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_WORKER_MIMIIOSENDERROR_HPP__
+#define LIBMIMIIO_WORKER_MIMIIOSENDERROR_HPP__
+
+#include <Poco/Logger.h>
+#include <string>
+
+namespace mimiio{ namespace worker{
+
+/**
+ * @brief Get the error number of the exception being handled, and log it
+ *
+ * Must be called in a catch block of the exception thrown by txfunc, the encoder or sending, e.g. catch(...).
+ *
+ * @param [in] name name of the caller in the log, e.g. "txWorker"
+ * @param [in] logger logger
+ * @return 800 + WebSocket error code, 830 for timeout, 790 for network errors, otherwise 799.
+ */
+int send_errorno(const std::string& name, Poco::Logger& logger);
+
+}}
+
+#endif
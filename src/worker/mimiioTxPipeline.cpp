@@ -0,0 +1,193 @@
+/**
+ * @file mimiioTxPipeline.cpp
+ * @brief Encoding on the shared encoder pool pipelined with sending
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#include "worker/mimiioTxPipeline.hpp"
+#include "worker/mimiioSendError.hpp"
+#include <Poco/Clock.h>
+#include <algorithm>
+
+namespace mimiio{ namespace worker{
+
+namespace {
+
+const long send_idle_msec_ = 100; // interval of checking finish() while no block is encoded
+
+}
+
+mimiioTxPipeline::mimiioTxPipeline(const mimiioImpl::Ptr& impl, const encoder::Encoder::Ptr& encoder, size_t capacity, mimiioEncodePool& pool, Poco::Logger& logger) :
+		impl_(impl),
+		encoder_(encoder),
+		pool_(pool),
+		input_(std::max<size_t>(capacity, 1)),
+		output_(std::max<size_t>(capacity, 1)),
+		scheduled_(false),
+		finish_(false),
+		finished_(false),
+		errorno_(0),
+		peakInput_(0),
+		peakOutput_(0),
+		encodedBlocks_(0),
+		sentBlocks_(0),
+		txStalls_(0),
+		encodeStalls_(0),
+		logger_(logger)
+{
+	poco_debug_f1(logger_, "lmio: txPipeline: queue length %z.", std::max<size_t>(capacity, 1));
+}
+
+mimiioTxPipeline::~mimiioTxPipeline()
+{
+}
+
+void mimiioTxPipeline::notify()
+{
+	if(listener_){
+		listener_();
+	}
+}
+
+bool mimiioTxPipeline::ready()
+{
+	if(input_.back() != nullptr){
+		return true;
+	}
+	++txStalls_;
+	return false;
+}
+
+void mimiioTxPipeline::submit(const char* data, size_t len, bool last)
+{
+	Block* block = input_.back();
+	block->data.assign(data, data + len); // reuses memory of the slot
+	block->last = last;
+	input_.push();
+	peakInput_ = std::max(peakInput_.load(), input_.size());
+	schedule();
+}
+
+void mimiioTxPipeline::schedule()
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst); // the queue is updated before checking the flag, see encode()
+	if(!scheduled_.exchange(true)){
+		pool_.schedule(shared_from_this());
+	}
+}
+
+void mimiioTxPipeline::finish()
+{
+	finish_ = true;
+	encoded_.set();
+	std::lock_guard<std::mutex> encodeLock(encodeMutex_); // wait for the encoder
+	std::lock_guard<std::mutex> sendLock(sendMutex_);     // wait for the frame being sent
+}
+
+void mimiioTxPipeline::stats(MIMIIO_TX_PIPELINE_STATS& stats) const
+{
+	stats.encode_depth = input_.size();
+	stats.send_depth = output_.size();
+	stats.peak_encode_depth = peakInput_;
+	stats.peak_send_depth = peakOutput_;
+	stats.encoded = encodedBlocks_;
+	stats.sent = sentBlocks_;
+	stats.tx_stalls = txStalls_;
+	stats.encode_stalls = encodeStalls_;
+}
+
+void mimiioTxPipeline::encode()
+{
+	{
+		std::lock_guard<std::mutex> lock(encodeMutex_);
+		for(size_t n=0;n<slice_ && !finish_;++n){
+			Block* in = input_.front();
+			if(in == nullptr){
+				break;
+			}
+			Block* out = output_.back();
+			if(out == nullptr){
+				++encodeStalls_; // run() schedules again when a block has been sent
+				break;
+			}
+			try{
+				if(encoder_->PassThrough()){
+					out->data.swap(in->data);
+				}else{
+					if(!in->data.empty()){
+						encoder_->Encode(in->data.data(), in->data.size());
+					}
+					if(in->last){
+						encoder_->Flush();
+					}
+					encoder_->SwapEncodedData(out->data);
+				}
+			}catch(const std::exception &e){
+				errorno_ = 799;
+				logger_.fatal("lmio: txPipeline: encoder error, %s, terminate txPipeline.", std::string(e.what()));
+				finish_ = true;
+				encoded_.set();
+				notify();
+				break;
+			}
+			out->last = in->last;
+			input_.pop();
+			output_.push();
+			peakOutput_ = std::max(peakOutput_.load(), output_.size());
+			++encodedBlocks_;
+			encoded_.set();
+			notify(); // the tx worker may submit the next block
+		}
+	}
+	scheduled_ = false;
+	std::atomic_thread_fence(std::memory_order_seq_cst); // blocks submitted while the flag was set are seen here
+	if(!finish_ && input_.size() != 0 && !output_.full()){
+		schedule();
+	}
+}
+
+void mimiioTxPipeline::run()
+{
+	while(!finish_){
+		Block* block = output_.front();
+		if(block == nullptr){
+			encoded_.tryWait(send_idle_msec_);
+			continue;
+		}
+		bool last = block->last;
+		{
+			std::lock_guard<std::mutex> lock(sendMutex_);
+			if(finish_){
+				break;
+			}
+			try{
+				if(!block->data.empty()){
+					Poco::Clock start;
+					impl_->send_frame(block->data.data(), block->data.size());
+					encoder_->Sent(block->data.size(), static_cast<long>(start.elapsed()));
+				}
+				if(last){
+					impl_->send_break();
+					poco_debug(logger_, "lmio: txPipeline: sent recog-break, finish txPipeline normally.");
+				}
+			}catch(...){
+				errorno_ = send_errorno("txPipeline", logger_);
+				finish_ = true;
+				break;
+			}
+		}
+		output_.pop();
+		++sentBlocks_;
+		if(last){
+			break;
+		}
+		if(input_.size() != 0){
+			schedule(); // the encoder may have stopped because this queue was full
+		}
+	}
+	poco_debug_f2(logger_, "lmio: txPipeline: finished, %lu blocks sent, %lu stalls of txfunc.", sentBlocks_.load(), txStalls_.load());
+	finished_ = true;
+	notify();
+}
+
+}}
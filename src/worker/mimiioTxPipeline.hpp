@@ -0,0 +1,178 @@
+/**
+ * @file mimiioTxPipeline.hpp
+ * @brief Encoding on the shared encoder pool pipelined with sending
+ * @author Copyright (c) 2014-2018 Fairy Devices Inc. http://www.fairydevices.jp/
+ */
+
+#ifndef LIBMIMIIO_WORKER_MIMIIOTXPIPELINE_HPP__
+#define LIBMIMIIO_WORKER_MIMIIOTXPIPELINE_HPP__
+
+#include "mimiio.h"
+#include "mimiioImpl.hpp"
+#include "mimiioEncodePool.hpp"
+#include "encoder/encoder.hpp"
+#include <Poco/Runnable.h>
+#include <Poco/Event.h>
+#include <Poco/Logger.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mimiio{ namespace worker{
+
+/**
+ * @class mimiioTxPipeline
+ * @brief Audio blocks passed from the tx worker to the encoder pool, and from the encoder pool to the send stage
+ *
+ * The tx worker submits each block of audio read from txfunc or the push source, and goes on to read the next one without
+ * waiting for encoding or sending. Blocks of one connection are encoded in order by one thread of the shared pool at a time,
+ * and sent in order by run() on its own thread, so that a slow socket does not delay txfunc and slow encoding does not delay
+ * sending the blocks already encoded.
+ *
+ * Both queues are bounded lock-free rings for one producer and one consumer, whose slots keep their memory.
+ * When the encoder queue is full the tx worker waits, and when the send queue is full the encoder stops until a block
+ * has been sent. Both are counted as stalls for backpressure statistics.
+ */
+class mimiioTxPipeline : public Poco::Runnable, public mimiioEncodePool::Task, public std::enable_shared_from_this<mimiioTxPipeline>
+{
+public:
+
+	typedef std::shared_ptr<mimiioTxPipeline> Ptr;
+	typedef std::function<void()> LISTENER_T;
+
+	static const size_t slice_ = 4; //!< blocks encoded at a time before the pool runs other connections
+
+	/**
+	 * @brief C'tor
+	 *
+	 * @param [in] impl mimiioImpl class, mimi(R) API implementation encapsulated, shared with the controller.
+	 * @param [in] encoder Audio encoder, shared with the controller and used only by the encoder pool after this.
+	 * @param [in] capacity the maximum number of blocks in each queue, at least 1.
+	 * @param [in] pool shared encoder pool
+	 * @param [in] logger logger
+	 */
+	mimiioTxPipeline(const mimiioImpl::Ptr& impl, const encoder::Encoder::Ptr& encoder, size_t capacity, mimiioEncodePool& pool, Poco::Logger& logger);
+
+	~mimiioTxPipeline();
+
+	/**
+	 * @brief Set the function called when a block has been encoded, and when the pipeline has finished or failed
+	 *
+	 * Called on threads of the pipeline, not after finish() has returned. Must be set before the first block is submitted.
+	 */
+	void setListener(const LISTENER_T& listener) { listener_ = listener; }
+
+	/**
+	 * @brief Determine whether a block can be submitted, called by the tx worker. Counted as a stall if not.
+	 */
+	bool ready();
+
+	/**
+	 * @brief Submit a block, called by the tx worker after ready() has returned true.
+	 *
+	 * @param [in] data audio, which is copied.
+	 * @param [in] len length of audio
+	 * @param [in] last true if this is the last block, which is followed by recog-break.
+	 */
+	void submit(const char* data, size_t len, bool last);
+
+	/**
+	 * @brief Stop all stages and drop queued blocks
+	 *
+	 * Waits for the block being encoded or sent now, if any, so that nothing is sent and the encoder is not used after this function returns.
+	 */
+	void finish();
+
+	/**
+	 * @brief Determine whether recog-break has been sent, or the pipeline has stopped.
+	 */
+	bool finished() const { return finished_; }
+
+	/**
+	 * @brief Get the error of encoding or sending, 0 if none.
+	 */
+	int errorno() const { return errorno_; }
+
+	/**
+	 * @brief Get queue statistics
+	 *
+	 * @param [out] stats statistics
+	 */
+	void stats(MIMIIO_TX_PIPELINE_STATS& stats) const;
+
+	/**
+	 * @brief Encode up to slice_ blocks, called by the encoder pool
+	 */
+	virtual void encode();
+
+	/**
+	 * @brief Send encoded blocks until the last one has been sent or finish() is called
+	 */
+	virtual void run();
+
+private:
+
+	mimiioTxPipeline(mimiioTxPipeline const&) = delete;
+	mimiioTxPipeline& operator = (mimiioTxPipeline const&) = delete;
+
+	struct Block
+	{
+		Block() : last(false){}
+		std::vector<char> data;
+		bool last;
+	};
+
+	/**
+	 * @brief Bounded lock-free ring of blocks for one producer and one consumer
+	 */
+	class Queue
+	{
+	public:
+		explicit Queue(size_t capacity) : slots_(capacity), head_(0), tail_(0){}
+		size_t size() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire); }
+		bool full() const { return size() == slots_.size(); }
+		Block* back() { return full() ? nullptr : &slots_[tail_.load(std::memory_order_relaxed) % slots_.size()]; } // producer
+		void push() { tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release); } // producer
+		Block* front() { return size() == 0 ? nullptr : &slots_[head_.load(std::memory_order_relaxed) % slots_.size()]; } // consumer
+		void pop() { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); } // consumer
+	private:
+		std::vector<Block> slots_;
+		std::atomic<size_t> head_;
+		char padding_[64 - sizeof(std::atomic<size_t>)]; // keep positions on different cache lines
+		std::atomic<size_t> tail_;
+	};
+
+	/**
+	 * @brief Schedule encode() on the pool unless it is scheduled or running
+	 */
+	void schedule();
+
+	void notify();
+
+	mimiioImpl::Ptr impl_;          // shared, the encoder pool may hold this pipeline after the controller has gone
+	encoder::Encoder::Ptr encoder_;
+	mimiioEncodePool& pool_;
+	Queue input_;  // from the tx worker to the encoder
+	Queue output_; // from the encoder to run()
+	std::atomic<bool> scheduled_;
+	std::mutex encodeMutex_; // held while encoding, for finish()
+	std::mutex sendMutex_;   // held while sending, for finish()
+	Poco::Event encoded_;    // auto reset, wakes up run()
+	std::atomic<bool> finish_;
+	std::atomic<bool> finished_;
+	std::atomic<int> errorno_;
+	std::atomic<size_t> peakInput_;         // written only by the tx worker
+	std::atomic<size_t> peakOutput_;        // written only by the encoder
+	std::atomic<unsigned long> encodedBlocks_;
+	std::atomic<unsigned long> sentBlocks_;
+	std::atomic<unsigned long> txStalls_;
+	std::atomic<unsigned long> encodeStalls_;
+	LISTENER_T listener_;
+	Poco::Logger& logger_;
+};
+
+}}
+
+#endif
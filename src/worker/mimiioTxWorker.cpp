@@ -8,29 +8,41 @@
 #include "strerror.hpp"
 #include "mimiioImpl.hpp"
 #include "worker/mimiioTxWorker.hpp"
+#include "worker/mimiioTxPipeline.hpp"
+#include "worker/mimiioSendError.hpp"
 #include <Poco/Thread.h>
 #include <Poco/Format.h>
-#include <Poco/Net/NetException.h>
+#include <algorithm>
+#include <limits>
 
 namespace mimiio{ namespace worker{
 
-const int maximum_send_buffer_size_ = 262144; //!< maximum send buffer size for WebSocket payload for a data frame.
 
 mimiioTxWorker::mimiioTxWorker(
 		const mimiioImpl::Ptr& impl,
 		const encoder::Encoder::Ptr& encoder,
 		ON_TX_CALLBACK_T func,
 		void* userdata,
+		mimiioNotifier& notifier,
 		Poco::Logger& logger) :
 		impl_(impl),
 		encoder_(encoder),
 		func_(func),
 		userdata_(userdata),
+		push_(nullptr),
+		pipeline_(nullptr),
+		draining_(false),
+		notifier_(notifier),
 		errorno_(0),
 		finish_(false),
 		finished_(false),
+		bufferSize_(default_buffer_size_),
+		idleSleep_(default_idle_sleep_msec_),
+		coalesceBytes_(0),
+		coalesceDelay_(0),
 		logger_(logger)
 {
+	//buffer_ is allocated by setBufferSize() from the open options, not with the default size first
 	poco_debug(logger_, "lmio: txWorker: initialized.");
 }
 
@@ -45,121 +57,246 @@ void mimiioTxWorker::finish()
 	finish_ = true;
 }
 
+void mimiioTxWorker::detach()
+{
+	finish_ = true;
+	gate_.close();
+	wakeup_.set();
+}
+
 bool mimiioTxWorker::finished() const
 {
 	return finished_;
 }
 
+void mimiioTxWorker::setBufferSize(size_t size)
+{
+	bufferSize_ = size;
+	if(func_){
+		buffer_.assign(size, 0);
+	}
+	poco_debug_f1(logger_, "lmio: txWorker: send buffer %z bytes.", size);
+}
+
+void mimiioTxWorker::wakeup()
+{
+	wakeup_.set();
+}
+
 int mimiioTxWorker::errorno() const
 {
 	return errorno_;
 }
 
+void mimiioTxWorker::setCoalescing(size_t max_bytes, int max_delay_ms)
+{
+	coalesceBytes_ = max_bytes;
+	coalesceDelay_ = static_cast<Poco::Clock::ClockDiff>(std::max(max_delay_ms, 0)) * 1000;
+	pending_.reserve(max_bytes);
+	poco_debug_f2(logger_, "lmio: txWorker: coalescing up to %z bytes or %d msec.", max_bytes, max_delay_ms);
+}
+
+long mimiioTxWorker::pendingDeadline() const
+{
+	if(pending_.empty()){
+		return std::numeric_limits<long>::max();
+	}
+	return static_cast<long>(std::max<Poco::Clock::ClockDiff>(coalesceDelay_ - pendingSince_.elapsed(), 0) / 1000);
+}
+
+void mimiioTxWorker::transmit(const char* data, size_t len, bool flush)
+{
+	if(coalesceBytes_ == 0){
+		if(len != 0){
+			Poco::Clock start;
+			impl_->send_frame(data, len);
+			encoder_->Sent(len, static_cast<long>(start.elapsed()));
+		}
+		return;
+	}
+	if(len != 0){
+		if(pending_.empty()){
+			pendingSince_.update();
+		}
+		pending_.insert(pending_.end(), data, data + len);
+	}
+	if(pending_.empty()){
+		return;
+	}
+	if(flush || coalesceBytes_ <= pending_.size() || pendingSince_.isElapsed(coalesceDelay_)){
+		poco_debug_f1(logger_, "lmio: txWorker: send coalesced data length = %z bytes.", pending_.size());
+		Poco::Clock start;
+		impl_->send_frame(pending_.data(), pending_.size());
+		encoder_->Sent(pending_.size(), static_cast<long>(start.elapsed()));
+		pending_.clear();
+	}
+}
+
 void mimiioTxWorker::run()
 {
-	std::vector<char> buffer(mimiio::worker::maximum_send_buffer_size_);
-	while(!finish_){
-		try{
-			if(impl_->closed()){
-				break; // break tx loop
+	long wait_msec = 0;
+	while((wait_msec = step()) >= 0){
+		if(wait_msec > 0){
+			wakeup_.tryWait(wait_msec); // avoid busy loop with short time pause, until wakeup() is called
+		}
+	}
+}
+
+long mimiioTxWorker::stop()
+{
+	if(pipeline_ != nullptr){
+		pipeline_->finish(); // nothing is sent after the loop has finished
+	}
+	if(!finished_){
+		logger_.information("lmio: txWorker: tx loop finished with code %d", errorno_.load());
+		finished_ = true;
+		notifier_.notify();
+	}
+	return -1;
+}
+
+bool mimiioTxWorker::flush()
+{
+	try{
+		return impl_->flush();
+	}catch(...){
+		errorno_ = send_errorno("txWorker", logger_);
+		stop();
+		return true; // nothing is sent any more
+	}
+}
+
+long mimiioTxWorker::step()
+{
+	if(finish_ || finished_){
+		return stop();
+	}
+	try{
+		if(impl_->closed()){
+			return stop(); // break tx loop
+		}
+		if(pipeline_ != nullptr){
+			if(pipeline_->errorno() != 0){
+				errorno_ = pipeline_->errorno();
+				return stop();
+			}
+			if(draining_){
+				return pipeline_->finished() ? stop() : idleSleep_; // woken up when recog-break has been sent
 			}
-			size_t len = 0;
-			bool recog_break = false;
+			if(!pipeline_->ready()){
+				return idleSleep_; // woken up when a block has been encoded
+			}
+		}
+		size_t len = 0;
+		bool recog_break = false;
+		const char* audio = nullptr;
+		if(push_ != nullptr){
+			audio = push_->peek(len, recog_break); // encoded in place, consumed after encoding
+		}else{
 			int tx_error = 0;
-			func_(&buffer[0], &len, &recog_break, &tx_error, userdata_); //user defined callback for tx audio (txfunc)
+			if(buffer_.empty()){
+				buffer_.resize(bufferSize_); // setBufferSize() has not been called
+			}
+			if(!gate_.call([&]{ func_(&buffer_[0], &len, &recog_break, &tx_error, userdata_); })){ //user defined callback for tx audio (txfunc)
+				return stop(); // detached by mimi_close()
+			}
 			if(tx_error != 0){
 				errorno_ = tx_error;
-				logger_.fatal("lmio: txWorker: user defined error occurred in txfunc callback (%d), terminate txWorker and sendBreak to remote host.",errorno_);
+				logger_.fatal("lmio: txWorker: user defined error occurred in txfunc callback (%d), terminate txWorker and sendBreak to remote host.",errorno_.load());
 				// When user defined error occurred in txfunc, WebSocket connection may be OK so that rxWorker waits for timeout at impl_->receive().
 				// It is better to close immediately, but client-initiated WebSocket closing is not good way according to WebSocket protocol,
 				// We just send to server 'break' command so that the server will close the connection.
+				if(pipeline_ != nullptr){
+					pipeline_->finish(); // not to interleave with frames being sent
+				}
 				impl_->send_break();
-				break; // break tx loop
+				return stop(); // break tx loop
 			}
-			if(mimiio::worker::maximum_send_buffer_size_ < len){
+			if(bufferSize_ < len){
 				//Buffer overrun has occurred!
 				//This might have caused destructive memory error, when you're enough happy to be nothing happened. libmimiio is shutdown immediately.
 				errorno_ = 903;
-				logger_.fatal("lmio: txWorker: %s (%d), terminate txWorker.", std::string(mimiio::strerror(errorno_)), errorno_);
-				break; // break tx loop
-			}
-			if(len == 0){
-				//set just recog-break only
-				if(recog_break){
-					encoder_->Flush();
-					std::vector<char> encodedData;
-					encoder_->GetEncodedData(encodedData);
-					if(encodedData.size() != 0){
-						poco_debug_f1(logger_, "lmio: flush encoder and send data length = %d bytes (1).", static_cast<int>(encodedData.size()));
-						impl_->send_frame(encodedData, encodedData.size()); //First, send audio data
-					}
-					impl_->send_break();
-					poco_debug(logger_, "lmio: txWorker: sent recog-break, finish txWorker normally.");
-					break;
-				}
-				Poco::Thread::sleep(100); // avoid busy loop with short time pause only when length is 0
-				continue; //do nothing
+				logger_.fatal("lmio: txWorker: %s (%d), terminate txWorker.", std::string(mimiio::strerror(errorno_.load())), errorno_.load());
+				return stop(); // break tx loop
 			}
+			audio = buffer_.data();
+		}
 
-			//Audio encoding
-			std::vector<char> slice;
-			for(size_t i=0;i<len;++i){
-				slice.push_back(buffer[i]);
+		//Encoded and sent by the pipeline
+		if(pipeline_ != nullptr){
+			if(len == 0 && !recog_break){
+				return idleSleep_; // woken up when audio is pushed
 			}
-			encoder_->Encode(slice);
-			std::vector<char> encodedData;
-			encoder_->GetEncodedData(encodedData);
-			if(encodedData.size() == 0 && !recog_break){
-				poco_debug_f2(logger_, "lmio: encoder in=%d, out=%d", static_cast<int>(len), static_cast<int>(encodedData.size()));
-				Poco::Thread::sleep(1); // avoid busy loop with short time pause
-				continue;
+			pipeline_->submit(audio, len, recog_break);
+			if(push_ != nullptr){
+				push_->consume(len);
 			}
-			poco_debug_f2(logger_, "lmio: encoder in=%d, out=%d", static_cast<int>(len), static_cast<int>(encodedData.size()));
-
-			//Transmit audio data
-			if(encodedData.size() != 0){
-				impl_->send_frame(encodedData, encodedData.size()); //First, send audio data
+			if(recog_break){
+				poco_debug(logger_, "lmio: txWorker: submitted the last block, wait for recog-break.");
+				draining_ = true;
+				return idleSleep_;
 			}
+			return 0;
+		}
+		if(len == 0){
+			//set just recog-break only
 			if(recog_break){
-				encodedData.clear();
 				encoder_->Flush();
-				encoder_->GetEncodedData(encodedData);
-				if(encodedData.size() != 0){
-					poco_debug_f1(logger_, "lmio: flush encoder and send data length = %d bytes (2).", static_cast<int>(encodedData.size()));
-					impl_->send_frame(encodedData, encodedData.size()); //First, send audio data
-				}
-				impl_->send_break(); //Next, set recog-break
+				encoder_->SwapEncodedData(encoded_);
+				poco_debug_f1(logger_, "lmio: flush encoder and send data length = %d bytes (1).", static_cast<int>(encoded_.size()));
+				transmit(encoded_.data(), encoded_.size(), true); //First, send audio data
+				impl_->send_break();
+				poco_debug(logger_, "lmio: txWorker: sent recog-break, finish txWorker normally.");
+				return stop();
+			}
+			transmit(nullptr, 0, false); // send pending data if it has waited too long
+			return std::min(idleSleep_, std::max(pendingDeadline(), 1L)); // avoid busy loop with short time pause only when length is 0
+		}
+
+		//Pass-through formats are sent as is, without copying into the encoder
+		if(encoder_->PassThrough()){
+			poco_debug_f1(logger_, "lmio: pass-through in=%d", static_cast<int>(len));
+			transmit(audio, len, recog_break); // sent or copied into pending data before the push source is consumed
+			if(push_ != nullptr){
+				push_->consume(len);
+			}
+			if(recog_break){
+				impl_->send_break();
 				poco_debug(logger_, "lmio: txWorker: sent recog-break (with audio), finish txWorker normally.");
-				break;
+				return stop();
 			}
-		}catch(const Poco::Net::WebSocketException &e){
-			errorno_ = 800 + static_cast<int>(e.code());
-			logger_.fatal("lmio: txWorker: WebSocket exception: %s (%d)", std::string(mimiio::strerror(errorno_)), errorno_);
-			break;
-		}catch(const Poco::TimeoutException &e){
-			errorno_ = 830; //timeout;
-			logger_.fatal("lmio: txWorker: WebSocket exception: %s (%d)", std::string(mimiio::strerror(errorno_)), errorno_);
-			break;
-		}catch(const Poco::Net::NetException &e){
-			errorno_ = 790; // network error
-			logger_.fatal("lmio: txWorker: Network exception: %s (%d)", e.displayText(), errorno_);
-			break;
-		}catch(const Poco::IOException &e){
-			errorno_ = 799; // undefined network error
-			logger_.fatal("lmio: txWorker: I/O error, %s, terminate txWorker.", std::string(e.displayText()));
-			break;
-		}catch(const std::exception &e){
-			errorno_ = 799; // undefined network error
-			logger_.fatal("lmio: txWorker: Unknown error, std exception %s, terminate txWorker.", std::string(e.what()));
-			break;
-		}catch(...){
-			errorno_ = 799; // undefined network error
-			logger_.fatal("lmio: txWorker: Unknown error, terminate txWorker.");
-			break;
+			return 0;
+		}
+
+		//Audio encoding
+		encoder_->Encode(audio, len);
+		if(push_ != nullptr){
+			push_->consume(len);
+		}
+		encoder_->SwapEncodedData(encoded_);
+		if(encoded_.size() == 0 && !recog_break){
+			poco_debug_f2(logger_, "lmio: encoder in=%d, out=%d", static_cast<int>(len), static_cast<int>(encoded_.size()));
+			transmit(nullptr, 0, false); // send pending data if it has waited too long
+			return 1; // avoid busy loop with short time pause
+		}
+		poco_debug_f2(logger_, "lmio: encoder in=%d, out=%d", static_cast<int>(len), static_cast<int>(encoded_.size()));
+
+		//Transmit audio data
+		transmit(encoded_.data(), encoded_.size(), false); //First, send audio data
+		if(recog_break){
+			encoder_->Flush();
+			encoder_->SwapEncodedData(encoded_);
+			poco_debug_f1(logger_, "lmio: flush encoder and send data length = %d bytes (2).", static_cast<int>(encoded_.size()));
+			transmit(encoded_.data(), encoded_.size(), true); //First, send audio data
+			impl_->send_break(); //Next, set recog-break
+			poco_debug(logger_, "lmio: txWorker: sent recog-break (with audio), finish txWorker normally.");
+			return stop();
 		}
-	}//while
-	logger_.information("lmio: txWorker: tx loop finished with code %d", errorno_);
-	finished_ = true;
+	}catch(...){
+		errorno_ = send_errorno("txWorker", logger_);
+		return stop();
+	}
+	return 0;
 }
 
 }}
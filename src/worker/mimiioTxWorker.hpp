@@ -9,18 +9,31 @@
 #define LIBMIMIIO_MIMIIOIMPLTXWORKER_HPP__
 
 #include "typedef.hpp"
+#include "mimiioNotifier.hpp"
+#include "mimiioCallbackGate.hpp"
 #include "encoder/encoder.hpp"
+#include "worker/mimiioPushSource.hpp"
 #include <Poco/Runnable.h>
+#include <Poco/Clock.h>
+#include <Poco/Event.h>
+#include <algorithm>
+#include <vector>
+#include <atomic>
 #include <memory>
 
 namespace mimiio{ class mimiioImpl; namespace worker{
 
+class mimiioTxPipeline;
+
 class mimiioTxWorker : public Poco::Runnable
 {
 public:
 
 	typedef std::unique_ptr<mimiioTxWorker> Ptr;
 
+	static const size_t default_buffer_size_ = 262144; //!< default size of the buffer for txfunc, maximum payload of a data frame.
+	static const long default_idle_sleep_msec_ = 100;  //!< default maximum pause when txfunc returns no audio
+
 	/**
 	 * @brief C'tor
 	 *
@@ -28,6 +41,7 @@ public:
 	 * @param [in] encoder Audio encoder
 	 * @param [in] func txfunc
 	 * @param [in] userdata User defined data for txfunc
+	 * @param [in] notifier notified when the loop has finished
 	 * @param [in] logger logger
 	 */
 	mimiioTxWorker(
@@ -35,6 +49,7 @@ public:
 			const encoder::Encoder::Ptr& encoder,
 			ON_TX_CALLBACK_T func,
 			void* userdata,
+			mimiioNotifier& notifier,
 			Poco::Logger& logger);
 
 	/**
@@ -56,6 +71,70 @@ public:
 	 */
 	bool finished() const;
 
+	/**
+	 * @brief Stop calling txfunc and finish the loop without recog-break
+	 *
+	 * Waits for txfunc running now, if any.
+	 */
+	void detach();
+
+	/**
+	 * @brief Set coalescing policy of encoded audio data
+	 *
+	 * Small outputs of the encoder are merged into one WebSocket frame until \e max_bytes is reached or
+	 * the oldest output has waited for \e max_delay_ms. Pending data is always sent before recog-break.
+	 * This function must be called before run().
+	 *
+	 * @param [in] max_bytes size of merged frame, 0 means each output is sent as its own frame.
+	 * @param [in] max_delay_ms maximum delay of pending data in milliseconds
+	 */
+	void setCoalescing(size_t max_bytes, int max_delay_ms);
+
+	/**
+	 * @brief Set the size of the buffer given to txfunc, and allocate it
+	 *
+	 * This function must be called before run(). Otherwise the buffer is allocated with default_buffer_size_ by the first step.
+	 *
+	 * @param [in] size size in bytes
+	 */
+	void setBufferSize(size_t size);
+
+	/**
+	 * @brief Set the maximum pause when txfunc returns no audio
+	 *
+	 * This function must be called before run().
+	 *
+	 * @param [in] msec milliseconds, at least 1.
+	 */
+	void setIdleSleep(long msec) { idleSleep_ = std::max(msec, 1L); }
+
+	/**
+	 * @brief Read audio from the push source instead of txfunc
+	 *
+	 * Audio in the ring buffer of \e source is encoded in place without copying.
+	 * This function must be called before run().
+	 *
+	 * @param [in] source push source, which must be alive while the loop is running.
+	 */
+	void setPushSource(mimiioPushSource* source) { push_ = source; }
+
+	/**
+	 * @brief Submit audio to the pipeline instead of encoding and sending it in this loop
+	 *
+	 * The loop goes on to the next txfunc call while the audio is encoded and sent by \e pipeline, and waits only when
+	 * its queue is full. Coalescing is not applied. This function must be called before run().
+	 *
+	 * @param [in] pipeline pipeline, which must be alive while the loop is running.
+	 */
+	void setPipeline(mimiioTxPipeline* pipeline) { pipeline_ = pipeline; }
+
+	/**
+	 * @brief Wake up run() waiting for audio, e.g. when audio has been pushed
+	 *
+	 * This function is thread-safe.
+	 */
+	void wakeup();
+
 	/**
 	 * @brief Get errorno in this class
 	 *
@@ -66,19 +145,73 @@ public:
 	/**
 	 * @brief Start audio-sending loop
 	 *
-	 * This loop is break when finish() is called.
+	 * This loop calls step() repeatedly, and is break when finish() is called.
 	 */
 	void run();
 
+	/**
+	 * @brief Run one iteration of audio-sending loop
+	 *
+	 * Calls txfunc once or reads the push source, then encodes and sends the audio. This function is for event loops which call it
+	 * from a timer instead of run().
+	 *
+	 * @return milliseconds to wait before the next call, 0 to call again immediately, or -1 if the loop has finished.
+	 */
+	long step();
+
+	/**
+	 * @brief Write frames queued on a non-blocking socket, for event loops when the socket becomes writable
+	 *
+	 * An error of sending finishes the loop, same as step().
+	 *
+	 * @return true if no frame is pending.
+	 */
+	bool flush();
+
 private:
 
+	/**
+	 * @brief Send encoded audio data, or keep it pending according to coalescing policy
+	 *
+	 * @param [in] data encoded audio data
+	 * @param [in] len length of data, may be 0 to check the delay of pending data.
+	 * @param [in] flush send pending data regardless of coalescing policy
+	 */
+	void transmit(const char* data, size_t len, bool flush);
+
+	/**
+	 * @brief Mark the loop as finished
+	 *
+	 * @return -1
+	 */
+	long stop();
+
+	/**
+	 * @brief Milliseconds until pending data must be sent
+	 */
+	long pendingDeadline() const;
+
 	const mimiioImpl::Ptr& impl_;
 	const encoder::Encoder::Ptr& encoder_;
 	ON_TX_CALLBACK_T func_;
 	void* userdata_;
-	int errorno_;
-	bool finish_;
-	bool finished_;
+	mimiioPushSource* push_;
+	mimiioTxPipeline* pipeline_;
+	bool draining_;            // the last block has been submitted to pipeline_
+	mimiioNotifier& notifier_;
+	mimiioCallbackGate gate_; // for func_
+	std::atomic<int> errorno_;
+	std::atomic<bool> finish_;
+	std::atomic<bool> finished_;
+	std::vector<char> buffer_; // for txfunc
+	size_t bufferSize_;        // length of buffer_ available for txfunc
+	long idleSleep_;           // msec
+	size_t coalesceBytes_;
+	Poco::Clock::ClockDiff coalesceDelay_; // usec
+	std::vector<char> encoded_; // swapped with the output buffer of the encoder, see Encoder::SwapEncodedData()
+	std::vector<char> pending_;
+	Poco::Clock pendingSince_;
+	Poco::Event wakeup_; // auto reset
 	Poco::Logger& logger_;
 };
 